@@ -1,3 +1,4 @@
+#include <cmath>
 #include <memory>
 
 #include <legs/entry.hpp>
@@ -31,41 +32,27 @@ class MySystem : public ISystem
         auto sky = std::make_shared<Sky>(renderer);
         world->SetSky(sky);
 
-        // Create some test spheres
+        // Create some test spheres, sharing a mesh so they are drawn instanced
+        auto testSphere = SIcosphere(glm::vec3(0, 0, 0), 0.5f, 1);
+
+        std::vector<Vertex_P_N_C> sphereVertices;
+        sphereVertices.reserve(testSphere.positions.size());
+        for (unsigned int i = 0; i < testSphere.positions.size(); i++)
+        {
+            sphereVertices.push_back(
+                {testSphere.positions[i], testSphere.normals[i], glm::vec3(0.5, 0.5, 0.5)}
+            );
+        }
+        auto sphereMesh = renderer->CreateMesh(sphereVertices, testSphere.indices);
+
         for (unsigned int x = 0; x < 3; x++)
         {
             for (unsigned int y = 0; y < 3; y++)
             {
-                auto                    testSphere = SIcosphere(glm::vec3(x, y, 5), 0.5f, 1);
-                std::shared_ptr<Buffer> sphereVertexBuffer;
-                std::shared_ptr<Buffer> sphereIndexBuffer;
-
-                std::vector<Vertex_P_N_C> sphereVertices;
-                sphereVertices.reserve(testSphere.positions.size());
-                for (unsigned int i = 0; i < testSphere.positions.size(); i++)
-                {
-                    sphereVertices.push_back(
-                        {testSphere.positions[i], testSphere.normals[i], glm::vec3(0.5, 0.5, 0.5)}
-                    );
-                }
-                renderer->CreateBuffer(
-                    sphereVertexBuffer,
-                    VertexBuffer,
-                    sphereVertices.data(),
-                    sizeof(Vertex_P_N_C),
-                    static_cast<uint32_t>(sphereVertices.size())
-                );
-                renderer->CreateBuffer(
-                    sphereIndexBuffer,
-                    IndexBuffer,
-                    testSphere.indices.data(),
-                    sizeof(Index),
-                    static_cast<uint32_t>(testSphere.indices.size())
-                );
-
                 auto sphere = std::make_shared<MeshEntity>();
-                sphere->SetBuffers(sphereVertexBuffer, sphereIndexBuffer);
+                sphere->SetMesh(sphereMesh);
                 sphere->SetPipeline(RenderPipeline::GEO_P_N_C);
+                sphere->SetPosition(glm::vec3(x, y, 5));
                 world->AddEntity(sphere);
                 m_spheres.push_back(sphere);
             }
@@ -103,6 +90,7 @@ class MySystem : public ISystem
 
         auto plane = std::make_shared<MeshEntity>();
         plane->SetBuffers(planeVertexBuffer, planeIndexBuffer);
+        plane->SetBounds(SBounds::FromVertices(planeVertices.data(), sizeof(Vertex_P_C), 4));
         plane->SetPipeline(RenderPipeline::GEO_P_C);
         world->AddEntity(plane);
     }
@@ -115,17 +103,6 @@ class MySystem : public ISystem
     {
         m_camera->HandleInput(g_engine->GetFrameInput());
 
-        // TODO: model matrix buffer
-        // Move the spheres around
-        /*
-        for (unsigned int i = 0; i < m_spheres.size(); i++)
-        {
-            auto pos = m_spheres[i]->GetPosition();
-            pos.z    = static_cast<float>(std::sin(legs::Time::Uptime() * i));
-            m_spheres[i]->SetPosition(pos);
-        }
-        */
-
         // Move the sun across the sky
         const auto degreesPerSecond = 5.0;
         auto       sunRotation      = glm::angleAxis(
@@ -138,6 +115,13 @@ class MySystem : public ISystem
 
     void OnTick() override
     {
+        // Move the spheres around
+        for (unsigned int i = 0; i < m_spheres.size(); i++)
+        {
+            auto pos = m_spheres[i]->GetPosition();
+            pos.z    = 5.0f + static_cast<float>(std::sin(legs::Time::Uptime() * i));
+            m_spheres[i]->SetPosition(pos);
+        }
     }
 
   private:
@@ -58,20 +58,23 @@ class MySystem : public ISystem
 
         auto plane = std::make_shared<PhysicsEntity>();
         plane->SetBuffers(planeVertexBuffer, planeIndexBuffer);
+        plane->SetBounds(SBounds::FromVertices(planeVertices.data(), sizeof(Vertex_P_C), 4));
         plane->SetPipeline(RenderPipeline::GEO_P_C);
 
-        auto planeCollider = BoxCollider(
+        auto planeCollider = MeshCollider(
             JPH::EMotionType::Static,
             Layers::NON_MOVING,
-            plane->GetTransform(),
-            {20.0f, 20.0f, 0.1f}
+            planeVertices.data(),
+            sizeof(Vertex_P_C),
+            static_cast<uint32_t>(planeVertices.size()),
+            testPlane.indices
         );
         plane->SetCollider(planeCollider);
 
         world->AddEntity(plane);
 
         // Create a sphere
-        auto                    testSphere = SIcosphere(glm::vec3(0.0f, 0.0f, 10.0f), 0.5f, 1);
+        auto                    testSphere = SIcosphere(glm::vec3(0.0f, 0.0f, 0.0f), 0.5f, 1);
         std::shared_ptr<Buffer> sphereVertexBuffer;
         std::shared_ptr<Buffer> sphereIndexBuffer;
 
@@ -100,10 +103,15 @@ class MySystem : public ISystem
 
         auto sphere = std::make_shared<PhysicsEntity>();
         sphere->SetBuffers(sphereVertexBuffer, sphereIndexBuffer);
+        sphere->SetBounds(SBounds::FromVertices(
+            sphereVertices.data(),
+            sizeof(Vertex_P_N_C),
+            static_cast<uint32_t>(sphereVertices.size())
+        ));
         sphere->SetPipeline(RenderPipeline::GEO_P_N_C);
+        sphere->SetPosition({0.0f, 0.0f, 10.0f});
 
-        auto sphereCollider =
-            SphereCollider(JPH::EMotionType::Dynamic, Layers::MOVING, sphere->GetTransform(), 0.5f);
+        auto sphereCollider = SphereCollider(JPH::EMotionType::Dynamic, Layers::MOVING, 0.5f);
         sphere->SetCollider(sphereCollider);
 
         world->AddEntity(sphere);
@@ -136,5 +144,10 @@ int main(int argc, char** argv)
 
     g_engine->AddSystem(std::make_shared<MySystem>());
 
+    if (HasLaunchArg("--debug-physics", nullptr, argc, argv))
+    {
+        g_engine->GetWorld()->GetPhysics()->SetDebugDrawSettings({.enabled = true});
+    }
+
     return LEGS_Run();
 }
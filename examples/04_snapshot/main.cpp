@@ -0,0 +1,168 @@
+#include <array>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include <legs/entry.hpp>
+
+#include <legs/collider.hpp>
+#include <legs/isystem.hpp>
+#include <legs/log.hpp>
+#include <legs/physics_snapshot.hpp>
+#include <legs/shape_cache.hpp>
+#include <legs/time.hpp>
+
+using namespace legs;
+
+// Measures the cost of saving and restoring the physics state at different body counts.
+// Every 10th body is a dynamic sphere falling freely, the rest are static boxes, so the
+// active body snapshots only contain a fraction of the world.
+class SnapshotBenchmark : public ISystem
+{
+  public:
+    SnapshotBenchmark()
+    {
+        m_sphereShape = ShapeCache::GetSphere(0.5f);
+        m_boxShape    = ShapeCache::GetBox({0.5f, 0.5f, 0.5f});
+    }
+
+    ~SnapshotBenchmark()
+    {
+    }
+
+    void OnTick() override
+    {
+        if (m_countIndex >= m_bodyCounts.size())
+        {
+            return;
+        }
+
+        if (m_bodies.empty())
+        {
+            CreateBodies(m_bodyCounts[m_countIndex]);
+            m_ticks = 0;
+            return;
+        }
+
+        // Let the simulation run a bit so there are contacts and moving bodies to save.
+        if (++m_ticks < cWarmupTicks)
+        {
+            return;
+        }
+
+        Measure(m_bodyCounts[m_countIndex]);
+        DestroyBodies();
+
+        m_countIndex++;
+        if (m_countIndex >= m_bodyCounts.size())
+        {
+            g_engine->Quit();
+        }
+    }
+
+  private:
+    void CreateBodies(uint32_t count)
+    {
+        auto physics = g_engine->GetWorld()->GetPhysics();
+        auto side    = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(count))));
+
+        m_bodies.reserve(count);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            // Jolt's gravity points along -Y, the grid lies in XZ with the spheres above it.
+            const float x       = 2.0f * static_cast<float>(i % side);
+            const float z       = 2.0f * static_cast<float>(i / side);
+            const bool  dynamic = i % 10 == 0;
+
+            auto settings = JPH::BodyCreationSettings(
+                dynamic ? m_sphereShape : m_boxShape,
+                JPH::RVec3(x, dynamic ? 50.0f : 0.0f, z),
+                JPH::Quat::sIdentity(),
+                dynamic ? JPH::EMotionType::Dynamic : JPH::EMotionType::Static,
+                dynamic ? Layers::MOVING : Layers::NON_MOVING
+            );
+
+            auto id = physics->CreateBody(settings);
+            if (id.IsInvalid())
+            {
+                LOG_ERROR("Failed to create body {}", i);
+                break;
+            }
+            physics->AddBody(id);
+            m_bodies.push_back(id);
+        }
+        physics->Optimize();
+    }
+
+    void DestroyBodies()
+    {
+        auto physics = g_engine->GetWorld()->GetPhysics();
+        for (auto id : m_bodies)
+        {
+            physics->RemoveBody(id);
+            physics->DestroyBody(id);
+        }
+        m_bodies.clear();
+    }
+
+    void Measure(uint32_t count)
+    {
+        auto physics = g_engine->GetWorld()->GetPhysics();
+
+        for (auto mode : {SnapshotMode::Full, SnapshotMode::ActiveBodies})
+        {
+            // First save grows the buffer, keep it out of the timings.
+            physics->SaveState(m_snapshot, mode);
+
+            double saveTime    = 0.0;
+            double restoreTime = 0.0;
+            for (uint32_t i = 0; i < cIterations; i++)
+            {
+                auto start = Time::Now();
+                physics->SaveState(m_snapshot, mode);
+                saveTime += Time::Now() - start;
+
+                start = Time::Now();
+                physics->RestoreState(m_snapshot);
+                restoreTime += Time::Now() - start;
+            }
+
+            LOG_INFO(
+                "{} bodies, {}: {:.1f} KiB, save {:.3f}ms, restore {:.3f}ms",
+                count,
+                mode == SnapshotMode::Full ? "full" : "active",
+                static_cast<double>(m_snapshot.GetSize()) / 1024.0,
+                1000.0 * saveTime / cIterations,
+                1000.0 * restoreTime / cIterations
+            );
+        }
+    }
+
+    static constexpr uint32_t cWarmupTicks = 10;
+    static constexpr uint32_t cIterations  = 100;
+
+    std::array<uint32_t, 3>  m_bodyCounts = {1000, 10000, 50000};
+    size_t                   m_countIndex = 0;
+    uint32_t                 m_ticks      = 0;
+    std::vector<JPH::BodyID> m_bodies;
+    PhysicsSnapshot          m_snapshot;
+    JPH::ShapeRefC           m_sphereShape;
+    JPH::ShapeRefC           m_boxShape;
+};
+
+int main(int argc, char** argv)
+{
+    Log::SetLogLevel(LogLevel::Info);
+
+    auto code = LEGS_Init(argc, argv);
+    if (code < 0)
+    {
+        return code;
+    }
+
+    g_engine->GetWindow()->SetTitle("04_snapshot");
+
+    g_engine->AddSystem(std::make_shared<SnapshotBenchmark>());
+
+    return LEGS_Run();
+}
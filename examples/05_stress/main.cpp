@@ -0,0 +1,323 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <legs/entry.hpp>
+
+#include <legs/collider.hpp>
+#include <legs/entity/physics_entity.hpp>
+#include <legs/isystem.hpp>
+#include <legs/log.hpp>
+#include <legs/time.hpp>
+
+using namespace legs;
+
+// Physics scaling harness: drops a grid of sphere and box columns onto the ground so they collapse
+// into piles, then records the cost of every tick for a fixed duration and writes the results as
+// JSON. Bodies are plain PhysicsEntities so the transform sync of the world is measured as well.
+//
+// Arguments:
+//   --count <n>       number of dynamic bodies, half spheres and half boxes (default 10000)
+//   --height <n>      bodies per column (default 10)
+//   --threads <n>     physics worker threads, -1 for one per CPU (default -1)
+//   --duration <s>    measured seconds after the warmup (default 10)
+//   --output <path>   JSON results (default stress.json)
+//   --debug-physics   draw the bodies with the physics debug renderer
+struct StressSettings
+{
+    uint32_t    count    = 10000;
+    uint32_t    height   = 10;
+    int         threads  = -1;
+    double      duration = 10.0;
+    std::string output   = "stress.json";
+};
+
+struct TickSample
+{
+    double   updateTime;
+    double   syncTime;
+    double   workerUtilization;
+    uint32_t activeBodies;
+};
+
+class StressSystem : public ISystem
+{
+  public:
+    StressSystem(const StressSettings& settings) : m_settings(settings)
+    {
+        auto world   = g_engine->GetWorld();
+        auto physics = world->GetPhysics();
+        physics->SetNumThreads(m_settings.threads);
+
+        int width;
+        int height;
+        g_engine->GetWindow()->GetFramebufferSize(&width, &height);
+        m_camera = std::make_shared<NoclipCamera>(width, height);
+        g_engine->SetCamera(m_camera);
+
+        const auto columns = std::max(1u, m_settings.count / m_settings.height);
+        const auto rows    = std::sqrt(static_cast<float>(columns));
+        const auto side    = static_cast<uint32_t>(std::ceil(rows));
+        const auto extent  = static_cast<float>(side) * cSpacing;
+        m_camera->SetPosition({0.0f, -extent, 0.5f * extent});
+
+        auto ground = std::make_shared<PhysicsEntity>();
+        ground->SetPosition({0.0f, 0.0f, -1.0f});
+        ground->SetCollider(
+            BoxCollider(JPH::EMotionType::Static, Layers::NON_MOVING, {extent, extent, 1.0f})
+        );
+        world->AddEntity(ground);
+
+        // Columns are offset every other layer so they topple into piles instead of stacking.
+        auto sphereCollider = SphereCollider(JPH::EMotionType::Dynamic, Layers::MOVING, 0.5f);
+        auto boxCollider =
+            BoxCollider(JPH::EMotionType::Dynamic, Layers::MOVING, {0.5f, 0.5f, 0.5f});
+        for (uint32_t i = 0; i < m_settings.count; i++)
+        {
+            const auto column = i / m_settings.height;
+            const auto layer  = i % m_settings.height;
+            const auto offset = layer % 2 == 0 ? 0.0f : 0.3f;
+
+            auto body = std::make_shared<PhysicsEntity>();
+            body->SetPosition({
+                (static_cast<float>(column % side) - 0.5f * static_cast<float>(side)) * cSpacing
+                    + offset,
+                (static_cast<float>(column / side) - 0.5f * static_cast<float>(side)) * cSpacing,
+                1.0f + static_cast<float>(layer) * 1.1f,
+            });
+            if (column % 2 == 0)
+            {
+                body->SetCollider(sphereCollider);
+            }
+            else
+            {
+                body->SetCollider(boxCollider);
+            }
+            world->AddEntity(body);
+        }
+        physics->Optimize();
+
+        m_samples.reserve(static_cast<size_t>(m_settings.duration * Time::TickRate) + 1);
+
+        LOG_INFO(
+            "Simulating {} bodies in {} columns for {}s",
+            m_settings.count,
+            columns,
+            m_settings.duration
+        );
+    }
+
+    ~StressSystem()
+    {
+    }
+
+    void OnFrame() override
+    {
+        m_camera->HandleInput(g_engine->GetFrameInput());
+    }
+
+    void OnPhysicsEvents(std::span<const PhysicsEvent> /*events*/) override
+    {
+        if (m_done || ++m_ticks <= cWarmupTicks)
+        {
+            return;
+        }
+
+        // Busy time is only counted on the workers, the tick thread runs jobs while it waits too
+        // but isn't part of this.
+        const auto stats = g_engine->GetWorld()->GetPhysics()->GetStats();
+        const auto capacity =
+            stats.updateTime * static_cast<double>(std::max(1u, stats.numThreads));
+
+        m_samples.push_back({
+            .updateTime        = stats.updateTime,
+            .syncTime          = g_engine->GetWorld()->GetSyncTime(),
+            .workerUtilization = capacity > 0.0 ? stats.jobBusyTime / capacity : 0.0,
+            .activeBodies      = stats.numActiveBodies,
+        });
+        m_numThreads = stats.numThreads;
+
+        if (m_startTime == 0.0)
+        {
+            m_startTime = Time::Now();
+        }
+        else if (Time::Now() - m_startTime >= m_settings.duration)
+        {
+            WriteResults();
+            m_done = true;
+            g_engine->Quit();
+        }
+    }
+
+  private:
+    struct Summary
+    {
+        double mean;
+        double p50;
+        double p99;
+        double max;
+    };
+
+    template<typename T>
+    Summary Summarize(T TickSample::*field) const
+    {
+        std::vector<double> values;
+        values.reserve(m_samples.size());
+        for (const auto& sample : m_samples)
+        {
+            values.push_back(sample.*field);
+        }
+        std::ranges::sort(values);
+
+        double sum = 0.0;
+        for (auto value : values)
+        {
+            sum += value;
+        }
+
+        auto percentile = [&values](double p)
+        {
+            return values[static_cast<size_t>(p * static_cast<double>(values.size() - 1))];
+        };
+
+        return {
+            .mean = sum / static_cast<double>(values.size()),
+            .p50  = percentile(0.5),
+            .p99  = percentile(0.99),
+            .max  = values.back(),
+        };
+    }
+
+    static std::string SummaryJson(const Summary& summary, double scale)
+    {
+        return std::format(
+            R"({{"mean": {:.4f}, "p50": {:.4f}, "p99": {:.4f}, "max": {:.4f}}})",
+            summary.mean * scale,
+            summary.p50 * scale,
+            summary.p99 * scale,
+            summary.max * scale
+        );
+    }
+
+    void WriteResults() const
+    {
+        if (m_samples.empty())
+        {
+            LOG_ERROR("No samples recorded");
+            return;
+        }
+
+        const auto update      = Summarize(&TickSample::updateTime);
+        const auto sync        = Summarize(&TickSample::syncTime);
+        const auto utilization = Summarize(&TickSample::workerUtilization);
+        const auto active      = Summarize(&TickSample::activeBodies);
+
+        std::ofstream file(m_settings.output);
+        if (!file)
+        {
+            LOG_ERROR("Failed to open {}", m_settings.output);
+            return;
+        }
+
+        file << "{\n";
+        file << std::format("  \"bodies\": {},\n", m_settings.count);
+        file << std::format("  \"columnHeight\": {},\n", m_settings.height);
+        file << std::format("  \"hardwareThreads\": {},\n", std::thread::hardware_concurrency());
+        file << std::format("  \"workerThreads\": {},\n", m_numThreads);
+        file << std::format("  \"tickRate\": {},\n", Time::TickRate);
+        file << std::format("  \"ticks\": {},\n", m_samples.size());
+        file << std::format("  \"updateMs\": {},\n", SummaryJson(update, 1000.0));
+        file << std::format("  \"syncMs\": {},\n", SummaryJson(sync, 1000.0));
+        file << std::format("  \"workerUtilization\": {},\n", SummaryJson(utilization, 1.0));
+        file << std::format("  \"activeBodies\": {},\n", SummaryJson(active, 1.0));
+
+        file << "  \"samples\": [\n";
+        for (size_t i = 0; i < m_samples.size(); i++)
+        {
+            const auto& sample = m_samples[i];
+            file << std::format(
+                R"(    {{"updateMs": {:.4f}, "syncMs": {:.4f}, "workerUtilization": {:.3f}, )"
+                R"("activeBodies": {}}}{})",
+                sample.updateTime * 1000.0,
+                sample.syncTime * 1000.0,
+                sample.workerUtilization,
+                sample.activeBodies,
+                i + 1 < m_samples.size() ? ",\n" : "\n"
+            );
+        }
+        file << "  ]\n";
+        file << "}\n";
+
+        LOG_INFO(
+            "{} ticks, update {:.3f}ms (p99 {:.3f}ms), sync {:.3f}ms, worker utilization {:.0f}%",
+            m_samples.size(),
+            update.mean * 1000.0,
+            update.p99 * 1000.0,
+            sync.mean * 1000.0,
+            utilization.mean * 100.0
+        );
+        LOG_INFO("Wrote {}", m_settings.output);
+    }
+
+    // Skip the spawn hitches of the first ticks.
+    static constexpr uint32_t cWarmupTicks = 10;
+    static constexpr float    cSpacing     = 2.5f;
+
+    StressSettings                m_settings;
+    std::shared_ptr<NoclipCamera> m_camera;
+    std::vector<TickSample>       m_samples;
+    uint32_t                      m_ticks      = 0;
+    uint32_t                      m_numThreads = 0;
+    double                        m_startTime  = 0.0;
+    bool                          m_done       = false;
+};
+
+int main(int argc, char** argv)
+{
+    Log::SetLogLevel(LogLevel::Info);
+
+    StressSettings settings;
+    if (auto arg = GetLaunchArg("--count", argc, argv))
+    {
+        settings.count = static_cast<uint32_t>(std::strtoul(arg, nullptr, 10));
+    }
+    if (auto arg = GetLaunchArg("--height", argc, argv))
+    {
+        settings.height = std::max(1u, static_cast<uint32_t>(std::strtoul(arg, nullptr, 10)));
+    }
+    if (auto arg = GetLaunchArg("--threads", argc, argv))
+    {
+        settings.threads = static_cast<int>(std::strtol(arg, nullptr, 10));
+    }
+    if (auto arg = GetLaunchArg("--duration", argc, argv))
+    {
+        settings.duration = std::strtod(arg, nullptr);
+    }
+    if (auto arg = GetLaunchArg("--output", argc, argv))
+    {
+        settings.output = arg;
+    }
+
+    auto code = LEGS_Init(argc, argv);
+    if (code < 0)
+    {
+        return code;
+    }
+
+    g_engine->GetWindow()->SetTitle("05_stress");
+
+    g_engine->AddSystem(std::make_shared<StressSystem>(settings));
+
+    if (HasLaunchArg("--debug-physics", nullptr, argc, argv))
+    {
+        g_engine->GetWorld()->GetPhysics()->SetDebugDrawSettings({.enabled = true});
+    }
+
+    return LEGS_Run();
+}
@@ -0,0 +1,131 @@
+#include <memory>
+#include <vector>
+
+#include <legs/entry.hpp>
+
+#include <legs/entity/mesh_entity.hpp>
+#include <legs/entity/sky.hpp>
+#include <legs/geometry/icosphere.hpp>
+#include <legs/isystem.hpp>
+#include <legs/log.hpp>
+#include <legs/task.hpp>
+
+using namespace legs;
+
+// Geometry of a sphere, built on a background job.
+struct SphereGeometry
+{
+    std::vector<Vertex_P_N_C> vertices;
+    std::vector<Index>        indices;
+};
+
+Task<SphereGeometry> BuildSphere(float radius, unsigned int subdivisions)
+{
+    co_await g_engine->Schedule(JobPriority::Background);
+
+    auto           sphere = SIcosphere(glm::vec3(0, 0, 0), radius, subdivisions);
+    SphereGeometry geometry;
+    geometry.vertices.reserve(sphere.positions.size());
+    for (size_t i = 0; i < sphere.positions.size(); i++)
+    {
+        geometry.vertices.push_back(
+            {sphere.positions[i], sphere.normals[i], glm::vec3(0.2f, 0.6f, 0.9f)}
+        );
+    }
+    geometry.indices = std::move(sphere.indices);
+
+    co_return geometry;
+}
+
+// Spawns a grid of spheres without blocking any engine thread, then keeps running until the
+// engine is destroyed.
+Task<> SpawnSpheres()
+{
+    // Awaiting a task starts it, this one continues on the job the sphere finished on.
+    auto geometry = co_await BuildSphere(0.5f, 3);
+
+    // Uploads can be queued from any thread, the entities are drawn once they were flushed.
+    auto                    renderer = g_engine->GetRenderer();
+    std::shared_ptr<Buffer> vertexBuffer;
+    std::shared_ptr<Buffer> indexBuffer;
+    renderer->CreateBuffer(
+        vertexBuffer,
+        VertexBuffer,
+        geometry.vertices.data(),
+        sizeof(Vertex_P_N_C),
+        static_cast<uint32_t>(geometry.vertices.size())
+    );
+    renderer->CreateBuffer(
+        indexBuffer,
+        IndexBuffer,
+        geometry.indices.data(),
+        sizeof(Index),
+        static_cast<uint32_t>(geometry.indices.size())
+    );
+
+    auto world = g_engine->GetWorld();
+    for (int x = -5; x <= 5; x++)
+    {
+        for (int y = -5; y <= 5; y++)
+        {
+            auto sphere = std::make_shared<MeshEntity>();
+            sphere->SetBuffers(vertexBuffer, indexBuffer);
+            sphere->SetPipeline(RenderPipeline::GEO_P_N_C);
+            sphere->SetPosition(2.0f * glm::vec3(x, y, 0.5f));
+            world->AddEntity(sphere);
+        }
+    }
+
+    // Suspended here when the engine shuts down, the engine destroys the task then.
+    for (uint32_t frame = 1;; frame++)
+    {
+        co_await g_engine->NextFrame();
+        if (frame % 1000 == 0)
+        {
+            LOG_INFO("SpawnSpheres saw {} frames", frame);
+        }
+    }
+}
+
+class TasksSystem : public ISystem
+{
+  public:
+    TasksSystem()
+    {
+        int width;
+        int height;
+        g_engine->GetWindow()->GetFramebufferSize(&width, &height);
+        m_camera = std::make_shared<NoclipCamera>(width, height);
+        m_camera->SetPosition({0.0f, -20.0f, 10.0f});
+        g_engine->SetCamera(m_camera);
+
+        g_engine->GetWorld()->SetSky(std::make_shared<Sky>(g_engine->GetRenderer()));
+
+        g_engine->StartTask(SpawnSpheres());
+    }
+
+    void OnFrame() override
+    {
+        m_camera->HandleInput(g_engine->GetFrameInput());
+    }
+
+  private:
+    std::shared_ptr<NoclipCamera> m_camera;
+};
+
+int main(int argc, char** argv)
+{
+    Log::SetLogLevel(LogLevel::Debug);
+
+    auto code = LEGS_Init(argc, argv);
+    if (code < 0)
+    {
+        return code;
+    }
+
+    g_engine->GetWindow()->SetTitle("06_tasks");
+
+    g_engine->AddSystem(std::make_shared<TasksSystem>());
+
+    return LEGS_Run();
+}
@@ -3,6 +3,8 @@
 set -euo pipefail
 
 mode=${1:-"Debug"}
+# ON to keep the debug renderer in Distribution builds, see the physics_debug_renderer option.
+debug_renderer=${2:-"OFF"}
 
 CWD="$(pwd)"
 
@@ -15,7 +17,8 @@ rm -rf Linux_Distribution
 
 ./cmake_linux_clang_gcc.sh "$mode" clang++ \
     -DBUILD_SHARED_LIBS=ON \
-    -DCPP_RTTI_ENABLED=ON
+    -DCPP_RTTI_ENABLED=ON \
+    -DDEBUG_RENDERER_IN_DISTRIBUTION="$debug_renderer"
 
 cd "Linux_$mode"
 
@@ -0,0 +1,301 @@
+#include <algorithm>
+#include <format>
+#include <fstream>
+#include <map>
+#include <set>
+#include <utility>
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <legs/log.hpp>
+
+#include "cpu_topology.hpp"
+
+namespace legs
+{
+static const std::string cCpuPath = "/sys/devices/system/cpu";
+
+// First line of a sysfs file, empty if it doesn't exist.
+static std::string ReadLine(const std::string& path)
+{
+    std::ifstream file(path);
+    std::string   line;
+    std::getline(file, line);
+    return line;
+}
+
+static int ReadInt(const std::string& path, int fallback)
+{
+    const auto line = ReadLine(path);
+    if (line.empty())
+    {
+        return fallback;
+    }
+
+    try
+    {
+        return std::stoi(line);
+    }
+    catch (const std::exception&)
+    {
+        return fallback;
+    }
+}
+
+// CPU list format, e.g. "0-3,8,10-11".
+static std::vector<int> ParseCpuList(const std::string& list)
+{
+    std::vector<int> cpus;
+    size_t           pos = 0;
+    while (pos < list.size())
+    {
+        auto end = list.find(',', pos);
+        if (end == std::string::npos)
+        {
+            end = list.size();
+        }
+
+        const auto range = list.substr(pos, end - pos);
+        const auto dash  = range.find('-');
+        try
+        {
+            const int first = std::stoi(range.substr(0, dash));
+            const int last  = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            for (int cpu = first; cpu <= last; cpu++)
+            {
+                cpus.push_back(cpu);
+            }
+        }
+        catch (const std::exception&)
+        {
+        }
+
+        pos = end + 1;
+    }
+    return cpus;
+}
+
+static int GetL3Domain(int cpu)
+{
+    for (int index = 0;; index++)
+    {
+        const auto cachePath = std::format("{}/cpu{}/cache/index{}", cCpuPath, cpu, index);
+        const int  level     = ReadInt(cachePath + "/level", -1);
+        if (level < 0)
+        {
+            return -1;
+        }
+        if (level == 3)
+        {
+            const auto shared = ParseCpuList(ReadLine(cachePath + "/shared_cpu_list"));
+            return shared.empty() ? -1 : shared.front();
+        }
+    }
+}
+
+CpuTopology CpuTopology::Detect()
+{
+    CpuTopology topology;
+
+    auto online = ParseCpuList(ReadLine(cCpuPath + "/online"));
+    if (online.empty())
+    {
+        LOG_WARN("Failed to read CPU topology");
+        return topology;
+    }
+
+    // Intel hybrid CPUs list their efficiency cores separately.
+    const auto atomCpus = ParseCpuList(ReadLine("/sys/devices/cpu_atom/cpus"));
+
+    std::map<std::pair<int, int>, CpuCore> cores;
+    std::map<int, int>                     capacity;
+    int                                    maxCapacity = 0;
+    for (int cpu : online)
+    {
+        const auto path    = std::format("{}/cpu{}/topology", cCpuPath, cpu);
+        const int  package = ReadInt(path + "/physical_package_id", 0);
+        const int  core    = ReadInt(path + "/core_id", cpu);
+
+        auto& entry = cores[{package, core}];
+        entry.cpus.push_back(cpu);
+        if (entry.cpus.size() == 1)
+        {
+            entry.l3Domain = GetL3Domain(cpu);
+        }
+
+        // Capacity on big.LITTLE, max frequency elsewhere.
+        int cpuCapacity = ReadInt(std::format("{}/cpu{}/cpu_capacity", cCpuPath, cpu), -1);
+        if (cpuCapacity < 0)
+        {
+            cpuCapacity =
+                ReadInt(std::format("{}/cpu{}/cpufreq/cpuinfo_max_freq", cCpuPath, cpu), 0);
+        }
+        capacity[cpu] = cpuCapacity;
+        maxCapacity   = std::max(maxCapacity, cpuCapacity);
+    }
+
+    for (auto& [id, core] : cores)
+    {
+        const int first = core.cpus.front();
+        if (!atomCpus.empty())
+        {
+            core.performance = !std::ranges::contains(atomCpus, first);
+        }
+        else if (maxCapacity > 0)
+        {
+            // Preferred cores of one type differ slightly in frequency, efficiency cores a lot.
+            core.performance = capacity[first] * 10 >= maxCapacity * 8;
+        }
+        topology.m_cores.push_back(std::move(core));
+    }
+
+    return topology;
+}
+
+size_t CpuTopology::GetNumCpus() const
+{
+    size_t count = 0;
+    for (const auto& core : m_cores)
+    {
+        count += core.cpus.size();
+    }
+    return count;
+}
+
+ThreadPlacement CpuTopology::Place(const ThreadSettings& settings) const
+{
+    ThreadPlacement placement;
+
+    cpu_set_t processSet;
+    CPU_ZERO(&processSet);
+    if (sched_getaffinity(0, sizeof(processSet), &processSet) == 0)
+    {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+        {
+            if (CPU_ISSET(static_cast<size_t>(cpu), &processSet))
+            {
+                placement.processCpus.push_back(cpu);
+            }
+        }
+    }
+
+    if (!settings.pinThreads)
+    {
+        return placement;
+    }
+
+    // Performance cores first, keep the engine threads in one L3 domain if possible.
+    std::vector<const CpuCore*> cores;
+    for (const auto& core : m_cores)
+    {
+        cores.push_back(&core);
+    }
+    auto order = [](const CpuCore* core) { return std::pair(!core->performance, core->l3Domain); };
+    std::ranges::stable_sort(cores, {}, order);
+
+    std::set<int> reserved;
+    auto          reserve = [&](int requested) -> int
+    {
+        if (requested >= 0)
+        {
+            // Keep workers off the SMT siblings of requested CPUs as well.
+            reserved.insert(requested);
+            for (const auto& core : m_cores)
+            {
+                if (std::ranges::find(core.cpus, requested) != core.cpus.end())
+                {
+                    reserved.insert(core.cpus.begin(), core.cpus.end());
+                }
+            }
+            return requested;
+        }
+
+        for (const auto* core : cores)
+        {
+            if (!reserved.contains(core->cpus.front()))
+            {
+                // Siblings stay free of workers, but another engine thread never shares the core.
+                for (int cpu : core->cpus)
+                {
+                    reserved.insert(cpu);
+                }
+                return core->cpus.front();
+            }
+        }
+        return -1;
+    };
+
+    // Leave at least one core to the workers.
+    const bool autoEngineCpus = m_cores.size() >= 4;
+    placement.mainCpu = autoEngineCpus || settings.mainCpu >= 0 ? reserve(settings.mainCpu) : -1;
+    placement.tickCpu = autoEngineCpus || settings.tickCpu >= 0 ? reserve(settings.tickCpu) : -1;
+    placement.renderCpu =
+        autoEngineCpus || settings.renderCpu >= 0 ? reserve(settings.renderCpu) : -1;
+
+    if (!settings.workerCpus.empty())
+    {
+        placement.workerCpus = settings.workerCpus;
+    }
+    else if (!reserved.empty())
+    {
+        for (const auto& core : m_cores)
+        {
+            for (int cpu : core.cpus)
+            {
+                if (!reserved.contains(cpu))
+                {
+                    placement.workerCpus.push_back(cpu);
+                }
+            }
+        }
+    }
+
+    return placement;
+}
+
+std::string CpuTopology::ToString() const
+{
+    size_t numPerformance = 0;
+    for (const auto& core : m_cores)
+    {
+        numPerformance += core.performance ? 1 : 0;
+    }
+
+    std::set<int> domains;
+    for (const auto& core : m_cores)
+    {
+        domains.insert(core.l3Domain);
+    }
+
+    return std::format(
+        "{} CPUs, {} cores ({} performance), {} L3 domains",
+        GetNumCpus(),
+        m_cores.size(),
+        numPerformance,
+        domains.size()
+    );
+}
+
+bool SetCurrentThreadAffinity(std::span<const int> cpus)
+{
+    if (cpus.empty())
+    {
+        return true;
+    }
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus)
+    {
+        CPU_SET(static_cast<size_t>(cpu), &set);
+    }
+
+    if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+    {
+        LOG_WARN("Failed to set thread affinity");
+        return false;
+    }
+    return true;
+}
+}; // namespace legs
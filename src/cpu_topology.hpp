@@ -0,0 +1,61 @@
+#pragma once
+
+#include <span>
+#include <string>
+#include <vector>
+
+#include <legs/engine_settings.hpp>
+
+namespace legs
+{
+// Logical CPUs sharing one physical core.
+struct CpuCore
+{
+    std::vector<int> cpus;
+    // False for the efficiency cores of hybrid CPUs.
+    bool performance = true;
+    // Lowest CPU sharing the L3 cache with this core, -1 if unknown.
+    int l3Domain = -1;
+};
+
+// Where the engine threads run, -1 / empty for no affinity.
+struct ThreadPlacement
+{
+    int              mainCpu   = -1;
+    int              tickCpu   = -1;
+    int              renderCpu = -1;
+    std::vector<int> workerCpus;
+    // Affinity of the process before any pinning, for threads without a placement.
+    std::vector<int> processCpus;
+
+    // CPUs of a thread placed on cpu, or the whole process if it has no placement.
+    std::span<const int> GetThreadCpus(const int& cpu) const
+    {
+        return cpu < 0 ? std::span<const int>(processCpus) : std::span<const int>(&cpu, 1);
+    }
+};
+
+// CPU topology of the machine as reported by /sys/devices/system/cpu.
+class CpuTopology
+{
+  public:
+    static CpuTopology Detect();
+
+    ThreadPlacement Place(const ThreadSettings& settings) const;
+
+    std::span<const CpuCore> GetCores() const
+    {
+        return m_cores;
+    }
+
+    size_t GetNumCpus() const;
+
+    std::string ToString() const;
+
+  private:
+    std::vector<CpuCore> m_cores;
+};
+
+// Restrict the calling thread to the given CPUs, does nothing for an empty list.
+bool SetCurrentThreadAffinity(std::span<const int> cpus);
+}; // namespace legs
@@ -5,6 +5,8 @@
 
 #include <imgui.h>
 
+#include "cpu_topology.hpp"
+#include "job_system_thread_pool.hpp"
 #include "physics.hpp"
 
 #include "legs/engine.hpp"
@@ -14,13 +16,30 @@
 
 namespace legs
 {
-Engine::Engine()
+// Jobs in flight outside of the physics update.
+static constexpr uint cMaxEngineJobs = 1024;
+
+// Barriers outside of the physics update, like parallel draw recording.
+static constexpr uint cMaxEngineBarriers = 4;
+
+Engine::Engine(const EngineSettings& settings)
 {
     LOG_INFO("Creating Engine");
 
+    const auto topology = CpuTopology::Detect();
+    m_threadPlacement   = std::make_unique<ThreadPlacement>(topology.Place(settings.threads));
+    LOG_INFO("CPU topology: {}", topology.ToString());
+    LOG_DEBUG(
+        "Thread placement: main {}, tick {}, render {}, {} worker CPUs",
+        m_threadPlacement->mainCpu,
+        m_threadPlacement->tickCpu,
+        m_threadPlacement->renderCpu,
+        m_threadPlacement->workerCpus.size()
+    );
+
     m_inputSettings = std::make_shared<InputSettings>();
     m_window        = std::make_shared<Window>(m_inputSettings);
-    m_renderer      = std::make_shared<Renderer>(m_window);
+    m_renderer      = std::make_shared<Renderer>(m_window, settings.framesInFlight);
 
     int width;
     int height;
@@ -30,7 +49,33 @@ Engine::Engine()
     m_ui = std::make_unique<UI>(m_window, m_renderer);
 
     Physics::Register();
-    m_world = std::make_shared<World>(m_renderer);
+
+    int numWorkers = settings.threads.numWorkers;
+    if (numWorkers < 0)
+    {
+        numWorkers = m_threadPlacement->workerCpus.empty()
+            ? static_cast<int>(std::thread::hardware_concurrency()) - 1
+            : static_cast<int>(m_threadPlacement->workerCpus.size());
+    }
+    m_jobSystem = std::make_shared<JobSystemThreadPool>();
+    const auto& workerCpus = m_threadPlacement->workerCpus.empty()
+        ? m_threadPlacement->processCpus
+        : m_threadPlacement->workerCpus;
+    m_jobSystem->SetThreadInitFunction(
+        [cpus = workerCpus](int) { SetCurrentThreadAffinity(cpus); }
+    );
+    m_jobSystem->Init(
+        JPH::cMaxPhysicsJobs + cMaxEngineJobs,
+        JPH::cMaxPhysicsBarriers + cMaxEngineBarriers,
+        numWorkers
+    );
+    if (settings.jobFibers)
+    {
+        m_jobSystem->SetUseFibers(true);
+    }
+    m_renderer->SetJobSystem(m_jobSystem);
+
+    m_world = std::make_shared<World>(m_renderer, m_jobSystem);
 
     m_window->SetMouseGrab(true);
 
@@ -45,6 +90,10 @@ Engine::Engine()
 
     m_tickThread   = std::jthread {std::bind_front(&Engine::TickThread, this)};
     m_renderThread = std::jthread {std::bind_front(&Engine::RenderThread, this)};
+
+    // Last, threads inherit the affinity of the thread creating them. SDL, driver and engine
+    // threads started above keep the whole process, engine threads also set their own.
+    SetCurrentThreadAffinity(m_threadPlacement->GetThreadCpus(m_threadPlacement->mainCpu));
 }
 
 Engine::~Engine()
@@ -63,6 +112,154 @@ Engine::~Engine()
 
     LOG_DEBUG("Waiting for renderer idle");
     m_renderer->WaitForIdle();
+
+    // Nothing resumes the suspended tasks anymore once the workers stopped, their queued jobs are
+    // dropped with them.
+    LOG_DEBUG("Destroying suspended tasks");
+    m_jobSystem->SetNumThreads(0);
+    m_frameWaiters.TakeAll();
+    m_physicsWaiters.TakeAll();
+    {
+        std::scoped_lock lock(m_timelineMutex);
+        m_timelineWaiters.clear();
+    }
+    m_detachedTasks.DestroyAll();
+}
+
+JPH::JobHandle Engine::CreateJob(
+    const char*           name,
+    JobPriority           priority,
+    std::function<void()> function,
+    const JobCancelToken& cancelToken
+)
+{
+    auto job = [function = std::move(function), cancelToken]()
+    {
+        if (!cancelToken.IsCancelled())
+        {
+            function();
+        }
+    };
+
+    auto handle = m_jobSystem->CreateJob(name, JPH::Color::sGrey, job, priority);
+
+    // Without workers nothing would pick the job up.
+    if (m_jobSystem->GetMaxConcurrency() == 1)
+    {
+        handle.GetPtr()->Execute();
+    }
+
+    return handle;
+}
+
+JPH::JobHandle Engine::CreateJob(
+    const char*           name,
+    JobPriority           priority,
+    std::function<void()> function,
+    JobCounter&           counter,
+    const JobCancelToken& cancelToken
+)
+{
+    m_jobSystem->AddToCounter(counter, 1);
+
+    // The counter can't complete before this job signals it, and SignalCounter holds on to it
+    // until any waiter may return, so referencing it here is safe.
+    auto job = [this, function = std::move(function), &counter, cancelToken]()
+    {
+        if (!cancelToken.IsCancelled())
+        {
+            function();
+        }
+        m_jobSystem->SignalCounter(counter);
+    };
+
+    return CreateJob(name, priority, job);
+}
+
+JobSystemStats Engine::GetJobStats() const
+{
+    return m_jobSystem->GetStats();
+}
+
+void Engine::WaitForCounter(JobCounter& counter)
+{
+    m_jobSystem->WaitForCounter(counter);
+}
+
+void Engine::SetJobFibers(bool enabled)
+{
+    m_jobSystem->SetUseFibers(enabled);
+}
+
+void Engine::StartTask(Task<> task)
+{
+    ResumeOnJob(task.Detach(&m_detachedTasks), JobPriority::Normal);
+}
+
+JobAwaiter Engine::Schedule(JobPriority priority)
+{
+    return JobAwaiter {this, priority};
+}
+
+TaskWaitList::Awaiter Engine::NextFrame()
+{
+    return m_frameWaiters.Wait();
+}
+
+TaskWaitList::Awaiter Engine::NextPhysicsStep()
+{
+    return m_physicsWaiters.Wait();
+}
+
+TimelineAwaiter Engine::WaitForTimeline(const QueueTimeline& timeline, uint64_t value)
+{
+    return TimelineAwaiter {this, &timeline, value};
+}
+
+void Engine::ResumeOnJob(std::coroutine_handle<> handle, JobPriority priority)
+{
+    CreateJob("Task", priority, [handle]() { handle.resume(); });
+}
+
+void Engine::ResumeWaitList(TaskWaitList& list)
+{
+    for (auto handle : list.TakeAll())
+    {
+        ResumeOnJob(handle, JobPriority::Normal);
+    }
+}
+
+void Engine::PollTimelines()
+{
+    std::scoped_lock lock(m_timelineMutex);
+    std::erase_if(
+        m_timelineWaiters,
+        [this](const auto& waiter)
+        {
+            if (!waiter.first.timeline->IsComplete(waiter.first.value))
+            {
+                return false;
+            }
+            ResumeOnJob(waiter.second, JobPriority::Normal);
+            return true;
+        }
+    );
+}
+
+void JobAwaiter::await_suspend(std::coroutine_handle<> handle) const
+{
+    engine->ResumeOnJob(handle, priority);
+}
+
+bool TimelineAwaiter::await_ready() const
+{
+    return timeline->IsComplete(value);
+}
+
+void TimelineAwaiter::await_suspend(std::coroutine_handle<> handle) const
+{
+    std::scoped_lock lock(engine->m_timelineMutex);
+    engine->m_timelineWaiters.emplace_back(*this, handle);
 }
 
 int Engine::Run()
@@ -168,7 +365,7 @@ void Engine::Frame()
 
 bool Engine::Tick()
 {
-    if (m_tickInput.wantsQuit)
+    if (m_tickInput.wantsQuit || m_wantsQuit)
     {
         return false;
     }
@@ -189,6 +386,13 @@ bool Engine::Tick()
 
     Time::UpdateTickDelta();
 
+    // The main thread moves the camera, the tick thread only sees this copy.
+    m_tickObserver.reset();
+    if (m_camera != nullptr)
+    {
+        m_tickObserver = m_camera->Transform->position;
+    }
+
     // Allow tick thread to run.
     m_threadTickSemaphore.release();
 
@@ -204,6 +408,7 @@ void Engine::UpdateInput()
 void Engine::TickThread(const std::stop_token token)
 {
     LOG_INFO("Enter TickThread");
+    SetCurrentThreadAffinity(m_threadPlacement->GetThreadCpus(m_threadPlacement->tickCpu));
 
     while (!token.stop_requested())
     {
@@ -217,7 +422,20 @@ void Engine::TickThread(const std::stop_token token)
 
         if (m_world != nullptr)
         {
+            auto physics = m_world->GetPhysics();
+            if (m_tickObserver.has_value() && physics->GetLodSettings().observeCamera)
+            {
+                physics->SetLodObservers({&*m_tickObserver, 1});
+            }
+
             m_world->Tick();
+            ResumeWaitList(m_physicsWaiters);
+
+            const auto events = physics->GetEvents();
+            for (auto system : m_systems)
+            {
+                system->OnPhysicsEvents(events);
+            }
         }
 
         m_tickInput.Clear();
@@ -230,6 +448,7 @@ void Engine::TickThread(const std::stop_token token)
 void Engine::RenderThread(const std::stop_token token)
 {
     LOG_INFO("Enter RenderThread");
+    SetCurrentThreadAffinity(m_threadPlacement->GetThreadCpus(m_threadPlacement->renderCpu));
 
     while (!token.stop_requested())
     {
@@ -241,6 +460,8 @@ void Engine::RenderThread(const std::stop_token token)
         if (m_window->IsMinimized())
         {
             Time::StopRender();
+            ResumeWaitList(m_frameWaiters);
+            PollTimelines();
             m_mainFrameSemaphore.release();
             continue;
         }
@@ -273,6 +494,7 @@ void Engine::RenderThread(const std::stop_token token)
             m_world->Render();
         }
 
+        m_ui->SetJobStats(m_jobSystem->GetStats());
         m_ui->Render();
 
         m_renderer->Submit();
@@ -281,6 +503,9 @@ void Engine::RenderThread(const std::stop_token token)
 
         Time::StopRender();
 
+        ResumeWaitList(m_frameWaiters);
+        PollTimelines();
+
         // Let main thread know we are done.
         m_mainFrameSemaphore.release();
     }
@@ -2,11 +2,15 @@
 // SPDX-FileCopyrightText: 2021 Jorrit Rouwe
 // SPDX-License-Identifier: MIT
 
+#include <stdexcept>
+
 #include <Jolt/Jolt.h>
 
 #include <Jolt/Core/FPException.h>
 #include <Jolt/Core/Profiler.h>
 
+#include <legs/log.hpp>
+
 #include "job_system_thread_pool.hpp"
 
 #ifdef JPH_PLATFORM_LINUX
@@ -17,6 +21,11 @@ using namespace JPH;
 
 namespace legs
 {
+static uint64_t ElapsedNanoseconds(std::chrono::steady_clock::time_point inStart)
+{
+    const auto elapsed = std::chrono::steady_clock::now() - inStart;
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+}
 
 void JobSystemThreadPool::Init(uint inMaxJobs, uint inMaxBarriers, int inNumThreads)
 {
@@ -25,10 +34,13 @@ void JobSystemThreadPool::Init(uint inMaxJobs, uint inMaxBarriers, int inNumThre
     // Init freelist of jobs
     mJobs.Init(inMaxJobs, inMaxJobs);
 
-    // Init queue
-    for (std::atomic<Job*>& j : mQueue)
+    // Init queues
+    for (Queue& queue : mQueues)
     {
-        j = nullptr;
+        for (std::atomic<Job*>& j : queue.mRing)
+        {
+            j = nullptr;
+        }
     }
 
     // Start the worker threads
@@ -42,6 +54,8 @@ JobSystemThreadPool::JobSystemThreadPool(uint inMaxJobs, uint inMaxBarriers, int
 
 void JobSystemThreadPool::StartThreads([[maybe_unused]] int inNumThreads)
 {
+    mNumThreads = inNumThreads;
+
 #if !defined(JPH_CPU_WASM) \
     || defined(__EMSCRIPTEN_PTHREADS__) // If we're running without threads support we cannot create
                                         // threads and we ignore the inNumThreads parameter
@@ -60,15 +74,22 @@ void JobSystemThreadPool::StartThreads([[maybe_unused]] int inNumThreads)
     // Don't quit the threads
     mQuit = false;
 
-    // Allocate heads
+    // Allocate heads, one per thread and queue
+    const uint numHeads = uint(inNumThreads) * cNumJobPriorities;
     mHeads =
-        reinterpret_cast<std::atomic<uint>*>(JPH::Allocate(sizeof(std::atomic<uint>) * inNumThreads)
-        );
-    for (int i = 0; i < inNumThreads; ++i)
+        reinterpret_cast<std::atomic<uint>*>(JPH::Allocate(sizeof(std::atomic<uint>) * numHeads));
+    for (uint i = 0; i < numHeads; ++i)
     {
         mHeads[i] = 0;
     }
 
+    // Keep a worker free for higher priority jobs
+    mMaxBackgroundRunning = inNumThreads - 1;
+
+    // Fresh counters per worker
+    mWorkerCounters    = std::make_unique<WorkerCounters[]>(size_t(inNumThreads));
+    mNumWorkerCounters = uint(inNumThreads);
+
     // Start running threads
     JPH_ASSERT(mThreads.empty());
     mThreads.reserve(inNumThreads);
@@ -83,6 +104,27 @@ JobSystemThreadPool::~JobSystemThreadPool()
 {
     // Stop all worker threads
     StopThreads();
+
+    // Parked fibers never resume, their jobs are released so the job list is empty again.
+    // Objects on their stacks are not destroyed.
+    uint parked = 0;
+    for (const auto& fiber : mFibers)
+    {
+        if (fiber->mJob != nullptr)
+        {
+            fiber->mJob->Release();
+            fiber->mJob = nullptr;
+            parked++;
+        }
+    }
+    if (parked > 0)
+    {
+        LOG_WARN("Destroying job system with {} parked jobs", parked);
+    }
+
+    mReadyFibers.clear();
+    mFreeFibers.clear();
+    mFibers.clear();
 }
 
 void JobSystemThreadPool::StopThreads()
@@ -108,23 +150,28 @@ void JobSystemThreadPool::StopThreads()
     // Delete all threads
     mThreads.clear();
 
-    // Ensure that there are no lingering jobs in the queue
-    for (uint head = 0; head != mTail; ++head)
+    // Ensure that there are no lingering jobs in the queues
+    for (Queue& queue : mQueues)
     {
-        // Fetch job
-        Job* job_ptr = mQueue[head & (cQueueLength - 1)].exchange(nullptr);
-        if (job_ptr != nullptr)
+        for (uint head = 0; head != queue.mTail; ++head)
         {
-            // And execute it
-            job_ptr->Execute();
-            job_ptr->Release();
+            // Fetch job
+            Job* job_ptr = queue.mRing[head & (cQueueLength - 1)].exchange(nullptr);
+            if (job_ptr != nullptr)
+            {
+                // And execute it
+                job_ptr->Execute();
+                job_ptr->Release();
+            }
         }
+
+        // Reset tail
+        queue.mTail = 0;
     }
 
-    // Destroy heads and reset tail
+    // Destroy heads
     JPH::Free(mHeads);
     mHeads = nullptr;
-    mTail  = 0;
 }
 
 JPH::JobHandle JobSystemThreadPool::CreateJob(
@@ -133,6 +180,23 @@ JPH::JobHandle JobSystemThreadPool::CreateJob(
     const JobFunction& inJobFunction,
     uint32_t           inNumDependencies
 )
+{
+    return CreateJob(
+        inJobName,
+        inColor,
+        inJobFunction,
+        JobPriority::FrameCritical,
+        inNumDependencies
+    );
+}
+
+JPH::JobHandle JobSystemThreadPool::CreateJob(
+    const char*        inJobName,
+    JPH::ColorArg      inColor,
+    const JobFunction& inJobFunction,
+    JobPriority        inPriority,
+    uint32_t           inNumDependencies
+)
 {
     JPH_PROFILE_FUNCTION();
 
@@ -140,7 +204,14 @@ JPH::JobHandle JobSystemThreadPool::CreateJob(
     uint32_t index;
     for (;;)
     {
-        index = mJobs.ConstructObject(inJobName, inColor, this, inJobFunction, inNumDependencies);
+        index = mJobs.ConstructObject(
+            inJobName,
+            inColor,
+            this,
+            inJobFunction,
+            inNumDependencies,
+            inPriority
+        );
         if (index != AvailableJobs::cInvalidObjectIndex)
         {
             break;
@@ -165,16 +236,16 @@ JPH::JobHandle JobSystemThreadPool::CreateJob(
 
 void JobSystemThreadPool::FreeJob(Job* inJob)
 {
-    mJobs.DestructObject(inJob);
+    mJobs.DestructObject(static_cast<PriorityJob*>(inJob));
 }
 
-uint JobSystemThreadPool::GetHead() const
+uint JobSystemThreadPool::GetHead(uint inPriority) const
 {
     // Find the minimal value across all threads
-    uint head = mTail;
+    uint head = mQueues[inPriority].mTail;
     for (size_t i = 0; i < mThreads.size(); ++i)
     {
-        head = std::min(head, mHeads[i].load());
+        head = std::min(head, mHeads[i * cNumJobPriorities + inPriority].load());
     }
     return head;
 }
@@ -184,21 +255,24 @@ void JobSystemThreadPool::QueueJobInternal(Job* inJob)
     // Add reference to job because we're adding the job to the queue
     inJob->AddRef();
 
+    const uint priority = uint(static_cast<PriorityJob*>(inJob)->mPriority);
+    Queue&     queue    = mQueues[priority];
+
     // Need to read head first because otherwise the tail can already have passed the head
     // We read the head outside of the loop since it involves iterating over all threads and we only
     // need to update it if there's not enough space in the queue.
-    uint head = GetHead();
+    uint head = GetHead(priority);
 
     for (;;)
     {
         // Check if there's space in the queue
-        uint old_value = mTail;
+        uint old_value = queue.mTail;
         if (old_value - head >= cQueueLength)
         {
             // We calculated the head outside of the loop, update head (and we also need to update
             // tail to prevent it from passing head)
-            head      = GetHead();
-            old_value = mTail;
+            head      = GetHead(priority);
+            old_value = queue.mTail;
 
             // Second check if there's space in the queue
             if (old_value - head >= cQueueLength)
@@ -209,19 +283,23 @@ void JobSystemThreadPool::QueueJobInternal(Job* inJob)
 
                 // Sleep a little (we have to wait for other threads to update their head pointer in
                 // order for us to be able to continue)
+                JPH_PROFILE("Queue Full");
+                const auto start = std::chrono::steady_clock::now();
                 std::this_thread::sleep_for(std::chrono::microseconds(100));
+                mQueueFullNanoseconds += ElapsedNanoseconds(start);
+                mQueueFullCount++;
                 continue;
             }
         }
 
         // Write the job pointer if the slot is empty
         Job* expected_job = nullptr;
-        bool success =
-            mQueue[old_value & (cQueueLength - 1)].compare_exchange_strong(expected_job, inJob);
+        std::atomic<Job*>& slot    = queue.mRing[old_value & (cQueueLength - 1)];
+        bool               success = slot.compare_exchange_strong(expected_job, inJob);
 
         // Regardless of who wrote the slot, we will update the tail (if the successful thread got
         // scheduled out after writing the pointer we still want to be able to continue)
-        mTail.compare_exchange_strong(old_value, old_value + 1);
+        queue.mTail.compare_exchange_strong(old_value, old_value + 1);
 
         // If we successfully added our job we're done
         if (success)
@@ -274,6 +352,373 @@ void JobSystemThreadPool::QueueJobs(Job** inJobs, uint inNumJobs)
     mSemaphore.Release(std::min(inNumJobs, (uint)mThreads.size()));
 }
 
+JobSystemThreadPool::Job* JobSystemThreadPool::TakeJob(int inThreadIndex, bool& outIsBackground)
+{
+    for (uint priority = 0; priority < cNumJobPriorities; ++priority)
+    {
+        Queue&             queue      = mQueues[priority];
+        std::atomic<uint>& head       = GetThreadHead(inThreadIndex, priority);
+        const bool         background = priority == uint(JobPriority::Background);
+        if (background && !TryReserveBackground())
+        {
+            // Still move past the jobs other workers took, a lagging head keeps the queue full
+            while (head != queue.mTail && queue.mRing[head & (cQueueLength - 1)].load() == nullptr)
+            {
+                head++;
+            }
+            return nullptr;
+        }
+
+        while (head != queue.mTail)
+        {
+            // Exchange any job pointer we find with a nullptr
+            std::atomic<Job*>& job     = queue.mRing[head & (cQueueLength - 1)];
+            Job*               job_ptr = job.load() != nullptr ? job.exchange(nullptr) : nullptr;
+            head++;
+            if (job_ptr != nullptr)
+            {
+                outIsBackground = background;
+                return job_ptr;
+            }
+        }
+
+        if (background)
+        {
+            mNumBackgroundRunning--;
+        }
+    }
+    return nullptr;
+}
+
+bool JobSystemThreadPool::TryReserveBackground()
+{
+    // A single worker has none to spare, it still runs one background job at a time when the
+    // higher priority queues were empty. Nothing else would ever run them.
+    const int maxRunning = std::max(1, mMaxBackgroundRunning);
+
+    int running = mNumBackgroundRunning.load();
+    do
+    {
+        if (running >= maxRunning)
+        {
+            return false;
+        }
+    } while (!mNumBackgroundRunning.compare_exchange_weak(running, running + 1));
+    return true;
+}
+
+bool JobSystemThreadPool::RunNext(int inThreadIndex)
+{
+    WorkerCounters& counters = mWorkerCounters[size_t(inThreadIndex)];
+
+    Fiber* fiber = TakeReadyFiber();
+    if (fiber == nullptr)
+    {
+        bool background = false;
+        Job* job_ptr    = TakeJob(inThreadIndex, background);
+        if (job_ptr == nullptr)
+        {
+            return false;
+        }
+
+        if (!mUseFibers)
+        {
+            ExecuteJob(job_ptr);
+            counters.mJobsExecuted++;
+
+            if (background)
+            {
+                mNumBackgroundRunning--;
+            }
+            return true;
+        }
+
+        fiber              = AcquireFiber();
+        fiber->mJob        = job_ptr;
+        fiber->mBackground = background;
+    }
+    else
+    {
+        counters.mFibersResumed++;
+    }
+
+    // Run the fiber until its job finishes or waits
+    fiber->mState   = Fiber::State::Running;
+    sCurrentFiber() = fiber;
+    swapcontext(&sWorkerContext(), &fiber->mContext);
+    sCurrentFiber() = nullptr;
+
+    if (fiber->mState == Fiber::State::Finished)
+    {
+        counters.mJobsExecuted++;
+        if (fiber->mBackground)
+        {
+            mNumBackgroundRunning--;
+        }
+        ReleaseFiber(fiber);
+    }
+    else
+    {
+        // A waiting background job must not hold a background slot, the jobs it waits on may need
+        // it. Resumed fibers run before any queued job anyway.
+        if (fiber->mBackground)
+        {
+            fiber->mBackground = false;
+            mNumBackgroundRunning--;
+        }
+        ParkFiber(fiber);
+    }
+    return true;
+}
+
+void JobSystemThreadPool::FiberMain()
+{
+    for (;;)
+    {
+        Fiber* fiber = sCurrentFiber();
+        ExecuteJob(fiber->mJob);
+        fiber->mJob   = nullptr;
+        fiber->mState = Fiber::State::Finished;
+
+        // Reused for the next job, which continues the loop here
+        swapcontext(&fiber->mContext, &sWorkerContext());
+    }
+}
+
+void JobSystemThreadPool::ExecuteJob(Job* inJob)
+{
+    // An exception leaving the fiber entry would unwind into a context that doesn't exist. The job
+    // never completes, jobs depending on it don't run.
+    try
+    {
+        inJob->Execute();
+    }
+    catch (const std::exception& e)
+    {
+        LOG_ERROR("Job threw: {}", e.what());
+    }
+    catch (...)
+    {
+        LOG_ERROR("Job threw an unknown exception");
+    }
+    inJob->Release();
+}
+
+JobSystemThreadPool::Fiber*& JobSystemThreadPool::sCurrentFiber()
+{
+    static thread_local Fiber* fiber = nullptr;
+    return fiber;
+}
+
+ucontext_t& JobSystemThreadPool::sWorkerContext()
+{
+    static thread_local ucontext_t context;
+    return context;
+}
+
+int& JobSystemThreadPool::sWorkerIndex()
+{
+    static thread_local int index = -1;
+    return index;
+}
+
+JobSystemThreadPool::Fiber* JobSystemThreadPool::AcquireFiber()
+{
+    std::scoped_lock lock(mFiberMutex);
+    if (!mFreeFibers.empty())
+    {
+        Fiber* fiber = mFreeFibers.back();
+        mFreeFibers.pop_back();
+        return fiber;
+    }
+
+    auto fiber    = std::make_unique<Fiber>();
+    fiber->mStack = std::make_unique<std::byte[]>(cFiberStackSize);
+    if (getcontext(&fiber->mContext) != 0)
+    {
+        throw std::runtime_error("Failed to create job fiber");
+    }
+    fiber->mContext.uc_stack.ss_sp   = fiber->mStack.get();
+    fiber->mContext.uc_stack.ss_size = cFiberStackSize;
+    fiber->mContext.uc_link          = nullptr;
+    makecontext(&fiber->mContext, &FiberMain, 0);
+
+    mFibers.push_back(std::move(fiber));
+    return mFibers.back().get();
+}
+
+void JobSystemThreadPool::ReleaseFiber(Fiber* inFiber)
+{
+    std::scoped_lock lock(mFiberMutex);
+    mFreeFibers.push_back(inFiber);
+}
+
+void JobSystemThreadPool::ParkFiber(Fiber* inFiber)
+{
+    JobCounter& counter = *inFiber->mWaitCounter;
+    {
+        // SignalCounter takes the waiters under the same lock after the count reached zero, so
+        // either it sees this fiber or this sees the zero count
+        std::scoped_lock lock(counter.m_mutex);
+        if (counter.m_count.load(std::memory_order_acquire) != 0)
+        {
+            counter.m_waiters.push_back(inFiber);
+            return;
+        }
+    }
+    PushReadyFiber(inFiber);
+}
+
+void JobSystemThreadPool::PushReadyFiber(Fiber* inFiber)
+{
+    {
+        std::scoped_lock lock(mReadyMutex);
+        mReadyFibers.push_back(inFiber);
+        mNumReadyFibers++;
+    }
+    mSemaphore.Release();
+}
+
+JobSystemThreadPool::Fiber* JobSystemThreadPool::TakeReadyFiber()
+{
+    if (mNumReadyFibers.load() == 0)
+    {
+        return nullptr;
+    }
+
+    std::scoped_lock lock(mReadyMutex);
+    if (mReadyFibers.empty())
+    {
+        return nullptr;
+    }
+
+    Fiber* fiber = mReadyFibers.front();
+    mReadyFibers.pop_front();
+    mNumReadyFibers--;
+    return fiber;
+}
+
+double JobSystemThreadPool::GetBusyTime() const
+{
+    uint64_t busy = 0;
+    for (uint i = 0; i < mNumWorkerCounters; ++i)
+    {
+        busy += mWorkerCounters[i].mBusyNanoseconds.load(std::memory_order_relaxed);
+    }
+    return double(busy) * 1.0e-9;
+}
+
+JobSystemStats JobSystemThreadPool::GetStats() const
+{
+    JobSystemStats stats {};
+    stats.workers.reserve(mNumWorkerCounters);
+    for (uint i = 0; i < mNumWorkerCounters; ++i)
+    {
+        const WorkerCounters& counters = mWorkerCounters[i];
+        stats.workers.push_back({
+            .busyTime      = double(counters.mBusyNanoseconds.load()) * 1.0e-9,
+            .idleTime      = double(counters.mIdleNanoseconds.load()) * 1.0e-9,
+            .jobsExecuted  = counters.mJobsExecuted.load(),
+            .fibersResumed = counters.mFibersResumed.load(),
+        });
+    }
+
+    for (uint priority = 0; priority < cNumJobPriorities; ++priority)
+    {
+        stats.queueDepth[priority] = mQueues[priority].mTail - GetHead(priority);
+    }
+
+    stats.queueFullTime   = double(mQueueFullNanoseconds.load()) * 1.0e-9;
+    stats.queueFullCount  = mQueueFullCount.load();
+    stats.barrierWaitTime = GetBarrierWaitTime();
+    return stats;
+}
+
+void JobSystemThreadPool::AddToCounter(JobCounter& ioCounter, uint32_t inCount)
+{
+    ioCounter.m_count.fetch_add(inCount, std::memory_order_relaxed);
+}
+
+void JobSystemThreadPool::SignalCounter(JobCounter& ioCounter)
+{
+    // Only the decrement to zero takes the lock. Waiters take it before returning, so the counter
+    // can't be destroyed while the last job is still waking them up.
+    uint32_t count = ioCounter.m_count.load(std::memory_order_relaxed);
+    while (count > 1)
+    {
+        if (ioCounter.m_count.compare_exchange_weak(
+                count,
+                count - 1,
+                std::memory_order_acq_rel,
+                std::memory_order_relaxed
+            ))
+        {
+            return;
+        }
+    }
+
+    std::vector<void*> waiters;
+    {
+        std::scoped_lock lock(ioCounter.m_mutex);
+        if (ioCounter.m_count.fetch_sub(1, std::memory_order_acq_rel) != 1)
+        {
+            // Jobs were added meanwhile
+            return;
+        }
+        waiters.swap(ioCounter.m_waiters);
+
+        // Threads blocked outside of the job system
+        ioCounter.m_count.notify_all();
+    }
+
+    // Parked fibers only resume from here, after the counter was let go
+    for (void* waiter : waiters)
+    {
+        PushReadyFiber(static_cast<Fiber*>(waiter));
+    }
+}
+
+void JobSystemThreadPool::WaitForCounter(JobCounter& ioCounter)
+{
+    if (ioCounter.IsDone())
+    {
+        return;
+    }
+
+    // Park the job and give the worker to other jobs, resumes on any worker
+    if (Fiber* fiber = sCurrentFiber(); fiber != nullptr)
+    {
+        fiber->mState       = Fiber::State::Waiting;
+        fiber->mWaitCounter = &ioCounter;
+        swapcontext(&fiber->mContext, &sWorkerContext());
+        fiber->mWaitCounter = nullptr;
+        return;
+    }
+
+    // Without fibers a worker runs other jobs while waiting, blocking could starve the counter
+    if (const int worker = sWorkerIndex(); worker >= 0)
+    {
+        while (!ioCounter.IsDone())
+        {
+            if (!RunNext(worker))
+            {
+                std::this_thread::yield();
+            }
+        }
+        return;
+    }
+
+    uint32_t count = ioCounter.m_count.load(std::memory_order_acquire);
+    while (count != 0)
+    {
+        ioCounter.m_count.wait(count, std::memory_order_acquire);
+        count = ioCounter.m_count.load(std::memory_order_acquire);
+    }
+
+    // Woken while the last job still holds the lock
+    std::scoped_lock lock(ioCounter.m_mutex);
+}
+
 static void SetThreadName(const char* inName)
 {
     JPH_ASSERT(strlen(inName) < 16); // String will be truncated if it is longer
@@ -299,36 +744,36 @@ void JobSystemThreadPool::ThreadMain(int inThreadIndex)
     // Call the thread init function
     mThreadInitFunction(inThreadIndex);
 
-    std::atomic<uint>& head = mHeads[inThreadIndex];
+    sWorkerIndex() = inThreadIndex;
+
+    WorkerCounters& counters = mWorkerCounters[size_t(inThreadIndex)];
 
     while (!mQuit)
     {
         // Wait for jobs
-        mSemaphore.Acquire();
+        {
+            JPH_PROFILE("Sleeping");
+            const auto start = std::chrono::steady_clock::now();
+            mSemaphore.Acquire();
+            counters.mIdleNanoseconds += ElapsedNanoseconds(start);
+        }
 
         {
             JPH_PROFILE("Executing Jobs");
 
-            // Loop over the queue
-            while (head != mTail)
+            const auto start = std::chrono::steady_clock::now();
+
+            // Run until the queues are empty, checking the higher priorities after every job
+            while (RunNext(inThreadIndex))
             {
-                // Exchange any job pointer we find with a nullptr
-                std::atomic<Job*>& job = mQueue[head & (cQueueLength - 1)];
-                if (job.load() != nullptr)
-                {
-                    Job* job_ptr = job.exchange(nullptr);
-                    if (job_ptr != nullptr)
-                    {
-                        // And execute it
-                        job_ptr->Execute();
-                        job_ptr->Release();
-                    }
-                }
-                head++;
             }
+
+            counters.mBusyNanoseconds += ElapsedNanoseconds(start);
         }
     }
 
+    sWorkerIndex() = -1;
+
     // Call the thread exit function
     mThreadExitFunction(inThreadIndex);
 
@@ -4,8 +4,14 @@
 
 #pragma once
 
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <thread>
 
+#include <ucontext.h>
+
+#include <legs/jobs.hpp>
 #include <legs/jolt_pch.hpp>
 
 #include "job_system_with_barrier.hpp"
@@ -18,6 +24,12 @@ namespace legs
 /// Note that this is considered an example implementation. It is expected that when you integrate
 /// the physics engine into your own project that you'll provide your own implementation of the
 /// JobSystem built on top of whatever job system your project uses.
+///
+/// Jobs are queued in one ring per JobPriority. Jobs created through the JobSystem interface (the
+/// physics update) are frame critical.
+///
+/// With fibers enabled every job runs on its own stack, so a job waiting on a JobCounter is parked
+/// and its worker continues with other jobs. Parked jobs resume before any queued job.
 class JobSystemThreadPool final : public JobSystemWithBarrier
 {
   public:
@@ -61,6 +73,15 @@ class JobSystemThreadPool final : public JobSystemWithBarrier
         uint32_t           inNumDependencies = 0
     ) override;
 
+    /// Create a job in the queue of a priority class
+    JobHandle CreateJob(
+        const char*        inName,
+        JPH::ColorArg      inColor,
+        const JobFunction& inJobFunction,
+        JobPriority        inPriority,
+        uint32_t           inNumDependencies = 0
+    );
+
     /// Change the max concurrency after initialization
     void SetNumThreads(int inNumThreads)
     {
@@ -68,6 +89,28 @@ class JobSystemThreadPool final : public JobSystemWithBarrier
         StartThreads(inNumThreads);
     }
 
+    /// Run jobs on fibers, restarts the worker threads. No job may be waiting on a counter.
+    void SetUseFibers(bool inUseFibers)
+    {
+        StopThreads();
+        mUseFibers = inUseFibers;
+        StartThreads(mNumThreads);
+    }
+
+    /// Count jobs in a counter, signal every one of them when it completes
+    void AddToCounter(JobCounter& ioCounter, uint32_t inCount);
+    void SignalCounter(JobCounter& ioCounter);
+
+    /// Wait until the counter is zero. Jobs on a fiber yield their worker, other workers run jobs
+    /// while waiting and any other thread blocks.
+    void WaitForCounter(JobCounter& ioCounter);
+
+    /// Total time the worker threads have spent executing jobs, in seconds
+    double GetBusyTime() const;
+
+    /// Snapshot of the counters, must not be called while the worker threads are restarted
+    JobSystemStats GetStats() const;
+
   protected:
     // See JobSystem
     virtual void QueueJob(Job* inJob) override;
@@ -82,38 +125,158 @@ class JobSystemThreadPool final : public JobSystemWithBarrier
     /// Entry point for a thread
     void ThreadMain(int inThreadIndex);
 
-    /// Get the head of the thread that has processed the least amount of jobs
-    inline uint GetHead() const;
+    /// Execute one ready fiber or queued job on a worker, false if there was nothing to run
+    bool RunNext(int inThreadIndex);
+
+    /// Job running on its own stack
+    struct Fiber
+    {
+        enum class State
+        {
+            Running,
+            Waiting,
+            Finished,
+        };
+
+        ucontext_t                   mContext;
+        std::unique_ptr<std::byte[]> mStack;
+        Job*                         mJob         = nullptr;
+        JobCounter*                  mWaitCounter = nullptr;
+        State                        mState       = State::Running;
+        bool                         mBackground  = false;
+    };
+
+    static constexpr size_t cFiberStackSize = 256 * 1024;
+
+    /// Fiber entry point, runs the job of the current fiber and switches back to the worker
+    static void FiberMain();
+
+    /// Execute and release a job, exceptions are logged as nothing could catch them on a fiber
+    static void ExecuteJob(Job* inJob);
+
+    /// Thread locals, opaque to the optimizer so a fiber resumed on another thread doesn't reuse
+    /// the address of the previous thread's variable. noinline alone still allows the caller to
+    /// assume the result doesn't change between calls.
+    [[gnu::noipa]] static Fiber*&     sCurrentFiber();
+    [[gnu::noipa]] static ucontext_t& sWorkerContext();
+    [[gnu::noipa]] static int&        sWorkerIndex();
+
+    Fiber* AcquireFiber();
+    void   ReleaseFiber(Fiber* inFiber);
+
+    /// Park a fiber that switched back to the worker to wait, or make it ready if the counter
+    /// completed in the meantime
+    void   ParkFiber(Fiber* inFiber);
+    void   PushReadyFiber(Fiber* inFiber);
+    Fiber* TakeReadyFiber();
+
+    /// Length of each job queue
+    static constexpr uint32_t cQueueLength = 1024;
+    static_assert(JPH::IsPowerOf2(cQueueLength)
+    ); // We do bit operations and require queue length to be a power of 2
+
+    /// Job that remembers its queue, it is queued later when it has dependencies
+    class PriorityJob : public Job
+    {
+      public:
+        PriorityJob(
+            const char*        inJobName,
+            JPH::ColorArg      inColor,
+            JobSystem*         inJobSystem,
+            const JobFunction& inJobFunction,
+            uint32_t           inNumDependencies,
+            JobPriority        inPriority
+        ) :
+            Job(inJobName, inColor, inJobSystem, inJobFunction, inNumDependencies),
+            mPriority(inPriority)
+        {
+        }
+
+        JobPriority mPriority;
+    };
+
+    /// Ring of jobs of one priority class
+    struct Queue
+    {
+        std::atomic<Job*>                              mRing[cQueueLength];
+        alignas(JPH_CACHE_LINE_SIZE) std::atomic<uint> mTail = 0; ///< Write end of the queue
+    };
+
+    /// Get the head of the thread that has processed the least amount of jobs in a queue
+    inline uint GetHead(uint inPriority) const;
+
+    /// Head of a thread in a queue
+    inline std::atomic<uint>& GetThreadHead(int inThreadIndex, uint inPriority)
+    {
+        return mHeads[uint(inThreadIndex) * cNumJobPriorities + inPriority];
+    }
 
     /// Internal helper function to queue a job
     inline void QueueJobInternal(Job* inJob);
 
+    /// Take the next job of the highest priority available to a worker, nullptr if there is none
+    Job* TakeJob(int inThreadIndex, bool& outIsBackground);
+
+    /// Count a worker as running a background job, false if that would leave no worker free
+    bool TryReserveBackground();
+
     /// Functions to call when initializing or exiting a thread
     InitExitFunction mThreadInitFunction = [](int) {};
     InitExitFunction mThreadExitFunction = [](int) {};
 
     /// Array of jobs (fixed size)
-    using AvailableJobs = JPH::FixedSizeFreeList<Job>;
+    using AvailableJobs = JPH::FixedSizeFreeList<PriorityJob>;
     AvailableJobs mJobs;
 
     /// Threads running jobs
     JPH::Array<std::thread> mThreads;
 
-    // The job queue
-    static constexpr uint32_t cQueueLength = 1024;
-    static_assert(JPH::IsPowerOf2(cQueueLength)
-    ); // We do bit operations and require queue length to be a power of 2
-    std::atomic<Job*> mQueue[cQueueLength];
+    /// One queue per priority, do head and tail modulo cQueueLength - 1 to get the element in the
+    /// mRing array of the queue
+    Queue mQueues[cNumJobPriorities];
+
+    /// Per executing thread and priority the head of the queue
+    std::atomic<uint>* mHeads = nullptr;
 
-    // Head and tail of the queue, do this value modulo cQueueLength - 1 to get the element in the
-    // mQueue array
-    std::atomic<uint>* mHeads = nullptr; ///< Per executing thread the head of the current queue
-    alignas(JPH_CACHE_LINE_SIZE) std::atomic<uint> mTail = 0; ///< Tail (write end) of the queue
+    /// Background jobs are limited to all but one worker, so there is always a worker free for
+    /// higher priority jobs
+    std::atomic<int> mNumBackgroundRunning = 0;
+    int              mMaxBackgroundRunning = 0;
 
     // Semaphore used to signal worker threads that there is new work
     JPH::Semaphore mSemaphore;
 
     /// Boolean to indicate that we want to stop the job system
     std::atomic<bool> mQuit = false;
+
+    /// Worker count requested from StartThreads, -1 to auto detect
+    int mNumThreads = -1;
+
+    /// Fibers, all created fibers are owned by mFibers
+    bool                                mUseFibers = false;
+    std::mutex                          mFiberMutex;
+    std::vector<std::unique_ptr<Fiber>> mFibers;
+    std::vector<Fiber*>                 mFreeFibers;
+
+    /// Fibers whose counter completed, waiting for a worker
+    std::mutex         mReadyMutex;
+    std::deque<Fiber*> mReadyFibers;
+    std::atomic<uint>  mNumReadyFibers = 0;
+
+    /// Counters of one worker, only written by that worker
+    struct alignas(JPH_CACHE_LINE_SIZE) WorkerCounters
+    {
+        std::atomic<uint64_t> mBusyNanoseconds = 0;
+        std::atomic<uint64_t> mIdleNanoseconds = 0;
+        std::atomic<uint64_t> mJobsExecuted    = 0;
+        std::atomic<uint64_t> mFibersResumed   = 0;
+    };
+
+    std::unique_ptr<WorkerCounters[]> mWorkerCounters;
+    uint                              mNumWorkerCounters = 0;
+
+    /// Time producers slept in QueueJobInternal waiting for space in a queue
+    std::atomic<uint64_t> mQueueFullNanoseconds = 0;
+    std::atomic<uint64_t> mQueueFullCount       = 0;
 };
 }; // namespace legs
@@ -246,8 +246,16 @@ void JobSystemWithBarrier::WaitForJobs(Barrier* inBarrier)
 {
     JPH_PROFILE_FUNCTION();
 
+    const auto start = std::chrono::steady_clock::now();
+
     // Let our barrier implementation wait for the jobs
     static_cast<BarrierImpl*>(inBarrier)->Wait();
+
+    const auto wait = std::chrono::steady_clock::now() - start;
+    mBarrierWaitNanoseconds.fetch_add(
+        uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(wait).count()),
+        std::memory_order_relaxed
+    );
 }
 
 }; // namespace legs
@@ -39,6 +39,12 @@ class JobSystemWithBarrier : public JPH::JobSystem
     virtual void     DestroyBarrier(Barrier* inBarrier) override;
     virtual void     WaitForJobs(Barrier* inBarrier) override;
 
+    /// Total time threads have spent in WaitForJobs, in seconds
+    double GetBarrierWaitTime() const
+    {
+        return double(mBarrierWaitNanoseconds.load(std::memory_order_relaxed)) * 1.0e-9;
+    }
+
   private:
     class BarrierImpl : public Barrier
     {
@@ -91,5 +97,8 @@ class JobSystemWithBarrier : public JPH::JobSystem
     /// semaphore/mutex is not cheap)
     uint         mMaxBarriers = 0;       ///< Max amount of barriers
     BarrierImpl* mBarriers    = nullptr; ///< List of the actual barriers
+
+    /// Time spent in WaitForJobs, summed over all waiting threads
+    std::atomic<uint64_t> mBarrierWaitNanoseconds = 0;
 };
 }; // namespace legs
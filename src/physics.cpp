@@ -1,8 +1,13 @@
+#include <algorithm>
 #include <cmath>
 #include <cstdarg>
 #include <iostream>
+#include <limits>
 #include <thread>
 
+#include <glm/geometric.hpp>
+
+#include <legs/shape_cache.hpp>
 #include <legs/time.hpp>
 
 #include "physics.hpp"
@@ -10,6 +15,9 @@
 namespace legs
 {
 
+// Smallest amount of queries worth handing to a separate job.
+static constexpr uint32_t cMinQueriesPerJob = 32;
+
 // Callback for traces, connect this to your own trace function if you have one
 static void TraceImpl(const char* fmt, ...)
 {
@@ -64,19 +72,17 @@ void Physics::Register()
     JPH::RegisterTypes();
 }
 
-Physics::Physics() :
+Physics::Physics(std::shared_ptr<JobSystemThreadPool> jobSystem) :
     m_tempAllocator(10 * 1024 * 1024),
-    m_jobSystem(
-        JPH::cMaxPhysicsJobs,
-        JPH::cMaxPhysicsBarriers,
-        static_cast<int>(std::thread::hardware_concurrency()) - 1
-    ),
+    m_jobSystem(jobSystem),
+    m_contactListener(m_eventQueue),
+    m_bodyActivationListener(m_eventQueue),
+    m_activeBodiesFilter(m_physicsSystem.GetBodyInterfaceNoLock()),
     m_maxDeltaTime(1.0f / 60.0f)
 {
     // This is the max amount of rigid bodies that you can add to the physics system. If you try to
-    // add more you'll get an error. Note: This value is low because this is a simple test. For a
-    // real project use something in the order of 65536.
-    const uint cMaxBodies = 1024;
+    // add more you'll get an error.
+    const uint cMaxBodies = 65536;
 
     // This determines how many mutexes to allocate to protect rigid bodies from concurrent access.
     // Set it to 0 for the default settings.
@@ -85,16 +91,14 @@ Physics::Physics() :
     // This is the max amount of body pairs that can be queued at any time (the broad phase will
     // detect overlapping body pairs based on their bounding boxes and will insert them into a queue
     // for the narrowphase). If you make this buffer too small the queue will fill up and the broad
-    // phase jobs will start to do narrow phase work. This is slightly less efficient. Note: This
-    // value is low because this is a simple test. For a real project use something in the order of
-    // 65536.
-    const uint cMaxBodyPairs = 1024;
+    // phase jobs will start to do narrow phase work. This is slightly less efficient.
+    const uint cMaxBodyPairs = 65536;
 
     // This is the maximum size of the contact constraint buffer. If more contacts (collisions
     // between bodies) are detected than this number then these contacts will be ignored and bodies
-    // will start interpenetrating / fall through the world. Note: This value is low because this is
-    // a simple test. For a real project use something in the order of 10240.
-    const uint cMaxContactConstraints = 1024;
+    // will start interpenetrating / fall through the world. Piles of a few thousand bodies have
+    // several contacts per body.
+    const uint cMaxContactConstraints = 65536;
 
     // Now we can create the actual physics system.
     m_physicsSystem.Init(
@@ -109,17 +113,25 @@ Physics::Physics() :
 
     // A body activation listener gets notified when bodies activate and go to sleep
     // Note that this is called from a job so whatever you do here needs to be thread safe.
-    // Registering one is entirely optional.
+    // Both listeners only push to the event queue, which is drained after the update.
     m_physicsSystem.SetBodyActivationListener(&m_bodyActivationListener);
 
     // A contact listener gets notified when bodies (are about to) collide, and when they separate
     // again. Note that this is called from a job so whatever you do here needs to be thread safe.
-    // Registering one is entirely optional.
     m_physicsSystem.SetContactListener(&m_contactListener);
+
+    m_events.reserve(1024);
+
+#ifdef JPH_DEBUG_RENDERER
+    m_debugRenderer = std::make_unique<PhysicsDebugRenderer>();
+#endif
 }
 
 Physics::~Physics()
 {
+    // Cached shapes must be released before the types are unregistered
+    ShapeCache::Clear();
+
     // Unregisters all types with the factory and cleans up the default material
     JPH::UnregisterTypes();
 
@@ -138,8 +150,193 @@ void Physics::Optimize()
 
 void Physics::Update()
 {
+    UpdateLod();
+
+    const auto busyStart   = m_jobSystem->GetBusyTime();
+    const auto updateStart = Time::Now();
+
     const unsigned int steps = std::ceil(Time::DeltaTick / m_maxDeltaTime);
-    m_physicsSystem.Update(Time::DeltaTick, steps, &m_tempAllocator, &m_jobSystem);
+    m_physicsSystem.Update(Time::DeltaTick, steps, &m_tempAllocator, m_jobSystem.get());
+
+    m_stats.updateTime      = Time::Now() - updateStart;
+    m_stats.jobBusyTime     = m_jobSystem->GetBusyTime() - busyStart;
+    m_stats.numThreads      = static_cast<uint32_t>(m_jobSystem->GetMaxConcurrency() - 1);
+    m_stats.numBodies       = m_physicsSystem.GetNumBodies();
+    m_stats.numActiveBodies = m_physicsSystem.GetNumActiveBodies(JPH::EBodyType::RigidBody);
+
+    m_events.clear();
+    m_eventQueue.Drain(m_events);
+
+    const auto dropped = m_eventQueue.TakeDroppedCount();
+    if (dropped > 0)
+    {
+        LOG_WARN("Dropped {} physics events", dropped);
+    }
+
+    // Removed contacts are queued without user data, the bodies were locked at that point.
+    auto& bodyInterface = m_physicsSystem.GetBodyInterface();
+    for (auto& event : m_events)
+    {
+        if (event.type == PhysicsEventType::ContactRemoved)
+        {
+            event.userData1 = bodyInterface.GetUserData(event.body1);
+            event.userData2 = bodyInterface.GetUserData(event.body2);
+        }
+    }
+
+    UpdateSensors();
+    CollectDebugDraw();
+}
+
+void Physics::UpdateSensors()
+{
+    // Jolt reports contacts per sub shape pair, a body is inside a sensor while it has at least
+    // one contact with it. Only added and removed contacts matter, so this is incremental.
+    // Events from different workers are not ordered, so all added contacts are counted before
+    // the removed ones. A pair that touched only briefly still gets both enter and exit.
+    std::scoped_lock lock {m_sensorMutex};
+    m_triggerEvents.clear();
+
+    const auto getKey = [](const PhysicsEvent& event)
+    {
+        const auto id1 = event.body1.GetIndexAndSequenceNumber();
+        const auto id2 = event.body2.GetIndexAndSequenceNumber();
+        return (static_cast<uint64_t>(std::min(id1, id2)) << 32) | std::max(id1, id2);
+    };
+
+    for (const auto& event : m_events)
+    {
+        if (event.type != PhysicsEventType::ContactAdded || !event.sensor)
+        {
+            continue;
+        }
+
+        auto [it, inserted] = m_sensorPairs.try_emplace(getKey(event));
+        auto& pair          = it->second;
+        if (inserted)
+        {
+            JPH::BodyLockRead lock(m_physicsSystem.GetBodyLockInterface(), event.body1);
+            const bool        firstIsSensor = lock.Succeeded() && lock.GetBody().IsSensor();
+
+            pair.sensor      = firstIsSensor ? event.body1 : event.body2;
+            pair.other       = firstIsSensor ? event.body2 : event.body1;
+            pair.numContacts = 0;
+
+            m_triggerEvents.push_back({
+                .type      = PhysicsEventType::TriggerEnter,
+                .body1     = pair.sensor,
+                .body2     = pair.other,
+                .userData1 = firstIsSensor ? event.userData1 : event.userData2,
+                .userData2 = firstIsSensor ? event.userData2 : event.userData1,
+                .sensor    = true,
+            });
+        }
+        pair.numContacts++;
+    }
+
+    for (const auto& event : m_events)
+    {
+        if (event.type != PhysicsEventType::ContactRemoved)
+        {
+            continue;
+        }
+
+        auto it = m_sensorPairs.find(getKey(event));
+        if (it == m_sensorPairs.end() || --it->second.numContacts > 0)
+        {
+            continue;
+        }
+
+        const bool firstIsSensor = event.body1 == it->second.sensor;
+        m_triggerEvents.push_back({
+            .type      = PhysicsEventType::TriggerExit,
+            .body1     = it->second.sensor,
+            .body2     = it->second.other,
+            .userData1 = firstIsSensor ? event.userData1 : event.userData2,
+            .userData2 = firstIsSensor ? event.userData2 : event.userData1,
+            .sensor    = true,
+        });
+        m_sensorPairs.erase(it);
+    }
+
+    m_events.insert(m_events.end(), m_triggerEvents.begin(), m_triggerEvents.end());
+}
+
+void Physics::SaveState(PhysicsSnapshot& snapshot, SnapshotMode mode)
+{
+    snapshot.Clear();
+    snapshot.SetMode(mode);
+
+    const JPH::StateRecorderFilter* filter = nullptr;
+    if (mode == SnapshotMode::ActiveBodies)
+    {
+        filter = &m_activeBodiesFilter;
+    }
+
+    m_physicsSystem.SaveState(snapshot, JPH::EStateRecorderState::All, filter);
+}
+
+bool Physics::RestoreState(PhysicsSnapshot& snapshot)
+{
+    snapshot.Rewind();
+    if (!m_physicsSystem.RestoreState(snapshot))
+    {
+        LOG_ERROR("Failed to restore physics state");
+        return false;
+    }
+
+    // Tracked overlaps belong to the state before the restore, their exits would never come.
+    ExitSensorPairs(JPH::BodyID());
+    return true;
+}
+
+void Physics::ExitSensorPairs(JPH::BodyID body)
+{
+    std::scoped_lock lock {m_sensorMutex};
+    auto&            bodyInterface = m_physicsSystem.GetBodyInterface();
+    std::erase_if(
+        m_sensorPairs,
+        [&](const auto& entry)
+        {
+            const auto& pair = entry.second;
+            if (!body.IsInvalid() && pair.sensor != body && pair.other != body)
+            {
+                return false;
+            }
+
+            m_eventQueue.Push({
+                .type      = PhysicsEventType::TriggerExit,
+                .body1     = pair.sensor,
+                .body2     = pair.other,
+                .userData1 = bodyInterface.GetUserData(pair.sensor),
+                .userData2 = bodyInterface.GetUserData(pair.other),
+                .sensor    = true,
+            });
+            return true;
+        }
+    );
+}
+
+void Physics::DispatchEvents()
+{
+    // Listeners are looked up by body instead of the queued user data, a handler may destroy the
+    // entity of a later event. Destroyed bodies have no user data anymore.
+    auto& bodyInterface = m_physicsSystem.GetBodyInterface();
+    for (const auto& event : m_events)
+    {
+        if (auto listener = IPhysicsListener::FromUserData(bodyInterface.GetUserData(event.body1)))
+        {
+            listener->OnPhysicsEvent(event);
+        }
+        if (event.body2.IsInvalid())
+        {
+            continue;
+        }
+        if (auto listener = IPhysicsListener::FromUserData(bodyInterface.GetUserData(event.body2)))
+        {
+            listener->OnPhysicsEvent(event);
+        }
+    }
 }
 
 JPH::BodyID Physics::CreateBody(JPH::BodyCreationSettings settings)
@@ -147,11 +344,49 @@ JPH::BodyID Physics::CreateBody(JPH::BodyCreationSettings settings)
     auto body = m_physicsSystem.GetBodyInterface().CreateBody(settings);
     if (body != nullptr)
     {
+        if (settings.mMotionType == JPH::EMotionType::Dynamic)
+        {
+            TrackLodBody(body->GetID());
+        }
         return body->GetID();
     }
     return JPH::BodyID(JPH::BodyID::cInvalidBodyID);
 }
 
+void Physics::TrackLodBody(JPH::BodyID id)
+{
+    std::scoped_lock lock {m_lodMutex};
+    if (m_lodBodyIndices.try_emplace(id.GetIndexAndSequenceNumber(), m_lodBodies.size()).second)
+    {
+        m_lodBodies.push_back({.id = id, .far = false});
+    }
+}
+
+void Physics::UntrackLodBody(JPH::BodyID id)
+{
+    std::scoped_lock lock {m_lodMutex};
+    auto             it = m_lodBodyIndices.find(id.GetIndexAndSequenceNumber());
+    if (it == m_lodBodyIndices.end())
+    {
+        return;
+    }
+
+    const auto index = it->second;
+    m_lodBodyIndices.erase(it);
+    if (m_lodBodies[index].far)
+    {
+        m_numFarBodies--;
+    }
+
+    // Swap with the last one to keep the list packed.
+    if (index != m_lodBodies.size() - 1)
+    {
+        m_lodBodies[index] = m_lodBodies.back();
+        m_lodBodyIndices[m_lodBodies[index].id.GetIndexAndSequenceNumber()] = index;
+    }
+    m_lodBodies.pop_back();
+}
+
 void Physics::AddBody(JPH::BodyID id)
 {
     m_physicsSystem.GetBodyInterface().AddBody(id, JPH::EActivation::Activate);
@@ -159,14 +394,41 @@ void Physics::AddBody(JPH::BodyID id)
 
 void Physics::RemoveBody(JPH::BodyID id)
 {
+    // Its sensors are exited right away, the body may be destroyed and its id reused before Jolt
+    // reports the removed contacts.
+    ExitSensorPairs(id);
     m_physicsSystem.GetBodyInterface().RemoveBody(id);
 }
 
 void Physics::DestroyBody(JPH::BodyID id)
 {
+    UntrackLodBody(id);
     m_physicsSystem.GetBodyInterface().DestroyBody(id);
 }
 
+void Physics::SetBodyMotionType(JPH::BodyID id, JPH::EMotionType motionType)
+{
+    // Only dynamic bodies are taken out of the simulation when far, the LOD would undo others.
+    if (motionType == JPH::EMotionType::Dynamic)
+    {
+        TrackLodBody(id);
+    }
+    else
+    {
+        UntrackLodBody(id);
+    }
+
+    m_physicsSystem.GetBodyInterface().SetMotionType(id, motionType, JPH::EActivation::Activate);
+}
+
+void Physics::MoveBodyKinematic(JPH::BodyID id, glm::vec3 pos, glm::quat rot)
+{
+    JPH::RVec3 joltPos = {pos.x, pos.y, pos.z};
+    JPH::Quat  joltRot = {rot.x, rot.y, rot.z, rot.w};
+    m_physicsSystem.GetBodyInterface()
+        .MoveKinematic(id, joltPos, joltRot, static_cast<float>(Time::DeltaTick));
+}
+
 void Physics::GetBodyTransform(JPH::BodyID id, std::shared_ptr<STransform> trans)
 {
     JPH::RVec3 joltPos;
@@ -190,8 +452,8 @@ void Physics::SetBodyTransform(JPH::BodyID id, std::shared_ptr<STransform> trans
     JPH::Quat  joltRot = {
         trans->rotation.quaternion.x,
         trans->rotation.quaternion.y,
-        trans->rotation.quaternion.w,
-        trans->rotation.quaternion.z
+        trans->rotation.quaternion.z,
+        trans->rotation.quaternion.w
     };
 
     m_physicsSystem.GetBodyInterface()
@@ -206,7 +468,7 @@ void Physics::SetBodyPosition(JPH::BodyID id, glm::vec3 pos)
 
 void Physics::SetBodyRotation(JPH::BodyID id, glm::quat rot)
 {
-    JPH::Quat joltRot = {rot.x, rot.y, rot.w, rot.z};
+    JPH::Quat joltRot = {rot.x, rot.y, rot.z, rot.w};
     m_physicsSystem.GetBodyInterface().SetRotation(id, joltRot, JPH::EActivation::Activate);
 }
 
@@ -221,4 +483,489 @@ void Physics::SetBodyAngularVelocity(JPH::BodyID id, glm::vec3 vel)
     JPH::RVec3 joltVel = {vel.x, vel.y, vel.z};
     m_physicsSystem.GetBodyInterface().SetPosition(id, joltVel, JPH::EActivation::Activate);
 }
+
+void Physics::SetLodSettings(const PhysicsLodSettings& settings)
+{
+    std::scoped_lock lock {m_lodMutex};
+    m_lodSettings = settings;
+
+    // Bring everything back, bodies are evaluated again with the new settings.
+    if (!m_lodSettings.enabled)
+    {
+        for (auto& body : m_lodBodies)
+        {
+            SetBodyFar(body, false);
+        }
+    }
+}
+
+PhysicsLodSettings Physics::GetLodSettings() const
+{
+    std::scoped_lock lock {m_lodMutex};
+    return m_lodSettings;
+}
+
+void Physics::SetLodObservers(std::span<const glm::vec3> positions)
+{
+    std::scoped_lock lock {m_lodMutex};
+    m_lodObservers.assign(positions.begin(), positions.end());
+}
+
+PhysicsLodStats Physics::GetLodStats() const
+{
+    std::scoped_lock lock {m_lodMutex};
+    return {
+        .numBodies    = static_cast<uint32_t>(m_lodBodies.size()),
+        .numFarBodies = m_numFarBodies,
+    };
+}
+
+void Physics::UpdateLod()
+{
+    std::scoped_lock lock {m_lodMutex};
+    if (!m_lodSettings.enabled || m_lodBodies.empty() || m_lodObservers.empty())
+    {
+        return;
+    }
+
+    const float nearDistanceSq = m_lodSettings.nearDistance * m_lodSettings.nearDistance;
+    const float farDistanceSq  = m_lodSettings.farDistance * m_lodSettings.farDistance;
+    const auto  count =
+        std::min(static_cast<size_t>(m_lodSettings.bodiesPerUpdate), m_lodBodies.size());
+
+    auto& bodyInterface = m_physicsSystem.GetBodyInterface();
+    for (size_t i = 0; i < count; i++)
+    {
+        m_lodCursor = (m_lodCursor + 1) % m_lodBodies.size();
+        auto& body  = m_lodBodies[m_lodCursor];
+        if (!bodyInterface.IsAdded(body.id))
+        {
+            continue;
+        }
+
+        const auto position = bodyInterface.GetCenterOfMassPosition(body.id);
+        const auto pos      = glm::vec3(position.GetX(), position.GetY(), position.GetZ());
+
+        float distanceSq = std::numeric_limits<float>::max();
+        for (const auto& observer : m_lodObservers)
+        {
+            const auto delta = pos - observer;
+            distanceSq       = std::min(distanceSq, glm::dot(delta, delta));
+        }
+
+        if (body.far && distanceSq < nearDistanceSq)
+        {
+            SetBodyFar(body, false);
+        }
+        else if (!body.far && distanceSq > farDistanceSq)
+        {
+            SetBodyFar(body, true);
+        }
+        else if (body.far && m_lodSettings.farPolicy == PhysicsLodPolicy::Sleep)
+        {
+            // Woken up by something since the last evaluation.
+            if (bodyInterface.IsActive(body.id))
+            {
+                bodyInterface.DeactivateBody(body.id);
+            }
+        }
+    }
+}
+
+void Physics::SetBodyFar(LodBody& body, bool far)
+{
+    auto& bodyInterface = m_physicsSystem.GetBodyInterface();
+    if (body.far == far || !bodyInterface.IsAdded(body.id))
+    {
+        return;
+    }
+
+    if (far)
+    {
+        bodyInterface.GetLinearAndAngularVelocity(
+            body.id,
+            body.linearVelocity,
+            body.angularVelocity
+        );
+
+        if (m_lodSettings.farPolicy == PhysicsLodPolicy::Kinematic)
+        {
+            bodyInterface.SetMotionType(
+                body.id,
+                JPH::EMotionType::Kinematic,
+                JPH::EActivation::DontActivate
+            );
+            bodyInterface.SetLinearAndAngularVelocity(
+                body.id,
+                JPH::Vec3::sZero(),
+                JPH::Vec3::sZero()
+            );
+        }
+        bodyInterface.DeactivateBody(body.id);
+        m_numFarBodies++;
+    }
+    else
+    {
+        if (bodyInterface.GetMotionType(body.id) == JPH::EMotionType::Kinematic)
+        {
+            bodyInterface.SetMotionType(
+                body.id,
+                JPH::EMotionType::Dynamic,
+                JPH::EActivation::DontActivate
+            );
+        }
+        bodyInterface.ActivateBody(body.id);
+        bodyInterface.SetLinearAndAngularVelocity(
+            body.id,
+            body.linearVelocity,
+            body.angularVelocity
+        );
+        m_numFarBodies--;
+    }
+
+    body.far = far;
+}
+
+void Physics::SetDebugDrawSettings(const PhysicsDebugDrawSettings& settings)
+{
+#ifndef JPH_DEBUG_RENDERER
+    if (settings.enabled)
+    {
+        LOG_WARN("Physics debug drawing requires JPH_DEBUG_RENDERER");
+    }
+#endif
+
+    std::scoped_lock lock {m_debugDrawMutex};
+    m_debugDrawSettings = settings;
+
+#ifdef JPH_DEBUG_RENDERER
+    if (!settings.enabled)
+    {
+        m_debugRenderer->Clear();
+    }
+#endif
+}
+
+PhysicsDebugDrawSettings Physics::GetDebugDrawSettings() const
+{
+    std::scoped_lock lock {m_debugDrawMutex};
+    return m_debugDrawSettings;
+}
+
+void Physics::RenderDebug(std::shared_ptr<Renderer> renderer)
+{
+#ifdef JPH_DEBUG_RENDERER
+    // Frees the debug vertex buffers while debug drawing is off.
+    const auto settings = GetDebugDrawSettings();
+    renderer->SetMaxDebugVertices(settings.enabled ? settings.maxVertices : 0);
+    if (settings.enabled)
+    {
+        m_debugRenderer->Render(*renderer);
+    }
+#endif
+}
+
+void Physics::CollectDebugDraw()
+{
+#ifdef JPH_DEBUG_RENDERER
+    const auto settings = GetDebugDrawSettings();
+    if (!settings.enabled)
+    {
+        return;
+    }
+
+    {
+        // Jolt picks the shape LOD by distance to the camera.
+        std::scoped_lock lock {m_lodMutex};
+        if (!m_lodObservers.empty())
+        {
+            const auto& pos = m_lodObservers.front();
+            m_debugRenderer->SetCameraPos(JPH::RVec3(pos.x, pos.y, pos.z));
+        }
+    }
+
+    m_debugRenderer->Collect(m_physicsSystem, settings);
+#endif
+}
+
+template<class F>
+void Physics::ParallelFor(const char* name, uint32_t count, const F& func)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    const auto maxJobs = static_cast<uint32_t>(m_jobSystem->GetMaxConcurrency());
+    const auto numJobs =
+        std::clamp((count + cMinQueriesPerJob - 1) / cMinQueriesPerJob, 1u, maxJobs);
+
+    JPH::JobSystem::Barrier* barrier = numJobs > 1 ? m_jobSystem->CreateBarrier() : nullptr;
+    if (barrier == nullptr)
+    {
+        func(0u, count);
+        return;
+    }
+
+    const uint32_t perJob = (count + numJobs - 1) / numJobs;
+    for (uint32_t begin = 0; begin < count; begin += perJob)
+    {
+        const uint32_t end    = std::min(begin + perJob, count);
+        JPH::JobHandle handle = m_jobSystem->CreateJob(
+            name,
+            JPH::Color::sGreen,
+            [&func, begin, end]() { func(begin, end); }
+        );
+        barrier->AddJob(handle);
+    }
+
+    // The calling thread helps out with the jobs while waiting.
+    m_jobSystem->WaitForJobs(barrier);
+    m_jobSystem->DestroyBarrier(barrier);
+}
+
+void Physics::CastRays(std::span<const RayCastQuery> queries, std::span<RayCastHit> hits)
+{
+    if (hits.size() < queries.size())
+    {
+        throw std::runtime_error("Not enough space for ray cast results");
+    }
+
+    const auto& query = m_physicsSystem.GetNarrowPhaseQuery();
+    const auto& locks = m_physicsSystem.GetBodyLockInterface();
+
+    ParallelFor(
+        "CastRays",
+        static_cast<uint32_t>(queries.size()),
+        [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t i = begin; i < end; i++)
+            {
+                const auto& in  = queries[i];
+                auto&       out = hits[i];
+
+                const JPH::RRayCast ray {
+                    JPH::RVec3(in.origin.x, in.origin.y, in.origin.z),
+                    JPH::Vec3(in.direction.x, in.direction.y, in.direction.z)
+                };
+
+                JPH::RayCastResult                result;
+                const QueryBroadPhaseLayerFilter  broadPhaseFilter(
+                    m_objectVsBroadphaseLayerFilter,
+                    in.layer,
+                    in.includeSensors
+                );
+                const JPH::IgnoreSingleBodyFilter bodyFilter(in.ignoreBody);
+                const bool                        hasHit = query.CastRay(
+                    ray,
+                    result,
+                    broadPhaseFilter,
+                    m_physicsSystem.GetDefaultLayerFilter(in.layer),
+                    bodyFilter
+                );
+
+                out = {};
+                if (!hasHit)
+                {
+                    continue;
+                }
+
+                const JPH::RVec3 point = ray.GetPointOnRay(result.mFraction);
+                out.body               = result.mBodyID;
+                out.fraction           = result.mFraction;
+                out.position           = {point.GetX(), point.GetY(), point.GetZ()};
+
+                const JPH::BodyLockRead lock(locks, result.mBodyID);
+                if (lock.Succeeded())
+                {
+                    const JPH::Vec3 normal =
+                        lock.GetBody().GetWorldSpaceSurfaceNormal(result.mSubShapeID2, point);
+                    out.normal = {normal.GetX(), normal.GetY(), normal.GetZ()};
+                }
+            }
+        }
+    );
+}
+
+void Physics::CastShapes(std::span<const ShapeCastQuery> queries, std::span<ShapeCastHit> hits)
+{
+    if (hits.size() < queries.size())
+    {
+        throw std::runtime_error("Not enough space for shape cast results");
+    }
+
+    const auto& query = m_physicsSystem.GetNarrowPhaseQuery();
+
+    ParallelFor(
+        "CastShapes",
+        static_cast<uint32_t>(queries.size()),
+        [&](uint32_t begin, uint32_t end)
+        {
+            JPH::ShapeCastSettings settings;
+            settings.mReturnDeepestPoint = true;
+
+            for (uint32_t i = begin; i < end; i++)
+            {
+                const auto& in  = queries[i];
+                auto&       out = hits[i];
+
+                out = {};
+                if (in.shape == nullptr)
+                {
+                    continue;
+                }
+
+                const auto cast = JPH::RShapeCast::sFromWorldTransform(
+                    in.shape.GetPtr(),
+                    JPH::Vec3::sReplicate(1.0f),
+                    JPH::RMat44::sRotationTranslation(
+                        JPH::Quat(in.rotation.x, in.rotation.y, in.rotation.z, in.rotation.w),
+                        JPH::RVec3(in.position.x, in.position.y, in.position.z)
+                    ),
+                    JPH::Vec3(in.direction.x, in.direction.y, in.direction.z)
+                );
+
+                const QueryBroadPhaseLayerFilter  broadPhaseFilter(
+                    m_objectVsBroadphaseLayerFilter,
+                    in.layer,
+                    in.includeSensors
+                );
+                const JPH::IgnoreSingleBodyFilter bodyFilter(in.ignoreBody);
+
+                JPH::ClosestHitCollisionCollector<JPH::CastShapeCollector> collector;
+                query.CastShape(
+                    cast,
+                    settings,
+                    JPH::RVec3::sZero(),
+                    collector,
+                    broadPhaseFilter,
+                    m_physicsSystem.GetDefaultLayerFilter(in.layer),
+                    bodyFilter
+                );
+
+                if (!collector.HadHit())
+                {
+                    continue;
+                }
+
+                const auto&     hit    = collector.mHit;
+                const JPH::Vec3 normal = -hit.mPenetrationAxis.NormalizedOr(JPH::Vec3::sZero());
+                out.body               = hit.mBodyID2;
+                out.fraction           = hit.mFraction;
+                out.position           = {
+                    hit.mContactPointOn2.GetX(),
+                    hit.mContactPointOn2.GetY(),
+                    hit.mContactPointOn2.GetZ()
+                };
+                out.normal      = {normal.GetX(), normal.GetY(), normal.GetZ()};
+                out.penetration = hit.mPenetrationDepth;
+            }
+        }
+    );
+}
+
+// Collects unique bodies into a fixed slice of the caller's buffer.
+class BodyOverlapCollector final : public JPH::CollideShapeCollector
+{
+  public:
+    explicit BodyOverlapCollector(std::span<JPH::BodyID> bodies) : m_bodies(bodies)
+    {
+    }
+
+    virtual void AddHit(const JPH::CollideShapeResult& inResult) override
+    {
+        const auto end = m_bodies.begin() + m_count;
+        if (std::find(m_bodies.begin(), end, inResult.mBodyID2) != end)
+        {
+            return;
+        }
+
+        m_bodies[m_count++] = inResult.mBodyID2;
+        if (m_count == m_bodies.size())
+        {
+            ForceEarlyOut();
+        }
+    }
+
+    uint32_t GetCount() const
+    {
+        return m_count;
+    }
+
+  private:
+    std::span<JPH::BodyID> m_bodies;
+    uint32_t               m_count = 0;
+};
+
+void Physics::CollideShapes(
+    std::span<const OverlapQuery> queries,
+    std::span<JPH::BodyID>        bodies,
+    std::span<uint32_t>           counts
+)
+{
+    if (queries.empty())
+    {
+        return;
+    }
+
+    if (counts.size() < queries.size())
+    {
+        throw std::runtime_error("Not enough space for overlap counts");
+    }
+
+    const size_t perQuery = bodies.size() / queries.size();
+    if (perQuery == 0)
+    {
+        throw std::runtime_error("Not enough space for overlap results");
+    }
+
+    const auto& query = m_physicsSystem.GetNarrowPhaseQuery();
+
+    ParallelFor(
+        "CollideShapes",
+        static_cast<uint32_t>(queries.size()),
+        [&](uint32_t begin, uint32_t end)
+        {
+            const JPH::CollideShapeSettings settings;
+
+            for (uint32_t i = begin; i < end; i++)
+            {
+                const auto& in = queries[i];
+
+                counts[i] = 0;
+                if (in.shape == nullptr)
+                {
+                    continue;
+                }
+
+                const auto rotation =
+                    JPH::Quat(in.rotation.x, in.rotation.y, in.rotation.z, in.rotation.w);
+                const auto position  = JPH::RVec3(in.position.x, in.position.y, in.position.z);
+                const auto transform = JPH::RMat44::sRotationTranslation(rotation, position)
+                                           .PreTranslated(in.shape->GetCenterOfMass());
+
+                BodyOverlapCollector              collector(bodies.subspan(i * perQuery, perQuery));
+                const QueryBroadPhaseLayerFilter  broadPhaseFilter(
+                    m_objectVsBroadphaseLayerFilter,
+                    in.layer,
+                    in.includeSensors
+                );
+                const JPH::IgnoreSingleBodyFilter bodyFilter(in.ignoreBody);
+                query.CollideShape(
+                    in.shape.GetPtr(),
+                    JPH::Vec3::sReplicate(1.0f),
+                    transform,
+                    settings,
+                    JPH::RVec3::sZero(),
+                    collector,
+                    broadPhaseFilter,
+                    m_physicsSystem.GetDefaultLayerFilter(in.layer),
+                    bodyFilter
+                );
+
+                counts[i] = collector.GetCount();
+            }
+        }
+    );
+}
 }; // namespace legs
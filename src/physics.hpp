@@ -1,10 +1,16 @@
 #pragma once
 
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
 #include <legs/collider.hpp>
 #include <legs/iphysics.hpp>
 #include <legs/log.hpp>
 
 #include "job_system_thread_pool.hpp"
+#include "physics_debug_renderer.hpp"
+#include "physics_events.hpp"
 
 namespace legs
 {
@@ -18,7 +24,8 @@ namespace BroadPhaseLayers
 {
 static constexpr JPH::BroadPhaseLayer NON_MOVING(0);
 static constexpr JPH::BroadPhaseLayer MOVING(1);
-static constexpr uint                 NUM_LAYERS(2);
+static constexpr JPH::BroadPhaseLayer SENSOR(2);
+static constexpr uint                 NUM_LAYERS(3);
 }; // namespace BroadPhaseLayers
 
 // BroadPhaseLayerInterface implementation
@@ -31,6 +38,7 @@ class BPLayerInterfaceImpl final : public JPH::BroadPhaseLayerInterface
         // Create a mapping table from object to broad phase layer
         mObjectToBroadPhase[Layers::NON_MOVING] = BroadPhaseLayers::NON_MOVING;
         mObjectToBroadPhase[Layers::MOVING]     = BroadPhaseLayers::MOVING;
+        mObjectToBroadPhase[Layers::SENSOR]     = BroadPhaseLayers::SENSOR;
     }
 
     virtual uint GetNumBroadPhaseLayers() const override
@@ -53,6 +61,8 @@ class BPLayerInterfaceImpl final : public JPH::BroadPhaseLayerInterface
                 return "NON_MOVING";
             case (JPH::BroadPhaseLayer::Type)BroadPhaseLayers::MOVING:
                 return "MOVING";
+            case (JPH::BroadPhaseLayer::Type)BroadPhaseLayers::SENSOR:
+                return "SENSOR";
             default:
                 JPH_ASSERT(false);
                 return "INVALID";
@@ -77,6 +87,8 @@ class ObjectVsBroadPhaseLayerFilterImpl : public JPH::ObjectVsBroadPhaseLayerFil
                 return inLayer2 == BroadPhaseLayers::MOVING;
             case Layers::MOVING:
                 return true;
+            case Layers::SENSOR:
+                return inLayer2 == BroadPhaseLayers::MOVING;
             default:
                 JPH_ASSERT(false);
                 return false;
@@ -84,64 +96,162 @@ class ObjectVsBroadPhaseLayerFilterImpl : public JPH::ObjectVsBroadPhaseLayerFil
     }
 };
 
-// An example contact listener
-class MyContactListener : public JPH::ContactListener
+// Broad phase filter of a scene query, sensors are skipped unless the query asks for them.
+class QueryBroadPhaseLayerFilter final : public JPH::BroadPhaseLayerFilter
 {
   public:
-    // See: ContactListener
-    virtual JPH::ValidateResult OnContactValidate(
-        const JPH::Body&               inBody1,
-        const JPH::Body&               inBody2,
-        JPH::RVec3Arg                  inBaseOffset,
-        const JPH::CollideShapeResult& inCollisionResult
-    ) override
+    QueryBroadPhaseLayerFilter(
+        const JPH::ObjectVsBroadPhaseLayerFilter& filter,
+        JPH::ObjectLayer                          layer,
+        bool                                      includeSensors
+    ) :
+        m_filter(filter),
+        m_layer(layer),
+        m_includeSensors(includeSensors)
     {
-        // std::cout << "Contact validate callback" << std::endl;
+    }
+
+    virtual bool ShouldCollide(JPH::BroadPhaseLayer inLayer) const override
+    {
+        if (inLayer == BroadPhaseLayers::SENSOR && !m_includeSensors)
+        {
+            return false;
+        }
+        return m_filter.ShouldCollide(m_layer, inLayer);
+    }
 
-        // Allows you to ignore a contact before it is created (using layers to not make objects
-        // collide is cheaper!)
-        return JPH::ValidateResult::AcceptAllContactsForThisBodyPair;
+  private:
+    const JPH::ObjectVsBroadPhaseLayerFilter& m_filter;
+    JPH::ObjectLayer                          m_layer;
+    bool                                      m_includeSensors;
+};
+
+// Queues contact events, called by Jolt from the physics jobs. Persisted contacts are opt-in per
+// listener, every resting contact produces one each step.
+class ContactListenerImpl : public JPH::ContactListener
+{
+  public:
+    explicit ContactListenerImpl(PhysicsEventQueue& queue) : m_queue(queue)
+    {
     }
 
     virtual void OnContactAdded(
         const JPH::Body&            inBody1,
         const JPH::Body&            inBody2,
         const JPH::ContactManifold& inManifold,
-        JPH::ContactSettings&       ioSettings
+        JPH::ContactSettings& /*ioSettings*/
     ) override
     {
-        // std::cout << "A contact was added" << std::endl;
+        PushContact(PhysicsEventType::ContactAdded, inBody1, inBody2, inManifold);
     }
 
     virtual void OnContactPersisted(
         const JPH::Body&            inBody1,
         const JPH::Body&            inBody2,
         const JPH::ContactManifold& inManifold,
-        JPH::ContactSettings&       ioSettings
+        JPH::ContactSettings& /*ioSettings*/
     ) override
     {
-        // std::cout << "A contact was persisted" << std::endl;
+        if (WantsPersisted(inBody1) || WantsPersisted(inBody2))
+        {
+            PushContact(PhysicsEventType::ContactPersisted, inBody1, inBody2, inManifold);
+        }
     }
 
     virtual void OnContactRemoved(const JPH::SubShapeIDPair& inSubShapePair) override
     {
-        // std::cout << "A contact was removed" << std::endl;
+        // Bodies may already be locked or gone here, user data is resolved when draining.
+        m_queue.Push({
+            .type  = PhysicsEventType::ContactRemoved,
+            .body1 = inSubShapePair.GetBody1ID(),
+            .body2 = inSubShapePair.GetBody2ID(),
+        });
+    }
+
+  private:
+    static bool WantsPersisted(const JPH::Body& body)
+    {
+        auto listener = IPhysicsListener::FromUserData(body.GetUserData());
+        return listener != nullptr && listener->WantsPersistedContacts();
     }
+
+    void PushContact(
+        PhysicsEventType            type,
+        const JPH::Body&            inBody1,
+        const JPH::Body&            inBody2,
+        const JPH::ContactManifold& inManifold
+    )
+    {
+        const auto point  = inManifold.GetWorldSpaceContactPointOn1(0);
+        const auto normal = inManifold.mWorldSpaceNormal;
+        m_queue.Push({
+            .type        = type,
+            .body1       = inBody1.GetID(),
+            .body2       = inBody2.GetID(),
+            .userData1   = inBody1.GetUserData(),
+            .userData2   = inBody2.GetUserData(),
+            .sensor      = inBody1.IsSensor() || inBody2.IsSensor(),
+            .position    = {point.GetX(), point.GetY(), point.GetZ()},
+            .normal      = {normal.GetX(), normal.GetY(), normal.GetZ()},
+            .penetration = inManifold.mPenetrationDepth,
+        });
+    }
+
+    PhysicsEventQueue& m_queue;
 };
 
-// An example activation listener
-class MyBodyActivationListener : public JPH::BodyActivationListener
+// Queues activation events, called by Jolt from the physics jobs.
+class BodyActivationListenerImpl : public JPH::BodyActivationListener
 {
   public:
+    explicit BodyActivationListenerImpl(PhysicsEventQueue& queue) : m_queue(queue)
+    {
+    }
+
     virtual void OnBodyActivated(const JPH::BodyID& inBodyID, uint64_t inBodyUserData) override
     {
-        // std::cout << "A body got activated" << std::endl;
+        m_queue.Push({
+            .type      = PhysicsEventType::BodyActivated,
+            .body1     = inBodyID,
+            .userData1 = inBodyUserData,
+        });
     }
 
     virtual void OnBodyDeactivated(const JPH::BodyID& inBodyID, uint64_t inBodyUserData) override
     {
-        // std::cout << "A body went to sleep" << std::endl;
+        m_queue.Push({
+            .type      = PhysicsEventType::BodyDeactivated,
+            .body1     = inBodyID,
+            .userData1 = inBodyUserData,
+        });
+    }
+
+  private:
+    PhysicsEventQueue& m_queue;
+};
+
+// Only saves bodies that are awake, for SnapshotMode::ActiveBodies.
+class ActiveBodiesStateFilter final : public JPH::StateRecorderFilter
+{
+  public:
+    explicit ActiveBodiesStateFilter(const JPH::BodyInterface& bodyInterface) :
+        m_bodyInterface(bodyInterface)
+    {
+    }
+
+    virtual bool ShouldSaveBody(const JPH::Body& inBody) const override
+    {
+        return inBody.IsActive();
+    }
+
+    virtual bool ShouldSaveContact(const JPH::BodyID& inBody1, const JPH::BodyID& inBody2)
+        const override
+    {
+        return m_bodyInterface.IsActive(inBody1) || m_bodyInterface.IsActive(inBody2);
     }
+
+  private:
+    const JPH::BodyInterface& m_bodyInterface;
 };
 
 class Physics final : public IPhysics
@@ -149,7 +259,7 @@ class Physics final : public IPhysics
   public:
     static void Register();
 
-    Physics();
+    Physics(std::shared_ptr<JobSystemThreadPool> jobSystem);
     ~Physics();
 
     Physics(const Physics&)            = delete;
@@ -160,6 +270,16 @@ class Physics final : public IPhysics
     void Optimize() override;
     void Update() override;
 
+    PhysicsStats GetStats() const override
+    {
+        return m_stats;
+    }
+
+    void SetNumThreads(int numThreads) override
+    {
+        m_jobSystem->SetNumThreads(numThreads);
+    }
+
     JPH::BodyID CreateBody(JPH::BodyCreationSettings settings) override;
     void        AddBody(JPH::BodyID id) override;
     void        RemoveBody(JPH::BodyID id) override;
@@ -173,15 +293,101 @@ class Physics final : public IPhysics
     void SetBodyVelocity(JPH::BodyID id, glm::vec3 vel) override;
     void SetBodyAngularVelocity(JPH::BodyID id, glm::vec3 vel) override;
 
+    void SetBodyMotionType(JPH::BodyID id, JPH::EMotionType motionType) override;
+    void MoveBodyKinematic(JPH::BodyID id, glm::vec3 pos, glm::quat rot) override;
+
+    void CastRays(std::span<const RayCastQuery> queries, std::span<RayCastHit> hits) override;
+    void CastShapes(std::span<const ShapeCastQuery> queries, std::span<ShapeCastHit> hits)
+        override;
+    void CollideShapes(
+        std::span<const OverlapQuery> queries,
+        std::span<JPH::BodyID>        bodies,
+        std::span<uint32_t>           counts
+    ) override;
+
+    std::span<const PhysicsEvent> GetEvents() const override
+    {
+        return m_events;
+    }
+    void DispatchEvents() override;
+
+    void SaveState(PhysicsSnapshot& snapshot, SnapshotMode mode = SnapshotMode::Full) override;
+    bool RestoreState(PhysicsSnapshot& snapshot) override;
+
+    void               SetLodSettings(const PhysicsLodSettings& settings) override;
+    PhysicsLodSettings GetLodSettings() const override;
+    void               SetLodObservers(std::span<const glm::vec3> positions) override;
+    PhysicsLodStats    GetLodStats() const override;
+
+    void SetDebugDrawSettings(const PhysicsDebugDrawSettings& settings) override;
+    void RenderDebug(std::shared_ptr<Renderer> renderer) override;
+
+    PhysicsDebugDrawSettings GetDebugDrawSettings() const override;
+
   private:
-    JPH::PhysicsSystem                m_physicsSystem;
-    JPH::TempAllocatorImpl            m_tempAllocator;
-    JobSystemThreadPool               m_jobSystem;
-    BPLayerInterfaceImpl              m_broadPhaseLayerInterface;
-    ObjectVsBroadPhaseLayerFilterImpl m_objectVsBroadphaseLayerFilter;
-    ObjectLayerPairFilterImpl         m_objectVsObjectLayerFilter;
-    MyContactListener                 m_contactListener;
-    MyBodyActivationListener          m_bodyActivationListener;
-    float                             m_maxDeltaTime;
+    struct LodBody
+    {
+        JPH::BodyID id;
+        bool        far;
+        // Velocities from before the body was taken out of the simulation.
+        JPH::Vec3 linearVelocity;
+        JPH::Vec3 angularVelocity;
+    };
+
+    struct SensorPair
+    {
+        JPH::BodyID sensor;
+        JPH::BodyID other;
+        // Sub shape contacts between the bodies, compound shapes can have many.
+        uint32_t numContacts;
+    };
+
+    void UpdateSensors();
+
+    // Queues the exits of the tracked overlaps of a body, or of all with an invalid id, and stops
+    // tracking them. They are dispatched with the events of the next update.
+    void ExitSensorPairs(JPH::BodyID body);
+    void UpdateLod();
+    void CollectDebugDraw();
+    void SetBodyFar(LodBody& body, bool far);
+    void TrackLodBody(JPH::BodyID id);
+    void UntrackLodBody(JPH::BodyID id);
+
+    // Split [0, count) into ranges and run them on the job system, blocking until all are done.
+    template<class F>
+    void ParallelFor(const char* name, uint32_t count, const F& func);
+
+    JPH::PhysicsSystem                   m_physicsSystem;
+    JPH::TempAllocatorImpl               m_tempAllocator;
+    std::shared_ptr<JobSystemThreadPool> m_jobSystem;
+    BPLayerInterfaceImpl                 m_broadPhaseLayerInterface;
+    ObjectVsBroadPhaseLayerFilterImpl    m_objectVsBroadphaseLayerFilter;
+    ObjectLayerPairFilterImpl            m_objectVsObjectLayerFilter;
+    PhysicsEventQueue                    m_eventQueue;
+    ContactListenerImpl                  m_contactListener;
+    BodyActivationListenerImpl           m_bodyActivationListener;
+    std::vector<PhysicsEvent>            m_events;
+    ActiveBodiesStateFilter              m_activeBodiesFilter;
+    PhysicsStats                         m_stats {};
+    float                                m_maxDeltaTime;
+
+    // Bodies may be removed from any thread while the tick thread updates.
+    std::mutex                               m_sensorMutex;
+    std::unordered_map<uint64_t, SensorPair> m_sensorPairs;
+    std::vector<PhysicsEvent>                m_triggerEvents;
+
+    mutable std::mutex                   m_lodMutex;
+    PhysicsLodSettings                   m_lodSettings;
+    std::vector<glm::vec3>               m_lodObservers;
+    std::vector<LodBody>                 m_lodBodies;
+    std::unordered_map<uint32_t, size_t> m_lodBodyIndices;
+    size_t                               m_lodCursor    = 0;
+    uint32_t                             m_numFarBodies = 0;
+
+    mutable std::mutex       m_debugDrawMutex;
+    PhysicsDebugDrawSettings m_debugDrawSettings;
+#ifdef JPH_DEBUG_RENDERER
+    std::unique_ptr<PhysicsDebugRenderer> m_debugRenderer;
+#endif
 };
 }; // namespace legs
@@ -0,0 +1,92 @@
+#ifdef JPH_DEBUG_RENDERER
+
+#include "physics_debug_renderer.hpp"
+
+namespace legs
+{
+static glm::vec3 ToGlm(JPH::RVec3Arg v)
+{
+    return {v.GetX(), v.GetY(), v.GetZ()};
+}
+
+static glm::vec3 ToGlm(JPH::ColorArg color)
+{
+    const auto c = color.ToVec4();
+    return {c.GetX(), c.GetY(), c.GetZ()};
+}
+
+void PhysicsDebugRenderer::DrawLine(
+    JPH::RVec3Arg inFrom,
+    JPH::RVec3Arg inTo,
+    JPH::ColorArg inColor
+)
+{
+    const auto color = ToGlm(inColor);
+    m_lines.push_back({ToGlm(inFrom), color});
+    m_lines.push_back({ToGlm(inTo), color});
+}
+
+void PhysicsDebugRenderer::DrawTriangle(
+    JPH::RVec3Arg    inV1,
+    JPH::RVec3Arg    inV2,
+    JPH::RVec3Arg    inV3,
+    JPH::ColorArg    inColor,
+    JPH::ECastShadow /*inCastShadow*/
+)
+{
+    const auto color = ToGlm(inColor);
+    m_triangles.push_back({ToGlm(inV1), color});
+    m_triangles.push_back({ToGlm(inV2), color});
+    m_triangles.push_back({ToGlm(inV3), color});
+}
+
+void PhysicsDebugRenderer::DrawText3D(
+    JPH::RVec3Arg /*inPosition*/,
+    const std::string_view& /*inString*/,
+    JPH::ColorArg /*inColor*/,
+    float /*inHeight*/
+)
+{
+    // No text rendering in world space.
+}
+
+void PhysicsDebugRenderer::Collect(
+    JPH::PhysicsSystem&             physicsSystem,
+    const PhysicsDebugDrawSettings& settings
+)
+{
+    m_lines.clear();
+    m_triangles.clear();
+
+    m_filter.m_layerMask  = settings.layerMask;
+    m_filter.m_activeOnly = settings.activeOnly;
+
+    JPH::BodyManager::DrawSettings drawSettings;
+    drawSettings.mDrawShape          = true;
+    drawSettings.mDrawShapeWireframe = settings.wireframe;
+    drawSettings.mDrawBoundingBox    = settings.boundingBoxes;
+    drawSettings.mDrawVelocity       = settings.velocities;
+    physicsSystem.DrawBodies(drawSettings, this, &m_filter);
+
+    // Hand the batch over, the vectors keep their capacity for the next collect.
+    std::scoped_lock lock {m_mutex};
+    m_lines.swap(m_renderLines);
+    m_triangles.swap(m_renderTriangles);
+}
+
+void PhysicsDebugRenderer::Clear()
+{
+    std::scoped_lock lock {m_mutex};
+    m_renderLines.clear();
+    m_renderTriangles.clear();
+}
+
+void PhysicsDebugRenderer::Render(Renderer& renderer)
+{
+    std::scoped_lock lock {m_mutex};
+    renderer.DrawDebug(RenderPipeline::DEBUG_TRIANGLE_P_C, m_renderTriangles);
+    renderer.DrawDebug(RenderPipeline::DEBUG_LINE_P_C, m_renderLines);
+}
+}; // namespace legs
+
+#endif // JPH_DEBUG_RENDERER
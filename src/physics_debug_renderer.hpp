@@ -0,0 +1,71 @@
+#pragma once
+
+#ifdef JPH_DEBUG_RENDERER
+
+#include <mutex>
+#include <vector>
+
+#include <legs/jolt_pch.hpp>
+
+#include <Jolt/Renderer/DebugRendererSimple.h>
+
+#include <legs/physics_debug_draw.hpp>
+#include <legs/renderer/renderer.hpp>
+
+namespace legs
+{
+// Skips bodies by layer and activity, so only the interesting part of a big scene is drawn.
+class BodyDrawFilterImpl final : public JPH::BodyDrawFilter
+{
+  public:
+    bool ShouldDraw(const JPH::Body& inBody) const override
+    {
+        if (m_activeOnly && !inBody.IsActive())
+        {
+            return false;
+        }
+        return (m_layerMask & (1u << inBody.GetObjectLayer())) != 0;
+    }
+
+    uint32_t m_layerMask  = ~0u;
+    bool     m_activeOnly = false;
+};
+
+// Batches everything Jolt draws into two vertex lists, lines and triangles.
+// Collect runs on the tick thread after the physics update, Render on the render thread draws
+// the latest complete batch with one draw call per list.
+class PhysicsDebugRenderer final : public JPH::DebugRendererSimple
+{
+  public:
+    void DrawLine(JPH::RVec3Arg inFrom, JPH::RVec3Arg inTo, JPH::ColorArg inColor) override;
+    void DrawTriangle(
+        JPH::RVec3Arg    inV1,
+        JPH::RVec3Arg    inV2,
+        JPH::RVec3Arg    inV3,
+        JPH::ColorArg    inColor,
+        JPH::ECastShadow inCastShadow
+    ) override;
+    void DrawText3D(
+        JPH::RVec3Arg           inPosition,
+        const std::string_view& inString,
+        JPH::ColorArg           inColor,
+        float                   inHeight
+    ) override;
+
+    void Collect(JPH::PhysicsSystem& physicsSystem, const PhysicsDebugDrawSettings& settings);
+    void Clear();
+    void Render(Renderer& renderer);
+
+  private:
+    std::vector<Vertex_P_C> m_lines;
+    std::vector<Vertex_P_C> m_triangles;
+
+    std::mutex              m_mutex;
+    std::vector<Vertex_P_C> m_renderLines;
+    std::vector<Vertex_P_C> m_renderTriangles;
+
+    BodyDrawFilterImpl m_filter;
+};
+}; // namespace legs
+
+#endif // JPH_DEBUG_RENDERER
@@ -0,0 +1,124 @@
+#include <mutex>
+#include <vector>
+
+#include <legs/log.hpp>
+
+#include "physics_events.hpp"
+
+namespace legs
+{
+// Process wide thread numbering, so every queue can index its rings the same way. Slots of exited
+// threads are handed out again, the new thread continues producing into the same rings.
+static constexpr uint32_t cInvalidSlot = UINT32_MAX;
+
+static std::mutex            s_slotMutex;
+static std::vector<uint32_t> s_freeSlots;
+static uint32_t              s_nextThreadSlot = 0;
+
+struct ThreadSlot
+{
+    uint32_t slot = cInvalidSlot;
+
+    ~ThreadSlot()
+    {
+        if (slot != cInvalidSlot)
+        {
+            // The mutex orders this thread's last pushes before the next owner's first.
+            std::scoped_lock lock {s_slotMutex};
+            s_freeSlots.push_back(slot);
+        }
+    }
+};
+static thread_local ThreadSlot t_threadSlot;
+
+static uint32_t GetThreadSlot()
+{
+    if (t_threadSlot.slot == cInvalidSlot)
+    {
+        std::scoped_lock lock {s_slotMutex};
+        if (s_freeSlots.empty())
+        {
+            t_threadSlot.slot = s_nextThreadSlot++;
+        }
+        else
+        {
+            t_threadSlot.slot = s_freeSlots.back();
+            s_freeSlots.pop_back();
+        }
+    }
+    return t_threadSlot.slot;
+}
+
+PhysicsEventQueue::~PhysicsEventQueue()
+{
+    for (auto& ring : m_rings)
+    {
+        delete ring.load();
+    }
+}
+
+PhysicsEventQueue::Ring* PhysicsEventQueue::GetRing(uint32_t slot)
+{
+    Ring* ring = m_rings[slot].load(std::memory_order_acquire);
+    if (ring != nullptr)
+    {
+        return ring;
+    }
+
+    // Only the slot's owner ever writes to it, publish the ring for the consumer.
+    ring = new Ring();
+    m_rings[slot].store(ring, std::memory_order_release);
+
+    uint32_t numRings = m_numRings.load();
+    while (numRings < slot + 1 && !m_numRings.compare_exchange_weak(numRings, slot + 1))
+    {
+    }
+
+    return ring;
+}
+
+void PhysicsEventQueue::Push(const PhysicsEvent& event)
+{
+    const uint32_t slot = GetThreadSlot();
+    if (slot >= cMaxThreads)
+    {
+        if (m_dropped.fetch_add(1) == 0)
+        {
+            LOG_ERROR("Too many concurrent threads producing physics events, dropping");
+        }
+        return;
+    }
+
+    Ring*          ring = GetRing(slot);
+    const uint32_t tail = ring->tail.load(std::memory_order_relaxed);
+    if (tail - ring->head.load(std::memory_order_acquire) >= Ring::cCapacity)
+    {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    ring->events[tail & (Ring::cCapacity - 1)] = event;
+    ring->tail.store(tail + 1, std::memory_order_release);
+}
+
+void PhysicsEventQueue::Drain(std::vector<PhysicsEvent>& out)
+{
+    const uint32_t numRings = m_numRings.load(std::memory_order_acquire);
+    for (uint32_t slot = 0; slot < numRings; slot++)
+    {
+        Ring* ring = m_rings[slot].load(std::memory_order_acquire);
+        if (ring == nullptr)
+        {
+            continue;
+        }
+
+        const uint32_t tail = ring->tail.load(std::memory_order_acquire);
+        uint32_t       head = ring->head.load(std::memory_order_relaxed);
+        for (; head != tail; head++)
+        {
+            out.push_back(ring->events[head & (Ring::cCapacity - 1)]);
+        }
+        ring->head.store(head, std::memory_order_release);
+    }
+}
+}; // namespace legs
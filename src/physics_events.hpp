@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+#include <legs/physics_events.hpp>
+
+namespace legs
+{
+// Multi-producer, single-consumer queue of physics events.
+//
+// Jolt calls the contact and activation listeners from its worker jobs. Every producing thread
+// gets its own single-producer ring so pushing is wait-free, the tick thread drains all rings
+// after the physics update. A full ring drops events (and counts them) instead of blocking a
+// physics job.
+class PhysicsEventQueue
+{
+  public:
+    PhysicsEventQueue() = default;
+    ~PhysicsEventQueue();
+
+    PhysicsEventQueue(const PhysicsEventQueue&)            = delete;
+    PhysicsEventQueue(PhysicsEventQueue&&)                 = delete;
+    PhysicsEventQueue& operator=(const PhysicsEventQueue&) = delete;
+    PhysicsEventQueue& operator=(PhysicsEventQueue&&)      = delete;
+
+    // Safe to call from any thread.
+    void Push(const PhysicsEvent& event);
+
+    // Single consumer only, appends all pushed events to out.
+    void Drain(std::vector<PhysicsEvent>& out);
+
+    // Number of events dropped since the last call.
+    uint64_t TakeDroppedCount()
+    {
+        return m_dropped.exchange(0);
+    }
+
+  private:
+    struct Ring
+    {
+        static constexpr uint32_t cCapacity = 8192;
+        static_assert(JPH::IsPowerOf2(cCapacity));
+
+        alignas(JPH_CACHE_LINE_SIZE) std::atomic<uint32_t> head {0}; ///< Written by consumer
+        alignas(JPH_CACHE_LINE_SIZE) std::atomic<uint32_t> tail {0}; ///< Written by producer
+        PhysicsEvent events[cCapacity];
+    };
+
+    Ring* GetRing(uint32_t slot);
+
+    static constexpr uint32_t cMaxThreads = 128;
+
+    std::atomic<Ring*>    m_rings[cMaxThreads] = {};
+    std::atomic<uint32_t> m_numRings {0};
+    std::atomic<uint64_t> m_dropped {0};
+};
+}; // namespace legs
@@ -0,0 +1,62 @@
+#include <algorithm>
+#include <cstring>
+
+#include <legs/physics_snapshot.hpp>
+
+namespace legs
+{
+PhysicsSnapshot::PhysicsSnapshot(size_t reserveBytes)
+{
+    if (reserveBytes > 0)
+    {
+        m_data.resize(reserveBytes);
+    }
+}
+
+void PhysicsSnapshot::WriteBytes(const void* inData, size_t inNumBytes)
+{
+    if (m_size + inNumBytes > m_data.size())
+    {
+        m_data.resize(std::max(m_data.size() * 2, m_size + inNumBytes));
+    }
+
+    std::memcpy(m_data.data() + m_size, inData, inNumBytes);
+    m_size += inNumBytes;
+}
+
+void PhysicsSnapshot::ReadBytes(void* outData, size_t inNumBytes)
+{
+    if (m_readPos + inNumBytes > m_size)
+    {
+        m_failed = true;
+        std::memset(outData, 0, inNumBytes);
+        return;
+    }
+
+    std::memcpy(outData, m_data.data() + m_readPos, inNumBytes);
+    m_readPos += inNumBytes;
+}
+
+bool PhysicsSnapshot::IsEOF() const
+{
+    return m_readPos >= m_size;
+}
+
+bool PhysicsSnapshot::IsFailed() const
+{
+    return m_failed;
+}
+
+void PhysicsSnapshot::Clear()
+{
+    m_size    = 0;
+    m_readPos = 0;
+    m_failed  = false;
+}
+
+void PhysicsSnapshot::Rewind()
+{
+    m_readPos = 0;
+    m_failed  = false;
+}
+}; // namespace legs
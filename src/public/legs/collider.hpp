@@ -1,11 +1,13 @@
 #pragma once
 
 #include <memory>
+#include <span>
 #include <stdexcept>
 
 #include <legs/jolt_pch.hpp>
 
 #include <legs/components/transform.hpp>
+#include <legs/shape_cache.hpp>
 
 namespace legs
 {
@@ -13,7 +15,8 @@ namespace Layers
 {
 static constexpr JPH::ObjectLayer NON_MOVING = 0;
 static constexpr JPH::ObjectLayer MOVING     = 1;
-static constexpr JPH::ObjectLayer NUM_LAYERS = 2;
+static constexpr JPH::ObjectLayer SENSOR     = 2;
+static constexpr JPH::ObjectLayer NUM_LAYERS = 3;
 }; // namespace Layers
 
 class ObjectLayerPairFilterImpl : public JPH::ObjectLayerPairFilter
@@ -28,6 +31,8 @@ class ObjectLayerPairFilterImpl : public JPH::ObjectLayerPairFilter
                 return inObject2 == Layers::MOVING;
             case Layers::MOVING:
                 return true;
+            case Layers::SENSOR:
+                return inObject2 == Layers::MOVING;
             default:
                 JPH_ASSERT(false);
                 return false;
@@ -35,29 +40,29 @@ class ObjectLayerPairFilterImpl : public JPH::ObjectLayerPairFilter
     }
 };
 
+// Lightweight description of a body, colliders with the same parameters share a cached shape.
+// Subclasses only pick the shape so colliders can be copied around as ICollider by value.
 class ICollider
 {
   public:
     ICollider() = default;
 
-    virtual ~ICollider() = default;
-
-    ICollider(const ICollider&)            = default;
-    ICollider(ICollider&&)                 = default;
-    ICollider& operator=(const ICollider&) = default;
-    ICollider& operator=(ICollider&&)      = default;
+    ICollider(JPH::EMotionType motionType, JPH::ObjectLayer layer, JPH::ShapeRefC shape) :
+        MotionType(motionType),
+        Layer(layer),
+        Shape(shape)
+    {
+    }
 
-    void CreateBody(std::shared_ptr<STransform> trans)
+    JPH::BodyCreationSettings GetCreationSettings(std::shared_ptr<STransform> trans) const
     {
-        JPH::ShapeSettings::ShapeResult shapeResult = ShapeSettings->Create();
-        if (shapeResult.HasError())
+        if (Shape == nullptr)
         {
-            throw std::runtime_error(std::format("Jolt: {}", shapeResult.GetError()));
+            throw std::runtime_error("Collider has no shape");
         }
-        JPH::ShapeRefC shape = shapeResult.Get();
 
-        CreationSettings = JPH::BodyCreationSettings(
-            shape,
+        auto settings = JPH::BodyCreationSettings(
+            Shape,
             JPH::RVec3(trans->position.x, trans->position.y, trans->position.z),
             JPH::Quat(
                 trans->rotation.quaternion.x,
@@ -68,53 +73,98 @@ class ICollider
             MotionType,
             Layer
         );
+        settings.mIsSensor = IsSensor;
+        return settings;
     }
 
-    JPH::EMotionType                    MotionType;
-    JPH::ObjectLayer                    Layer;
-    JPH::BodyCreationSettings           CreationSettings;
-    std::shared_ptr<JPH::ShapeSettings> ShapeSettings;
+    JPH::EMotionType MotionType = JPH::EMotionType::Static;
+    JPH::ObjectLayer Layer      = Layers::NON_MOVING;
+    JPH::ShapeRefC   Shape;
+    bool             IsSensor = false;
 };
 
 class BoxCollider final : public ICollider
 {
   public:
-    BoxCollider(
-        JPH::EMotionType            motionType,
-        JPH::ObjectLayer            layer,
-        std::shared_ptr<STransform> trans,
-        glm::vec3                   size
-    )
+    BoxCollider(JPH::EMotionType motionType, JPH::ObjectLayer layer, glm::vec3 size) :
+        ICollider(motionType, layer, ShapeCache::GetBox(size))
     {
-        MotionType    = motionType;
-        Layer         = layer;
-        ShapeSettings = std::make_shared<JPH::BoxShapeSettings>(JPH::Vec3(size.x, size.y, size.z));
-        CreateBody(trans);
     }
+};
 
-    ~BoxCollider()
+class SphereCollider final : public ICollider
+{
+  public:
+    SphereCollider(JPH::EMotionType motionType, JPH::ObjectLayer layer, float radius) :
+        ICollider(motionType, layer, ShapeCache::GetSphere(radius))
     {
     }
 };
 
-class SphereCollider final : public ICollider
+// Triangle mesh built from the same vertex and index data passed to Renderer::CreateBuffer,
+// vertices must start with a glm::vec3 position. Jolt can't simulate dynamic meshes.
+class MeshCollider final : public ICollider
 {
   public:
-    SphereCollider(
-        JPH::EMotionType            motionType,
-        JPH::ObjectLayer            layer,
-        std::shared_ptr<STransform> trans,
-        float                       radius
+    MeshCollider(
+        JPH::EMotionType          motionType,
+        JPH::ObjectLayer          layer,
+        const void*               vertices,
+        uint32_t                  vertexSize,
+        uint32_t                  vertexCount,
+        std::span<const uint32_t> indices
+    ) :
+        ICollider(
+            motionType,
+            layer,
+            GetShape(motionType, vertices, vertexSize, vertexCount, indices)
+        )
+    {
+    }
+
+  private:
+    // Rejects dynamic meshes before anything is cooked or written to the disk cache.
+    static JPH::ShapeRefC GetShape(
+        JPH::EMotionType          motionType,
+        const void*               vertices,
+        uint32_t                  vertexSize,
+        uint32_t                  vertexCount,
+        std::span<const uint32_t> indices
     )
     {
-        MotionType    = motionType;
-        Layer         = layer;
-        ShapeSettings = std::make_shared<JPH::SphereShapeSettings>(radius);
-        CreateBody(trans);
+        if (motionType == JPH::EMotionType::Dynamic)
+        {
+            throw std::runtime_error("MeshCollider can't be dynamic");
+        }
+        return ShapeCache::GetMesh(vertices, vertexSize, vertexCount, indices);
+    }
+};
+
+// Convex hull around the vertex positions, see MeshCollider for the vertex layout.
+class ConvexHullCollider final : public ICollider
+{
+  public:
+    ConvexHullCollider(
+        JPH::EMotionType motionType,
+        JPH::ObjectLayer layer,
+        const void*      vertices,
+        uint32_t         vertexSize,
+        uint32_t         vertexCount
+    ) :
+        ICollider(motionType, layer, ShapeCache::GetConvexHull(vertices, vertexSize, vertexCount))
+    {
     }
+};
 
-    ~SphereCollider()
+// Trigger volume on the sensor layer, reports TriggerEnter and TriggerExit events for moving
+// bodies instead of colliding with them.
+class SensorCollider final : public ICollider
+{
+  public:
+    SensorCollider(JPH::ShapeRefC shape, JPH::EMotionType motionType = JPH::EMotionType::Static) :
+        ICollider(motionType, Layers::SENSOR, shape)
     {
+        IsSensor = true;
     }
 };
 }; // namespace legs
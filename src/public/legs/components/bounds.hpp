@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <glm/vec3.hpp>
+
+namespace legs
+{
+// Local space bounding box and the sphere around it.
+struct SBounds
+{
+    glm::vec3 min    = glm::vec3(0.0f);
+    glm::vec3 max    = glm::vec3(0.0f);
+    glm::vec3 center = glm::vec3(0.0f);
+    float     radius = 0.0f;
+
+    // Reads the position from the start of every vertex, stride bytes apart.
+    static SBounds FromVertices(const void* vertices, uint32_t stride, uint32_t count)
+    {
+        SBounds bounds;
+        if (count == 0)
+        {
+            return bounds;
+        }
+
+        const auto* bytes = static_cast<const uint8_t*>(vertices);
+        std::memcpy(&bounds.min, bytes, sizeof(glm::vec3));
+        bounds.max = bounds.min;
+        for (uint32_t i = 1; i < count; i++)
+        {
+            glm::vec3 position;
+            std::memcpy(&position, bytes + size_t(i) * stride, sizeof(glm::vec3));
+            bounds.min = glm::min(bounds.min, position);
+            bounds.max = glm::max(bounds.max, position);
+        }
+
+        bounds.center = 0.5f * (bounds.min + bounds.max);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            glm::vec3 position;
+            std::memcpy(&position, bytes + size_t(i) * stride, sizeof(glm::vec3));
+            bounds.radius = glm::max(bounds.radius, glm::distance(bounds.center, position));
+        }
+
+        return bounds;
+    }
+};
+}; // namespace legs
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <glm/geometric.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/vec4.hpp>
+
+namespace legs
+{
+// Planes of a view projection matrix, xyz is the inward normal and w the distance.
+struct SFrustum
+{
+    static constexpr int cNumPlanes = 6;
+
+    glm::vec4 planes[cNumPlanes];
+
+    SFrustum() = default;
+
+    // Gribb-Hartmann extraction, for clip space depth in [0, 1] (GLM_FORCE_DEPTH_ZERO_TO_ONE).
+    explicit SFrustum(const glm::mat4& viewProj)
+    {
+        const glm::vec4 row0 = {viewProj[0][0], viewProj[1][0], viewProj[2][0], viewProj[3][0]};
+        const glm::vec4 row1 = {viewProj[0][1], viewProj[1][1], viewProj[2][1], viewProj[3][1]};
+        const glm::vec4 row2 = {viewProj[0][2], viewProj[1][2], viewProj[2][2], viewProj[3][2]};
+        const glm::vec4 row3 = {viewProj[0][3], viewProj[1][3], viewProj[2][3], viewProj[3][3]};
+
+        planes[0] = row3 + row0; // Left
+        planes[1] = row3 - row0; // Right
+        planes[2] = row3 + row1; // Bottom
+        planes[3] = row3 - row1; // Top
+        planes[4] = row2;        // Near
+        planes[5] = row3 - row2; // Far
+
+        for (auto& plane : planes)
+        {
+            plane /= glm::length(glm::vec3(plane));
+        }
+    }
+
+    bool IsSphereVisible(const glm::vec3& center, float radius) const
+    {
+        for (const auto& plane : planes)
+        {
+            if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+}; // namespace legs
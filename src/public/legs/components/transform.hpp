@@ -2,12 +2,38 @@
 
 #include <glm/ext/matrix_float4x4.hpp>
 #include <glm/ext/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
 #include <glm/vec3.hpp>
 
 #include <legs/components/rotation.hpp>
 
 namespace legs
 {
+// Rigid transform from a unit quaternion, written column by column without trigonometry so the
+// compiler can keep it in vector registers.
+inline glm::mat4x4 ComposeMatrix(const glm::vec3& position, const glm::quat& rotation)
+{
+    const float x2 = rotation.x + rotation.x;
+    const float y2 = rotation.y + rotation.y;
+    const float z2 = rotation.z + rotation.z;
+    const float xx = rotation.x * x2;
+    const float yy = rotation.y * y2;
+    const float zz = rotation.z * z2;
+    const float xy = rotation.x * y2;
+    const float xz = rotation.x * z2;
+    const float yz = rotation.y * z2;
+    const float wx = rotation.w * x2;
+    const float wy = rotation.w * y2;
+    const float wz = rotation.w * z2;
+
+    return glm::mat4x4 {
+        {1.0f - (yy + zz),          xy + wz,          xz - wy, 0.0f},
+        {         xy - wz, 1.0f - (xx + zz),          yz + wx, 0.0f},
+        {         xz + wy,          yz - wx, 1.0f - (xx + yy), 0.0f},
+        {      position.x,       position.y,       position.z, 1.0f},
+    };
+}
+
 struct STransform
 {
     glm::vec3 position;
@@ -15,14 +41,10 @@ struct STransform
     glm::vec3 velocity;
     glm::vec3 angularVelocity;
 
-    glm::mat4x4 GetModelMatrix()
+    // Local matrix, entities in a world have a cached world matrix in the TransformHierarchy.
+    glm::mat4x4 GetModelMatrix() const
     {
-        auto model = glm::identity<glm::mat4x4>();
-        model      = glm::translate(model, position);
-        model      = glm::rotate(model, glm::radians(rotation.euler.x), glm::vec3 {1, 0, 0});
-        model      = glm::rotate(model, glm::radians(rotation.euler.y), glm::vec3 {0, 1, 0});
-        model      = glm::rotate(model, glm::radians(rotation.euler.z), glm::vec3 {0, 0, 1});
-        return model;
+        return ComposeMatrix(position, rotation.quaternion);
     }
 
     glm::vec3 Forward()
@@ -1,16 +1,26 @@
 #pragma once
 
+#include <atomic>
+#include <coroutine>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <semaphore>
 #include <stop_token>
 #include <thread>
+#include <utility>
+#include <vector>
 
 #include <glm/gtc/quaternion.hpp>
 #include <glm/vec3.hpp>
 
 #include <legs/world/world.hpp>
 
+#include <legs/engine_settings.hpp>
 #include <legs/isystem.hpp>
+#include <legs/jobs.hpp>
+#include <legs/task.hpp>
 #include <legs/renderer/renderer.hpp>
 #include <legs/ui/ui.hpp>
 #include <legs/window/input.hpp>
@@ -18,14 +28,56 @@
 
 namespace legs
 {
+struct ThreadPlacement;
+class Engine;
+
+// Continues a task on a job of the given priority.
+struct JobAwaiter
+{
+    Engine*     engine;
+    JobPriority priority;
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> handle) const;
+
+    void await_resume() const noexcept
+    {
+    }
+};
+
+// Continues a task on a job once the timeline reached the value, polled every frame.
+struct TimelineAwaiter
+{
+    Engine*              engine;
+    const QueueTimeline* timeline;
+    uint64_t             value;
+
+    bool await_ready() const;
+    void await_suspend(std::coroutine_handle<> handle) const;
+
+    void await_resume() const noexcept
+    {
+    }
+};
+
 class Engine
 {
   public:
-    Engine();
+    Engine(const EngineSettings& settings = {});
     ~Engine();
 
     int Run();
 
+    // Stop the engine loop at the next tick, safe to call from any thread.
+    void Quit()
+    {
+        m_wantsQuit = true;
+    }
+
     std::shared_ptr<Window> GetWindow() const
     {
         return m_window;
@@ -66,7 +118,52 @@ class Engine
         return m_tickInput;
     }
 
+    // Run a function on the job system workers, safe to call from any thread. Keep frame critical
+    // for work the current tick waits on, a cancelled job completes without running.
+    JPH::JobHandle CreateJob(
+        const char*           name,
+        JobPriority           priority,
+        std::function<void()> function,
+        const JobCancelToken& cancelToken = JobCancelToken::None()
+    );
+
+    // As above, the job is counted in counter until it completes or is cancelled.
+    JPH::JobHandle CreateJob(
+        const char*           name,
+        JobPriority           priority,
+        std::function<void()> function,
+        JobCounter&           counter,
+        const JobCancelToken& cancelToken = JobCancelToken::None()
+    );
+
+    JobSystemStats GetJobStats() const;
+
+    // Wait until all jobs of the counter completed. A job waiting here is parked and resumed later
+    // when job fibers are enabled, otherwise its worker runs other jobs meanwhile.
+    void WaitForCounter(JobCounter& counter);
+
+    // Run jobs on fibers so waiting jobs don't hold a worker. Call before Run.
+    void SetJobFibers(bool enabled);
+
+    // Run a task on the job system, the engine keeps it alive until it completes. Tasks still
+    // suspended when the engine is destroyed are destroyed with it.
+    void StartTask(Task<> task);
+
+    // Awaitables for tasks, every one of them continues the task on a job. Frame and physics step
+    // waiters continue after the next rendered frame or physics update.
+    JobAwaiter            Schedule(JobPriority priority = JobPriority::Normal);
+    TaskWaitList::Awaiter NextFrame();
+    TaskWaitList::Awaiter NextPhysicsStep();
+    TimelineAwaiter       WaitForTimeline(const QueueTimeline& timeline, uint64_t value);
+
   private:
+    friend struct JobAwaiter;
+    friend struct TimelineAwaiter;
+
+    void ResumeOnJob(std::coroutine_handle<> handle, JobPriority priority);
+    void ResumeWaitList(TaskWaitList& list);
+    void PollTimelines();
+
     void Frame();
     bool Tick();
 
@@ -75,16 +172,22 @@ class Engine
     void TickThread(const std::stop_token token);
     void RenderThread(const std::stop_token token);
 
-    std::shared_ptr<InputSettings> m_inputSettings;
-    std::shared_ptr<Window>        m_window;
-    std::shared_ptr<Camera>        m_camera;
-    std::shared_ptr<Renderer>      m_renderer;
-    std::shared_ptr<World>         m_world;
-    std::unique_ptr<UI>            m_ui;
+    std::shared_ptr<InputSettings>       m_inputSettings;
+    std::shared_ptr<Window>              m_window;
+    std::shared_ptr<Camera>              m_camera;
+    std::shared_ptr<Renderer>            m_renderer;
+    std::shared_ptr<JobSystemThreadPool> m_jobSystem;
+    std::shared_ptr<World>               m_world;
+    std::unique_ptr<UI>                  m_ui;
+
+    std::unique_ptr<ThreadPlacement> m_threadPlacement;
 
     WindowInput m_frameInput;
     WindowInput m_tickInput;
 
+    // Camera position for the physics LOD, taken by the main thread before each tick.
+    std::optional<glm::vec3> m_tickObserver;
+
     std::jthread m_tickThread;
     std::jthread m_renderThread;
 
@@ -95,5 +198,14 @@ class Engine
     std::binary_semaphore m_threadFrameSemaphore {0};
 
     std::vector<std::shared_ptr<ISystem>> m_systems;
+
+    std::atomic<bool> m_wantsQuit {false};
+
+    DetachedTasks m_detachedTasks;
+    TaskWaitList  m_frameWaiters;
+    TaskWaitList  m_physicsWaiters;
+
+    std::mutex                                                       m_timelineMutex;
+    std::vector<std::pair<TimelineAwaiter, std::coroutine_handle<>>> m_timelineWaiters;
 };
 } // namespace legs
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace legs
+{
+// CPU placement of the engine threads, CPUs are logical CPU numbers as in /sys. Automatic
+// placement (-1 / empty) pins the main, tick and render threads to distinct physical cores,
+// preferring performance cores, and lets the job workers float over the remaining cores minus
+// the SMT siblings of the pinned threads.
+struct ThreadSettings
+{
+    bool             pinThreads = true;
+    int              mainCpu    = -1;
+    int              tickCpu    = -1;
+    int              renderCpu  = -1;
+    std::vector<int> workerCpus;
+    // Job system workers, -1 for one per worker CPU.
+    int numWorkers = -1;
+};
+
+struct EngineSettings
+{
+    ThreadSettings threads;
+    // Run jobs on fibers, see Engine::SetJobFibers.
+    bool jobFibers = false;
+    // Frames the CPU may record ahead of the GPU, 2 or 3.
+    uint32_t framesInFlight = 2;
+};
+}; // namespace legs
@@ -4,6 +4,7 @@
 #include <string>
 
 #include <legs/components/transform.hpp>
+#include <legs/world/transform_hierarchy.hpp>
 
 namespace legs
 {
@@ -22,6 +23,8 @@ class Entity
     virtual void OnDestroy() {};
     virtual void OnFrame() {};
     virtual void OnTick() {};
+    // After the world transforms were updated for this tick.
+    virtual void OnTransformUpdate() {};
 
     virtual void SetPosition(glm::vec3 pos)
     {
@@ -48,6 +51,17 @@ class Entity
         return Transform;
     }
 
+    // Node in the world's TransformHierarchy, Transform is relative to the parent entity.
+    TransformId GetTransformId() const
+    {
+        return m_transformId;
+    }
+
+    void SetTransformId(TransformId id)
+    {
+        m_transformId = id;
+    }
+
     virtual glm::vec3 GetPosition()
     {
         return Transform->position;
@@ -71,5 +85,7 @@ class Entity
   protected:
     std::string                 Name;
     std::shared_ptr<STransform> Transform;
+
+    TransformId m_transformId = cInvalidTransformId;
 };
 }; // namespace legs
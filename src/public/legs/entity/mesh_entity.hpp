@@ -3,6 +3,7 @@
 #include <memory>
 #include <string>
 
+#include <legs/components/bounds.hpp>
 #include <legs/entity/entity.hpp>
 #include <legs/renderer/buffer.hpp>
 #include <legs/renderer/renderer.hpp>
@@ -43,6 +44,12 @@ class MeshEntity : public Entity
         Entity::OnTick();
     }
 
+    virtual void OnTransformUpdate() override
+    {
+        Entity::OnTransformUpdate();
+    }
+
+    // Takes the bounds of vertex buffers made by Renderer::CreateBuffer.
     virtual void SetBuffers(
         std::shared_ptr<Buffer> vertexBuffer,
         std::shared_ptr<Buffer> indexBuffer
@@ -50,8 +57,47 @@ class MeshEntity : public Entity
     {
         m_vertexBuffer = vertexBuffer;
         m_indexBuffer  = indexBuffer;
+        if (m_vertexBuffer != nullptr && m_vertexBuffer->HasBounds())
+        {
+            SetBounds(m_vertexBuffer->GetBounds());
+        }
     }
 
+    // Geometry arena mesh, used instead of the buffers when set. Takes the bounds of the mesh.
+    // With GPU culling the world draws it as a culled draw, mesh and pipeline are taken when the
+    // entity is added.
+    virtual void SetMesh(std::shared_ptr<Mesh> mesh)
+    {
+        m_mesh = mesh;
+        if (m_mesh != nullptr)
+        {
+            SetBounds(m_mesh->GetBounds());
+        }
+    }
+
+    const std::shared_ptr<Mesh>& GetMesh() const
+    {
+        return m_mesh;
+    }
+
+    // Local space bounds of the vertices for frustum culling, entities without are always drawn.
+    void SetBounds(const SBounds& bounds)
+    {
+        m_bounds    = bounds;
+        m_hasBounds = true;
+    }
+
+    bool HasBounds() const
+    {
+        return m_hasBounds;
+    }
+
+    const SBounds& GetBounds() const
+    {
+        return m_bounds;
+    }
+
+    // Called every frame, except for entities drawn as culled draws.
     virtual void Render(std::shared_ptr<Renderer> renderer)
     {
         if (m_pipeline == RenderPipeline::INVALID)
@@ -59,9 +105,14 @@ class MeshEntity : public Entity
             return;
         }
 
-        // TODO: Transform matrices
-        renderer->BindPipeline(m_pipeline);
-        renderer->DrawWithBuffers(m_vertexBuffer, m_indexBuffer);
+        if (m_mesh != nullptr)
+        {
+            renderer->QueueDraw(m_pipeline, m_mesh, m_transformId);
+        }
+        else
+        {
+            renderer->QueueDraw(m_pipeline, m_vertexBuffer, m_indexBuffer, m_transformId);
+        }
     }
 
     virtual void SetPipeline(RenderPipeline pipeline)
@@ -69,9 +120,17 @@ class MeshEntity : public Entity
         m_pipeline = pipeline;
     }
 
+    RenderPipeline GetPipeline() const
+    {
+        return m_pipeline;
+    }
+
   protected:
     RenderPipeline          m_pipeline;
     std::shared_ptr<Buffer> m_vertexBuffer;
     std::shared_ptr<Buffer> m_indexBuffer;
+    std::shared_ptr<Mesh>   m_mesh;
+    SBounds                 m_bounds;
+    bool                    m_hasBounds = false;
 };
 }; // namespace legs
@@ -10,7 +10,7 @@
 
 namespace legs
 {
-class PhysicsEntity : public MeshEntity
+class PhysicsEntity : public MeshEntity, public IPhysicsListener
 {
   public:
     PhysicsEntity() : MeshEntity()
@@ -27,7 +27,9 @@ class PhysicsEntity : public MeshEntity
     virtual void OnSpawn() override
     {
         MeshEntity::OnSpawn();
-        m_joltBody = g_engine->GetWorld()->GetPhysics()->CreateBody(m_collider.CreationSettings);
+        auto settings      = m_collider.GetCreationSettings(Transform);
+        settings.mUserData = GetListenerUserData();
+        m_joltBody         = g_engine->GetWorld()->GetPhysics()->CreateBody(settings);
         g_engine->GetWorld()->GetPhysics()->AddBody(m_joltBody);
     }
 
@@ -46,7 +48,54 @@ class PhysicsEntity : public MeshEntity
     virtual void OnTick() override
     {
         MeshEntity::OnTick();
-        g_engine->GetWorld()->GetPhysics()->GetBodyTransform(m_joltBody, Transform);
+
+        // Attached bodies follow their parent instead.
+        if (!IsAttached())
+        {
+            g_engine->GetWorld()->GetPhysics()->GetBodyTransform(m_joltBody, Transform);
+        }
+    }
+
+    virtual void OnTransformUpdate() override
+    {
+        MeshEntity::OnTransformUpdate();
+
+        const auto physics  = g_engine->GetWorld()->GetPhysics();
+        const bool attached = IsAttached();
+        const bool isStatic = m_collider.MotionType == JPH::EMotionType::Static;
+
+        // Attached bodies are kinematic, the simulation must not move them on its own and they
+        // push other bodies out of their way instead of teleporting into them.
+        const bool changed = attached != m_attached;
+        if (changed && !isStatic)
+        {
+            physics->SetBodyMotionType(
+                m_joltBody,
+                attached ? JPH::EMotionType::Kinematic : m_collider.MotionType
+            );
+        }
+        m_attached = attached;
+
+        if (!attached)
+        {
+            return;
+        }
+
+        const auto& transforms = g_engine->GetWorld()->GetTransforms();
+        const auto  position   = transforms.GetWorldPosition(m_transformId);
+        const auto  rotation   = transforms.GetWorldRotation(m_transformId);
+        if (!isStatic)
+        {
+            physics->MoveBodyKinematic(m_joltBody, position, rotation);
+        }
+        else if (changed || position != m_attachedPosition || rotation != m_attachedRotation)
+        {
+            // Static bodies can only be teleported, but not every tick.
+            physics->SetBodyPosition(m_joltBody, position);
+            physics->SetBodyRotation(m_joltBody, rotation);
+        }
+        m_attachedPosition = position;
+        m_attachedRotation = rotation;
     }
 
     virtual void SetPosition(glm::vec3 pos) override
@@ -73,13 +122,30 @@ class PhysicsEntity : public MeshEntity
         g_engine->GetWorld()->GetPhysics()->SetBodyAngularVelocity(m_joltBody, vel);
     }
 
-    virtual void SetCollider(ICollider collider)
+    // Contacts and activation of this entity's body.
+    virtual void OnPhysicsEvent(const PhysicsEvent& /*event*/) override
+    {
+    }
+
+    virtual void SetCollider(const ICollider& collider)
     {
         m_collider = collider;
     }
 
   protected:
+    bool IsAttached() const
+    {
+        return m_transformId != cInvalidTransformId
+            && g_engine->GetWorld()->GetTransforms().GetParent(m_transformId)
+                   != cInvalidTransformId;
+    }
+
     JPH::BodyID m_joltBody;
     ICollider   m_collider;
+
+    // World transform the body was last moved to while attached.
+    bool      m_attached = false;
+    glm::vec3 m_attachedPosition {};
+    glm::quat m_attachedRotation {};
 };
 }; // namespace legs
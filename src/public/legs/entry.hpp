@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdlib>
 #include <cstring>
 #include <exception>
 
@@ -29,11 +30,48 @@ static bool HasLaunchArg(const char* name, const char* value, int argc, char** a
     return false;
 }
 
-static int LEGS_Init(int /*argc*/, char** /*argv*/)
+// Value following name, or nullptr if the argument was not given.
+static const char* GetLaunchArg(const char* name, int argc, char** argv)
 {
+    for (int i = 0; i < argc - 1; i++)
+    {
+        if (std::strcmp(name, argv[i]) == 0)
+        {
+            return argv[i + 1];
+        }
+    }
+    return nullptr;
+}
+
+// Launch arguments override the thread settings:
+//   --no-thread-pinning, --main-cpu <n>, --tick-cpu <n>, --render-cpu <n>, --job-workers <n>,
+//   --job-fibers
+static int LEGS_Init(int argc, char** argv, EngineSettings settings = {})
+{
+    auto intArg = [argc, argv](const char* name, int& value)
+    {
+        if (auto arg = GetLaunchArg(name, argc, argv))
+        {
+            value = std::atoi(arg);
+        }
+    };
+
+    if (HasLaunchArg("--no-thread-pinning", nullptr, argc, argv))
+    {
+        settings.threads.pinThreads = false;
+    }
+    intArg("--main-cpu", settings.threads.mainCpu);
+    intArg("--tick-cpu", settings.threads.tickCpu);
+    intArg("--render-cpu", settings.threads.renderCpu);
+    intArg("--job-workers", settings.threads.numWorkers);
+    if (HasLaunchArg("--job-fibers", nullptr, argc, argv))
+    {
+        settings.jobFibers = true;
+    }
+
     try
     {
-        g_engine = std::make_shared<legs::Engine>();
+        g_engine = std::make_shared<legs::Engine>(settings);
         return 0;
     }
     catch (std::exception& ex)
@@ -1,13 +1,22 @@
 #pragma once
 
 #include <memory>
+#include <span>
 
 #include <legs/jolt_pch.hpp>
 
 #include <legs/components/transform.hpp>
+#include <legs/physics_debug_draw.hpp>
+#include <legs/physics_events.hpp>
+#include <legs/physics_lod.hpp>
+#include <legs/physics_query.hpp>
+#include <legs/physics_snapshot.hpp>
+#include <legs/physics_stats.hpp>
 
 namespace legs
 {
+class Renderer;
+
 class IPhysics
 {
   public:
@@ -22,6 +31,11 @@ class IPhysics
     virtual void Update()   = 0;
     virtual void Optimize() = 0;
 
+    virtual PhysicsStats GetStats() const = 0;
+    // Number of engine job system worker threads, -1 for one per CPU minus the calling thread.
+    // The workers are shared with all engine jobs. Must not be called while jobs are running.
+    virtual void SetNumThreads(int numThreads) = 0;
+
     virtual JPH::BodyID CreateBody(JPH::BodyCreationSettings settings) = 0;
     virtual void        AddBody(JPH::BodyID id)                        = 0;
     virtual void        RemoveBody(JPH::BodyID id)                     = 0;
@@ -34,5 +48,50 @@ class IPhysics
     virtual void SetBodyRotation(JPH::BodyID id, glm::quat rot)        = 0;
     virtual void SetBodyVelocity(JPH::BodyID id, glm::vec3 vel)        = 0;
     virtual void SetBodyAngularVelocity(JPH::BodyID id, glm::vec3 vel) = 0;
+
+    // Static bodies can't change their motion type.
+    virtual void SetBodyMotionType(JPH::BodyID id, JPH::EMotionType motionType) = 0;
+    // Kinematic bodies only, reaches the target in one tick pushing other bodies aside.
+    virtual void MoveBodyKinematic(JPH::BodyID id, glm::vec3 pos, glm::quat rot) = 0;
+
+    // Batched queries, hits[i] is the result of queries[i].
+    // These run on the physics job system, call them from the tick thread (e.g. OnTick)
+    // so they don't overlap with Update.
+    virtual void CastRays(std::span<const RayCastQuery> queries, std::span<RayCastHit> hits) = 0;
+    virtual void CastShapes(
+        std::span<const ShapeCastQuery> queries,
+        std::span<ShapeCastHit>         hits
+    ) = 0;
+
+    // Bodies overlapping queries[i] are written to bodies[i * n, i * n + counts[i]),
+    // where n = bodies.size() / queries.size().
+    virtual void CollideShapes(
+        std::span<const OverlapQuery> queries,
+        std::span<JPH::BodyID>        bodies,
+        std::span<uint32_t>           counts
+    ) = 0;
+
+    // Contact and activation events queued during the latest Update.
+    virtual std::span<const PhysicsEvent> GetEvents() const = 0;
+    // Hands the events to the IPhysicsListener stored in the body user data, if any.
+    virtual void DispatchEvents() = 0;
+
+    // Overwrites the snapshot with the current state, call from the tick thread.
+    virtual void SaveState(PhysicsSnapshot& snapshot, SnapshotMode mode = SnapshotMode::Full) = 0;
+    // Restores a snapshot made by SaveState, returns false if it could not be read.
+    // Bodies must not have been added or removed since the snapshot was saved.
+    virtual bool RestoreState(PhysicsSnapshot& snapshot) = 0;
+
+    // Level of detail for dynamic bodies, evaluated at the start of Update.
+    virtual void               SetLodSettings(const PhysicsLodSettings& settings)    = 0;
+    virtual PhysicsLodSettings GetLodSettings() const                                = 0;
+    virtual void               SetLodObservers(std::span<const glm::vec3> positions) = 0;
+    virtual PhysicsLodStats    GetLodStats() const                                   = 0;
+
+    // Bodies are drawn into a buffer at the end of Update, RenderDebug submits the latest one.
+    virtual void SetDebugDrawSettings(const PhysicsDebugDrawSettings& settings) = 0;
+    virtual void RenderDebug(std::shared_ptr<Renderer> renderer)               = 0;
+
+    virtual PhysicsDebugDrawSettings GetDebugDrawSettings() const = 0;
 };
 }; // namespace legs
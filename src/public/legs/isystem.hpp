@@ -1,5 +1,9 @@
 #pragma once
 
+#include <span>
+
+#include <legs/physics_events.hpp>
+
 namespace legs
 {
 class ISystem
@@ -16,5 +20,7 @@ class ISystem
     virtual void OnLevelLoad() {};
     virtual void OnFrame() {};
     virtual void OnTick() {};
+    // Events of the latest physics update, called on the tick thread after World::Tick.
+    virtual void OnPhysicsEvents(std::span<const PhysicsEvent> /*events*/) {};
 };
 }; // namespace legs
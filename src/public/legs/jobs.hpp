@@ -0,0 +1,110 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace legs
+{
+// Workers always take the highest priority job available. Background jobs never occupy every
+// worker, so long running loading work can't delay the jobs that gate the tick.
+enum class JobPriority : uint8_t
+{
+    // Physics and anything else the current tick waits for.
+    FrameCritical,
+    Normal,
+    // Asset decoding, shape cooking, streaming.
+    Background,
+};
+
+static constexpr uint32_t cNumJobPriorities = 3;
+
+// Cumulative counters of one job system worker, times in seconds.
+struct JobWorkerStats
+{
+    double   busyTime;
+    // Sleeping while there was nothing to run.
+    double   idleTime;
+    uint64_t jobsExecuted;
+    uint64_t fibersResumed;
+};
+
+struct JobSystemStats
+{
+    std::vector<JobWorkerStats>             workers;
+    // Jobs queued but not taken yet, per JobPriority.
+    std::array<uint32_t, cNumJobPriorities> queueDepth;
+    // Producers sleeping because a queue was full.
+    double                                  queueFullTime;
+    uint64_t                                queueFullCount;
+    // Threads waiting for a barrier, mostly the tick thread in the physics update.
+    double                                  barrierWaitTime;
+};
+
+// Shared flag checked right before a job runs, a cancelled job completes without running.
+// Copies refer to the same flag.
+class JobCancelToken
+{
+  public:
+    JobCancelToken() : m_cancelled(std::make_shared<std::atomic<bool>>(false))
+    {
+    }
+
+    // Never cancelled, shared by the jobs created without a token of their own.
+    static const JobCancelToken& None()
+    {
+        static const JobCancelToken token;
+        return token;
+    }
+
+    void Cancel()
+    {
+        m_cancelled->store(true, std::memory_order_relaxed);
+    }
+
+    bool IsCancelled() const
+    {
+        return m_cancelled->load(std::memory_order_relaxed);
+    }
+
+  private:
+    std::shared_ptr<std::atomic<bool>> m_cancelled;
+};
+
+// Number of unfinished jobs created with it, see Engine::CreateJob. A job waiting on a counter
+// with Engine::WaitForCounter gives its worker to other jobs when job fibers are enabled, and
+// resumes on any worker once the counter reaches zero. The counter may be destroyed once a wait
+// returned or IsDone was true, not before.
+class JobCounter
+{
+  public:
+    JobCounter() = default;
+
+    JobCounter(const JobCounter&)            = delete;
+    JobCounter(JobCounter&&)                 = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+    JobCounter& operator=(JobCounter&&)      = delete;
+
+    bool IsDone() const
+    {
+        if (m_count.load(std::memory_order_acquire) != 0)
+        {
+            return false;
+        }
+
+        // The last job reaches zero under the lock, wait for it to let go of the counter.
+        std::scoped_lock lock(m_mutex);
+        return true;
+    }
+
+  private:
+    friend class JobSystemThreadPool;
+
+    std::atomic<uint32_t> m_count {0};
+    mutable std::mutex    m_mutex;
+    std::vector<void*>    m_waiters; // Fibers parked on this counter
+};
+}; // namespace legs
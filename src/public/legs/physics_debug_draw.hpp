@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+
+namespace legs
+{
+// Only available when JPH_DEBUG_RENDERER is defined, see the physics_debug_renderer option.
+struct PhysicsDebugDrawSettings
+{
+    bool enabled       = false;
+    bool wireframe     = true;
+    bool boundingBoxes = false;
+    bool velocities    = false;
+    // Skip sleeping bodies, in large scenes most bodies are asleep.
+    bool activeOnly = false;
+    // Bit per object layer, see Layers.
+    uint32_t layerMask = ~0u;
+    // Vertices the renderer maps per frame in flight at 24 bytes each, the rest is dropped.
+    uint32_t maxVertices = 1 << 18;
+};
+}; // namespace legs
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include <glm/vec3.hpp>
+
+#include <legs/jolt_pch.hpp>
+
+namespace legs
+{
+enum class PhysicsEventType : uint8_t
+{
+    ContactAdded,
+    // Every step a contact lasts, only for bodies whose listener opted in.
+    ContactPersisted,
+    ContactRemoved,
+    BodyActivated,
+    BodyDeactivated,
+    // A moving body started or stopped touching a sensor, body1 is the sensor.
+    TriggerEnter,
+    TriggerExit,
+};
+
+// Compact record of a Jolt callback, queued from the physics jobs and handed out on the tick
+// thread after IPhysics::Update. Activation events only use body1.
+struct PhysicsEvent
+{
+    PhysicsEventType type;
+    JPH::BodyID      body1;
+    JPH::BodyID      body2;
+    uint64_t         userData1;
+    uint64_t         userData2;
+
+    // Contact added/persisted only, either body is a sensor.
+    bool sensor;
+
+    // Contact added/persisted only, normal points from body1 to body2.
+    glm::vec3 position;
+    glm::vec3 normal;
+    float     penetration;
+
+    JPH::BodyID GetOther(JPH::BodyID self) const
+    {
+        return self == body1 ? body2 : body1;
+    }
+};
+
+// Body user data is reserved for a pointer to an IPhysicsListener (or 0), events are dispatched
+// to the listeners of both bodies. The listener is looked up from the body at dispatch, so it must
+// outlive its body.
+class IPhysicsListener
+{
+  public:
+    IPhysicsListener()          = default;
+    virtual ~IPhysicsListener() = default;
+
+    IPhysicsListener(const IPhysicsListener&)            = delete;
+    IPhysicsListener(IPhysicsListener&&)                 = delete;
+    IPhysicsListener& operator=(const IPhysicsListener&) = delete;
+    IPhysicsListener& operator=(IPhysicsListener&&)      = delete;
+
+    virtual void OnPhysicsEvent(const PhysicsEvent& event) = 0;
+
+    // Resting contacts report every step, so persisted contacts are only queued when a listener
+    // of either body asks for them.
+    void SetPersistedContacts(bool enabled)
+    {
+        m_persistedContacts.store(enabled, std::memory_order_relaxed);
+    }
+
+    // Read by the physics jobs.
+    bool WantsPersistedContacts() const
+    {
+        return m_persistedContacts.load(std::memory_order_relaxed);
+    }
+
+    uint64_t GetListenerUserData()
+    {
+        return reinterpret_cast<uint64_t>(this);
+    }
+
+    static IPhysicsListener* FromUserData(uint64_t userData)
+    {
+        return reinterpret_cast<IPhysicsListener*>(userData);
+    }
+
+  private:
+    std::atomic<bool> m_persistedContacts = false;
+};
+}; // namespace legs
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+
+namespace legs
+{
+// What happens to a dynamic body when every observer is further than
+// PhysicsLodSettings::farDistance away from it.
+enum class PhysicsLodPolicy
+{
+    // Put the body to sleep and keep it asleep, contacts from awake bodies still wake it up
+    // until the next evaluation.
+    Sleep,
+    // Turn the body kinematic, so nothing can push it around.
+    Kinematic,
+};
+
+// Jolt only steps awake bodies, so keeping far away bodies out of the simulation makes the step
+// cost scale with the bodies near the observers instead of the whole level.
+struct PhysicsLodSettings
+{
+    bool enabled = false;
+    // Bodies closer than nearDistance to an observer are simulated, bodies further than
+    // farDistance are not. The gap between them avoids flip-flopping at the boundary.
+    float            nearDistance = 100.0f;
+    float            farDistance  = 120.0f;
+    PhysicsLodPolicy farPolicy    = PhysicsLodPolicy::Sleep;
+    // Bodies evaluated per update, the rest wait for their turn.
+    uint32_t bodiesPerUpdate = 1024;
+    // Engine uses the camera position as the only observer.
+    bool observeCamera = true;
+};
+
+struct PhysicsLodStats
+{
+    uint32_t numBodies;
+    uint32_t numFarBodies;
+};
+}; // namespace legs
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <glm/gtc/quaternion.hpp>
+#include <glm/vec3.hpp>
+
+#include <legs/jolt_pch.hpp>
+
+#include <legs/collider.hpp>
+
+namespace legs
+{
+// Queries are submitted in batches through IPhysics and run in parallel on the physics job
+// system. Each query uses `layer` as if it was a body on that layer, so the regular object layer
+// filters decide what it can hit. Sensors are only hit with `includeSensors`.
+
+struct RayCastQuery
+{
+    glm::vec3 origin;
+    // Length of the direction is the max distance of the ray.
+    glm::vec3        direction;
+    JPH::ObjectLayer layer = Layers::MOVING;
+    JPH::BodyID      ignoreBody;
+    bool             includeSensors = false;
+};
+
+struct RayCastHit
+{
+    JPH::BodyID body;
+    // Fraction of RayCastQuery::direction, 1 if nothing was hit.
+    float     fraction = 1.0f;
+    glm::vec3 position;
+    glm::vec3 normal;
+
+    bool HasHit() const
+    {
+        return !body.IsInvalid();
+    }
+};
+
+struct ShapeCastQuery
+{
+    JPH::ShapeRefC   shape;
+    glm::vec3        position;
+    glm::quat        rotation = glm::identity<glm::quat>();
+    glm::vec3        direction;
+    JPH::ObjectLayer layer = Layers::MOVING;
+    JPH::BodyID      ignoreBody;
+    bool             includeSensors = false;
+};
+
+struct ShapeCastHit
+{
+    JPH::BodyID body;
+    float       fraction = 1.0f;
+    glm::vec3   position;
+    glm::vec3   normal;
+    float       penetration = 0.0f;
+
+    bool HasHit() const
+    {
+        return !body.IsInvalid();
+    }
+};
+
+struct OverlapQuery
+{
+    JPH::ShapeRefC   shape;
+    glm::vec3        position;
+    glm::quat        rotation = glm::identity<glm::quat>();
+    JPH::ObjectLayer layer    = Layers::MOVING;
+    JPH::BodyID      ignoreBody;
+    bool             includeSensors = false;
+};
+}; // namespace legs
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <legs/jolt_pch.hpp>
+
+namespace legs
+{
+enum class SnapshotMode
+{
+    // Every body, constraint and contact.
+    Full,
+    // Only bodies that are awake (and contacts between them), restoring leaves sleeping and
+    // static bodies as they are.
+    ActiveBodies,
+};
+
+// Reusable state buffer for IPhysics::SaveState and RestoreState.
+// The memory is kept between saves, so after the first few snapshots saving doesn't allocate.
+class PhysicsSnapshot final : public JPH::StateRecorder
+{
+  public:
+    explicit PhysicsSnapshot(size_t reserveBytes = 0);
+
+    void WriteBytes(const void* inData, size_t inNumBytes) override;
+    void ReadBytes(void* outData, size_t inNumBytes) override;
+    bool IsEOF() const override;
+    bool IsFailed() const override;
+
+    // Forget the contents but keep the memory.
+    void Clear();
+    // Read from the start again, e.g. to restore the same snapshot more than once.
+    void Rewind();
+
+    size_t GetSize() const
+    {
+        return m_size;
+    }
+
+    SnapshotMode GetMode() const
+    {
+        return m_mode;
+    }
+
+    void SetMode(SnapshotMode mode)
+    {
+        m_mode = mode;
+    }
+
+  private:
+    std::vector<uint8_t> m_data;
+    size_t               m_size    = 0;
+    size_t               m_readPos = 0;
+    bool                 m_failed  = false;
+    SnapshotMode         m_mode    = SnapshotMode::Full;
+};
+}; // namespace legs
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+
+namespace legs
+{
+// Timings of the latest IPhysics::Update, in seconds.
+struct PhysicsStats
+{
+    double updateTime;
+    // Time the job system workers spent executing jobs during the update, summed over workers.
+    double jobBusyTime;
+    // Job system worker threads, the thread calling Update also runs jobs while it waits.
+    uint32_t numThreads;
+    uint32_t numBodies;
+    uint32_t numActiveBodies;
+};
+}; // namespace legs
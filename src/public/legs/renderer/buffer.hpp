@@ -3,6 +3,7 @@
 #include <cstring>
 #include <memory>
 
+#include <legs/components/bounds.hpp>
 #include <legs/renderer/vma_usage.hpp>
 
 namespace legs
@@ -12,12 +13,18 @@ enum BufferType
     VertexBuffer,
     IndexBuffer,
     UniformBuffer,
+    StorageBuffer,
+    IndirectBuffer,
+    // Copy source of the upload ring.
+    StagingBuffer,
 };
 
 enum BufferLocation
 {
     HostBuffer,
     DeviceBuffer,
+    // Persistently mapped and read by the GPU directly, for data rewritten every frame.
+    MappedBuffer,
 };
 
 class Buffer
@@ -57,17 +64,28 @@ class Buffer
         m_elementCount = length;
     }
 
-    void Write(void* data, size_t size);
+    void Write(const void* data, size_t size);
 
-    void CopyToDevice(void* commandBuffer, std::shared_ptr<Buffer> deviceBuffer);
+    // MappedBuffer only, no copy to a device buffer needed.
+    void WriteMapped(const void* data, size_t offset, size_t size);
+
+    // dstOffset in bytes, for uploading into part of a larger buffer.
+    void CopyToDevice(
+        void*                   commandBuffer,
+        std::shared_ptr<Buffer> deviceBuffer,
+        VkDeviceSize            dstOffset = 0
+    );
 
     void Clear();
 
-    void Bind(void* commandBuffer);
+    void Bind(void* commandBuffer, VkDeviceSize offset = 0);
 
     void Draw(void* commandBuffer);
     void Draw(void* commandBuffer, uint32_t indexOffset, uint32_t indexCount, int32_t vertexOffset);
 
+    // Instances read their transform through gl_InstanceIndex, which starts at firstInstance.
+    void DrawInstanced(void* commandBuffer, uint32_t instanceCount, uint32_t firstInstance);
+
     void Map(void** data);
     void Unmap();
 
@@ -106,6 +124,34 @@ class Buffer
         return m_elementSize;
     }
 
+    // Upload batch writing the buffer, see UploadManager. 0 when it was never uploaded to.
+    void SetUploadValue(uint64_t value)
+    {
+        m_uploadValue = value;
+    }
+
+    uint64_t GetUploadValue() const
+    {
+        return m_uploadValue;
+    }
+
+    // Local space bounds of a vertex buffer, set by Renderer::CreateBuffer.
+    void SetBounds(const SBounds& bounds)
+    {
+        m_bounds    = bounds;
+        m_hasBounds = true;
+    }
+
+    bool HasBounds() const
+    {
+        return m_hasBounds;
+    }
+
+    const SBounds& GetBounds() const
+    {
+        return m_bounds;
+    }
+
   private:
     VkBuffer      m_vkBuffer;
     VmaAllocation m_vmaAllocation;
@@ -115,6 +161,10 @@ class Buffer
     uint32_t       m_elementSize;
     uint32_t       m_elementCount;
     size_t         m_size;
-    bool           m_isMapped = false;
+    bool           m_isMapped    = false;
+    void*          m_mappedData  = nullptr;
+    uint64_t       m_uploadValue = 0;
+    SBounds        m_bounds;
+    bool           m_hasBounds = false;
 };
 } // namespace legs
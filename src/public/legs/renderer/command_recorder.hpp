@@ -0,0 +1,83 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+#include <legs/renderer/device.hpp>
+
+namespace legs
+{
+class JobSystemThreadPool;
+
+// Recording of the current frame.
+struct RecordStats
+{
+    uint32_t jobs; // Jobs recorded on, 0 when everything was recorded on the render thread
+    double   time; // Seconds spent recording, summed over the jobs
+};
+
+// Records draws on the job system.
+//
+// A list of work is split into consecutive ranges, every range is recorded by a job into a
+// secondary command buffer and the buffers are executed in order on the frame's command buffer.
+// Each job slot has a command pool of its own per frame in flight, so jobs never share a pool
+// and recording needs no locks. Render thread only.
+class CommandRecorder
+{
+  public:
+    // Records a range [begin, end) of the work into the command buffer.
+    using RecordFunction = std::function<void(VkCommandBuffer, uint32_t, uint32_t)>;
+
+    CommandRecorder() = delete;
+    CommandRecorder(Device& device, std::shared_ptr<JobSystemThreadPool> jobSystem);
+    ~CommandRecorder();
+
+    CommandRecorder(const CommandRecorder&)            = delete;
+    CommandRecorder(CommandRecorder&&)                 = delete;
+    CommandRecorder& operator=(const CommandRecorder&) = delete;
+    CommandRecorder& operator=(CommandRecorder&&)      = delete;
+
+    // Recycles the current frame's command buffers, the GPU must be done with the frame.
+    void Reset();
+
+    // Must be called while rendering, rendering is suspended and resumed around executing the
+    // recorded buffers. Pipeline, descriptor and vertex binds of the frame's command buffer are
+    // undefined afterwards. The work is split by how long its items took to record before, too
+    // little to be worth splitting is recorded on the calling thread.
+    void Record(uint32_t count, const RecordFunction& record);
+
+    RecordStats GetStats() const
+    {
+        return m_stats;
+    }
+
+  private:
+    struct JobPool
+    {
+        VkCommandPool                pool;
+        std::vector<VkCommandBuffer> commandBuffers;
+        uint32_t                     used = 0;
+    };
+
+    // Begins a secondary command buffer from the job slot's pool that continues rendering.
+    VkCommandBuffer BeginCommandBuffer(uint32_t job);
+
+    // Adds time spent recording count items to the estimate and the stats.
+    void AddRecordTime(double time, uint32_t count);
+
+    Device&                              m_device;
+    std::shared_ptr<JobSystemThreadPool> m_jobSystem;
+    uint32_t                             m_maxJobs;
+
+    std::vector<std::vector<JobPool>> m_pools; // Per frame in flight and job slot
+    std::vector<VkCommandBuffer>      m_recorded;
+    std::vector<double>               m_jobTimes;
+
+    // Seconds to record one item, averaged over the recent calls.
+    double      m_itemTime = 0.0;
+    RecordStats m_stats {};
+};
+}; // namespace legs
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <memory>
+#include <span>
+#include <vector>
+
+#include <glm/vec4.hpp>
+#include <vulkan/vulkan_core.h>
+
+#include <legs/renderer/buffer.hpp>
+#include <legs/renderer/device.hpp>
+
+namespace legs
+{
+// Culled instance of an indirect command, std430 layout of cull_comp.
+struct CullObject
+{
+    glm::vec4 sphere; // Local space center and radius
+    uint32_t  transformSlot;
+    uint32_t  command; // Index into the commands of the dispatch
+    uint32_t  retest;  // Set by the pass, occluded in the early pass
+    uint32_t  padding;
+};
+
+static constexpr uint32_t cInvalidCullObject = UINT32_MAX;
+
+// Indirect command with instanceCount 0, the pass counts up the visible instances. Commands
+// with any are compacted to the start of their group.
+struct CullCommand
+{
+    VkDrawIndexedIndirectCommand draw;
+    uint32_t                     group;         // Index into the draw counts of the dispatch
+    uint32_t                     groupStart;    // First command of the group
+    uint32_t                     instanceTotal; // Instance slots of the command
+    uint32_t                     lateCount;     // 0, counted by the pass
+};
+
+// Compacted commands and their counts, for vkCmdDrawIndexedIndirectCount. The offsets are the
+// first command and count of the dispatch, in bytes, for the early and the late pass.
+struct CullOutput
+{
+    VkBuffer     drawBuffer;
+    VkDeviceSize drawOffset;
+    VkDeviceSize lateDrawOffset;
+    VkBuffer     countBuffer;
+    VkDeviceSize countOffset;
+    VkDeviceSize lateCountOffset;
+};
+
+// Frustum and occlusion culling of indirect draws in compute shaders.
+//
+// The early pass tests every object against the frustum planes of the UBO and the Hi-Z pyramid
+// of the previous frame, appending the visible ones to the front of their command's instance
+// slots and compacting the commands that drew anything. Objects it found occluded are tested
+// again by the late pass against the pyramid rebuilt from the early draws, and the ones visible
+// after all are appended to the back of the slots and drawn with their own commands. Nothing
+// visible is ever skipped even when the camera moves, culled objects cost neither CPU time nor
+// draws.
+//
+// Objects are persistent, every frame in flight has a copy of them on the GPU and only the ones
+// changed since that frame's last dispatch are written to it.
+class CullingPass
+{
+  public:
+    CullingPass() = delete;
+    CullingPass(
+        const Device&                        device,
+        VkShaderModule                       shader,
+        std::vector<std::shared_ptr<Buffer>> uboBuffers,
+        std::vector<std::shared_ptr<Buffer>> transformBuffers,
+        std::vector<std::shared_ptr<Buffer>> instanceBuffers,
+        uint32_t                             maxObjects
+    );
+    ~CullingPass();
+
+    CullingPass(const CullingPass&)            = delete;
+    CullingPass(CullingPass&&)                 = delete;
+    CullingPass& operator=(const CullingPass&) = delete;
+    CullingPass& operator=(CullingPass&&)      = delete;
+
+    // Call at the start of every frame.
+    void Reset();
+
+    // Adds an object to every following dispatch and returns its id. Dispatches fail while there
+    // are more objects than the buffers hold. Removing swaps the last object into the hole, ids
+    // stay valid.
+    uint32_t AddObject(const CullObject& object);
+    void     RemoveObject(uint32_t id);
+
+    uint32_t GetObjectCount() const
+    {
+        return static_cast<uint32_t>(m_objects.size());
+    }
+
+    // Recreates the buffers for more objects and points the descriptors at new transform and
+    // instance buffers. The GPU must be idle.
+    void Resize(
+        const std::vector<std::shared_ptr<Buffer>>& transformBuffers,
+        const std::vector<std::shared_ptr<Buffer>>& instanceBuffers,
+        uint32_t                                    maxObjects
+    );
+
+    // Pyramid sampled by the occlusion tests, all levels in VK_IMAGE_LAYOUT_GENERAL. The GPU
+    // must be idle.
+    void SetHiZ(VkImageView view, VkSampler sampler);
+
+    // Records the early pass over all objects, hizLevels 0 skips the occlusion test. Must be
+    // recorded outside of rendering, ends with barriers for the indirect draws. Returns false
+    // without recording anything when the frame's buffers are full.
+    bool Dispatch(
+        VkCommandBuffer              commandBuffer,
+        std::span<const CullCommand> commands,
+        uint32_t                     groupCount,
+        uint32_t                     hizLevels,
+        CullOutput&                  output
+    );
+
+    // Records the late pass of the last dispatch, after the pyramid was rebuilt from the early
+    // draws. Same requirements as Dispatch.
+    void DispatchLate(VkCommandBuffer commandBuffer, uint32_t hizLevels);
+
+  private:
+    struct PushConstants
+    {
+        uint32_t mode; // 0 cull objects, 1 compact commands, 2 and 3 the same for the late pass
+        uint32_t count;
+        uint32_t objectOffset;
+        uint32_t commandOffset;
+        uint32_t drawOffset;
+        uint32_t countOffset;
+        uint32_t hizLevels;
+    };
+
+    // Culls the objects and compacts the commands of one pass, constants.mode 0 or 2.
+    void Record(
+        VkCommandBuffer commandBuffer,
+        PushConstants   constants,
+        uint32_t        numObjects,
+        uint32_t        numCommands
+    );
+
+    void CreateBuffers();
+    void CreateDescriptors();
+    void WriteDescriptors(
+        const std::vector<std::shared_ptr<Buffer>>& transformBuffers,
+        const std::vector<std::shared_ptr<Buffer>>& instanceBuffers
+    );
+    void CreatePipeline(VkShaderModule shader);
+
+    // Copies the objects changed since the frame's last dispatch to its buffer.
+    void WriteObjects(uint32_t frame);
+
+    // Marks an object for WriteObjects of every frame in flight.
+    void MarkObject(uint32_t index);
+
+    const Device&                        m_device;
+    uint32_t                             m_maxObjects;
+    std::vector<std::shared_ptr<Buffer>> m_uboBuffers;
+
+    // Objects are dense, ids map to them through m_idObjects.
+    std::vector<CullObject>            m_objects;
+    std::vector<uint32_t>              m_objectIds;
+    std::vector<uint32_t>              m_idObjects;
+    std::vector<uint32_t>              m_freeIds;
+    std::vector<std::vector<uint32_t>> m_dirtyObjects; // Per frame in flight
+    std::vector<bool>                  m_writeAll;     // Per frame in flight, after a resize
+
+    VkDescriptorPool             m_vkDescriptorPool;
+    VkDescriptorSetLayout        m_vkSetLayout;
+    std::vector<VkDescriptorSet> m_vkSets;
+    VkPipelineLayout             m_vkPipelineLayout;
+    VkPipeline                   m_vkPipeline;
+
+    // One of each per frame in flight. Draws and counts hold the early and the late pass.
+    std::vector<std::shared_ptr<Buffer>> m_objectBuffers;
+    std::vector<std::shared_ptr<Buffer>> m_commandBuffers;
+    std::vector<std::shared_ptr<Buffer>> m_drawBuffers;
+    std::vector<std::shared_ptr<Buffer>> m_countBuffers;
+
+    uint32_t m_commandOffset = 0;
+    uint32_t m_groupOffset   = 0;
+
+    // Early pass of the last dispatch, for DispatchLate.
+    PushConstants m_lastDispatch {};
+    uint32_t      m_lastObjects  = 0;
+    uint32_t      m_lastCommands = 0;
+    uint32_t      m_lastGroups   = 0;
+};
+}; // namespace legs
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace legs
+{
+// Resources the GPU may still be using, released per frame in flight.
+//
+// Everything queued while recording a frame is released the next time that frame's slot comes
+// around, once its in flight fence was waited for. Shared resources like buffers and meshes are
+// kept alive by holding a reference, raw Vulkan handles like pipelines and images are destroyed
+// by a callback. Render thread only.
+class DeletionQueue
+{
+  public:
+    DeletionQueue() = delete;
+    DeletionQueue(uint32_t maxFramesInFlight);
+    ~DeletionQueue();
+
+    DeletionQueue(const DeletionQueue&)            = delete;
+    DeletionQueue(DeletionQueue&&)                 = delete;
+    DeletionQueue& operator=(const DeletionQueue&) = delete;
+    DeletionQueue& operator=(DeletionQueue&&)      = delete;
+
+    void Hold(uint32_t frame, std::shared_ptr<void> resource);
+    void Defer(uint32_t frame, std::function<void()> destroy);
+
+    // The frame's fence must have been waited for.
+    void Release(uint32_t frame);
+
+    // The GPU must be idle.
+    void ReleaseAll();
+
+  private:
+    struct Frame
+    {
+        std::vector<std::shared_ptr<void>>  resources;
+        std::vector<std::function<void()>> callbacks;
+    };
+
+    std::vector<Frame> m_frames;
+};
+}; // namespace legs
@@ -13,7 +13,12 @@ class DescriptorSet
 {
   public:
     DescriptorSet() = delete;
-    DescriptorSet(const Device& device, std::vector<std::shared_ptr<Buffer>> uboBuffers);
+    DescriptorSet(
+        const Device&                        device,
+        std::vector<std::shared_ptr<Buffer>> uboBuffers,
+        std::vector<std::shared_ptr<Buffer>> transformBuffers,
+        std::vector<std::shared_ptr<Buffer>> instanceBuffers
+    );
     ~DescriptorSet();
 
     DescriptorSet(const DescriptorSet&)            = delete;
@@ -23,6 +28,13 @@ class DescriptorSet
 
     void UpdateUBO(uint32_t frameIndex, const std::shared_ptr<UniformBufferObject> ubo);
 
+    // Points the sets at new transform and instance buffers, one per frame in flight. The GPU
+    // must be idle.
+    void SetStorageBuffers(
+        std::vector<std::shared_ptr<Buffer>> transformBuffers,
+        std::vector<std::shared_ptr<Buffer>> instanceBuffers
+    );
+
     void Bind(
         VkCommandBuffer     commandBuffer,
         VkPipelineBindPoint bindPoint,
@@ -36,10 +48,14 @@ class DescriptorSet
     }
 
   private:
+    void WriteStorageBuffers(uint32_t frameIndex);
+
     const Device&                        m_device;
     std::vector<VkDescriptorSetLayout>   m_vkLayouts;
     std::vector<VkDescriptorSet>         m_vkSets;
     std::vector<std::shared_ptr<Buffer>> m_uniformBuffers;
+    std::vector<std::shared_ptr<Buffer>> m_transformBuffers;
+    std::vector<std::shared_ptr<Buffer>> m_instanceBuffers;
     std::vector<void*>                   m_ubosMappedMemory;
 };
 } // namespace legs
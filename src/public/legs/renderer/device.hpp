@@ -1,9 +1,11 @@
 #pragma once
 
+#include <memory>
 #include <optional>
 
 #include <legs/components/rect.hpp>
 #include <legs/renderer/instance.hpp>
+#include <legs/renderer/queue_timeline.hpp>
 #include <legs/renderer/vma_usage.hpp>
 
 namespace legs
@@ -12,6 +14,7 @@ struct QueueFamilyIndices
 {
     std::optional<uint32_t> graphicsFamily;
     std::optional<uint32_t> presentFamily;
+    std::optional<uint32_t> transferFamily; // Transfer only, uploads use graphics without one
 
     bool IsComplete() const
     {
@@ -38,11 +41,34 @@ class Device
     Device& operator=(Device&&)      = delete;
 
     void Begin();
+
+    // Suspends and resumes the frame's rendering, the render pass instance continues without
+    // storing or loading the attachments. Nothing may be recorded in between. Resuming with
+    // VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT allows executing secondary command
+    // buffers, but nothing else, until the next suspend.
+    void SuspendRendering();
+    void ResumeRendering(VkRenderingFlags flags = 0);
+
+    // Ends and restarts the frame's rendering without clearing, for commands that aren't
+    // allowed while rendering, like compute dispatches and barriers. Restarting waits for the
+    // attachment writes before it, the attachments are loaded again.
+    void EndRendering();
+    void RestartRendering();
+
     void ResetViewport();
     void SetViewport(SRect rect);
+
+    // Sets the current viewport and scissor on another command buffer, secondary command
+    // buffers don't inherit them.
+    void ApplyViewport(VkCommandBuffer commandBuffer) const;
     void Submit();
     void Present();
-    void WaitForGraphicsIdle();
+
+    // Waits for everything submitted to the graphics and transfer timelines so far.
+    void WaitForIdle();
+
+    // Makes the next Submit wait for a timeline semaphore value before the given stages.
+    void AddSubmitWait(VkSemaphore semaphore, uint64_t value, VkPipelineStageFlags stages);
 
     VkCommandBuffer GetTemporaryCommandBuffer();
     void            SubmitTemporaryCommandBuffer(VkCommandBuffer commandBuffer);
@@ -57,6 +83,11 @@ class Device
         return m_currentFrame;
     }
 
+    uint32_t GetMaxFramesInFlight() const
+    {
+        return m_maxFramesInFlight;
+    }
+
     void ResizeFramebuffer()
     {
         m_frameBufferResized = true;
@@ -93,6 +124,22 @@ class Device
         return VK_FORMAT_D32_SFLOAT;
     }
 
+    VkImage GetDepthImage() const
+    {
+        return m_vkDepthImage;
+    }
+
+    VkImageView GetDepthImageView() const
+    {
+        return m_vkDepthImageView;
+    }
+
+    // Changes whenever the swapchain and depth attachment are recreated.
+    uint32_t GetSwapchainVersion() const
+    {
+        return m_swapchainVersion;
+    }
+
     VkDescriptorPool GetUboDescriptorPool() const
     {
         return m_vkUboDescriptorPool;
@@ -113,7 +160,31 @@ class Device
         return m_vkGraphicsQueue;
     }
 
+    // The graphics queue when there is no dedicated transfer family.
+    uint32_t GetTransferQueueIndex() const
+    {
+        return m_vkTransferQueueIndex;
+    }
+
+    VkQueue GetTransferQueue() const
+    {
+        return m_vkTransferQueue;
+    }
+
+    QueueTimeline& GetGraphicsTimeline() const
+    {
+        return *m_graphicsTimeline;
+    }
+
+    // The graphics timeline when there is no dedicated transfer queue.
+    QueueTimeline& GetTransferTimeline() const
+    {
+        return m_transferTimeline != nullptr ? *m_transferTimeline : *m_graphicsTimeline;
+    }
+
   private:
+    void BeginRendering(VkAttachmentLoadOp loadOp, VkRenderingFlags flags = 0);
+
     void RecreateSwapchain();
     void DestroySwapchain();
 
@@ -155,6 +226,7 @@ class Device
     void CreateCommandBuffers();
 
     void CreateSyncObjects();
+    void CreateTimelines();
 
     void CreateDescriptorPools();
 
@@ -165,9 +237,14 @@ class Device
 
     uint32_t m_vkGraphicsQueueIndex;
     uint32_t m_vkPresentQueueIndex;
+    uint32_t m_vkTransferQueueIndex;
 
     VkQueue m_vkGraphicsQueue;
     VkQueue m_vkPresentQueue;
+    VkQueue m_vkTransferQueue;
+
+    std::unique_ptr<QueueTimeline> m_graphicsTimeline;
+    std::unique_ptr<QueueTimeline> m_transferTimeline; // Null without a dedicated transfer queue
 
     VkSwapchainKHR           m_vkSwapchain;
     std::vector<VkImage>     m_vkSwapchainImages;
@@ -182,18 +259,31 @@ class Device
     VkCommandPool                m_vkCommandPool;
     std::vector<VkCommandBuffer> m_vkCommandBuffers;
 
+    // Binary, presentation doesn't support timeline semaphores.
     std::vector<VkSemaphore> m_vkImageSemaphores;
     std::vector<VkSemaphore> m_vkRenderSemaphores;
-    std::vector<VkFence>     m_vkInFlightFences;
+
+    // Graphics timeline value of the last submit of every frame in flight.
+    std::vector<uint64_t> m_frameValues;
+
+    // Timeline semaphores the next Submit waits for.
+    std::vector<SemaphoreWait> m_submitWaits;
 
     VkDescriptorPool m_vkUboDescriptorPool;
     VkDescriptorPool m_vkImGuiDescriptorPool;
 
+    VkViewport m_viewport {};
+    VkRect2D   m_scissor {};
+
+    // Of the current render pass instance, resuming it needs the same.
+    VkAttachmentLoadOp m_renderingLoadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+
     uint32_t       m_currentImageIndex;
     uint32_t       m_currentFrame = 0;
     const uint32_t m_maxFramesInFlight;
 
-    bool m_frameBufferResized = false;
+    bool     m_frameBufferResized = false;
+    uint32_t m_swapchainVersion   = 0;
 
     const std::vector<const char*> m_requiredExtensions = {
         VK_KHR_SWAPCHAIN_EXTENSION_NAME,
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#include <legs/components/bounds.hpp>
+#include <legs/renderer/buffer.hpp>
+#include <legs/renderer/mesh_data.hpp>
+#include <legs/renderer/upload_manager.hpp>
+#include <legs/renderer/vma_usage.hpp>
+
+namespace legs
+{
+class GeometryArena;
+
+// Vertices and indices sub-allocated from a GeometryArena, the ranges are freed with the mesh.
+class Mesh
+{
+  public:
+    Mesh() = delete;
+    Mesh(
+        std::shared_ptr<GeometryArena> arena,
+        VmaVirtualAllocation           vertexAllocation,
+        VmaVirtualAllocation           indexAllocation,
+        uint32_t                       vertexOffset,
+        uint32_t                       firstIndex,
+        uint32_t                       indexCount
+    );
+    ~Mesh();
+
+    Mesh(const Mesh&)            = delete;
+    Mesh(Mesh&&)                 = delete;
+    Mesh& operator=(const Mesh&) = delete;
+    Mesh& operator=(Mesh&&)      = delete;
+
+    const std::shared_ptr<GeometryArena>& GetArena() const
+    {
+        return m_arena;
+    }
+
+    // In vertices, added to every index.
+    uint32_t GetVertexOffset() const
+    {
+        return m_vertexOffset;
+    }
+
+    uint32_t GetFirstIndex() const
+    {
+        return m_firstIndex;
+    }
+
+    uint32_t GetIndexCount() const
+    {
+        return m_indexCount;
+    }
+
+    // Local space, set once before the mesh is handed out.
+    const SBounds& GetBounds() const
+    {
+        return m_bounds;
+    }
+
+    void SetBounds(const SBounds& bounds)
+    {
+        m_bounds = bounds;
+    }
+
+    // Upload of the vertices and indices, also set before the mesh is handed out. The mesh isn't
+    // drawn before the upload was flushed.
+    const UploadTicket& GetUpload() const
+    {
+        return m_upload;
+    }
+
+    void SetUpload(UploadTicket upload)
+    {
+        m_upload = std::move(upload);
+    }
+
+  private:
+    std::shared_ptr<GeometryArena> m_arena;
+    VmaVirtualAllocation           m_vertexAllocation;
+    VmaVirtualAllocation           m_indexAllocation;
+    uint32_t                       m_vertexOffset;
+    uint32_t                       m_firstIndex;
+    uint32_t                       m_indexCount;
+    SBounds                        m_bounds;
+    UploadTicket                   m_upload;
+};
+
+// One large vertex and index buffer shared by meshes of a vertex size, a full arena is followed by
+// another one.
+//
+// Ranges are handed out by VMA virtual blocks counted in elements, so a mesh is just an offset
+// and every mesh of the arena draws with the same buffer binds. Allocation is thread safe.
+class GeometryArena : public std::enable_shared_from_this<GeometryArena>
+{
+  public:
+    GeometryArena() = delete;
+    GeometryArena(uint32_t vertexSize, uint32_t maxVertices, uint32_t maxIndices);
+    ~GeometryArena();
+
+    GeometryArena(const GeometryArena&)            = delete;
+    GeometryArena(GeometryArena&&)                 = delete;
+    GeometryArena& operator=(const GeometryArena&) = delete;
+    GeometryArena& operator=(GeometryArena&&)      = delete;
+
+    // The ranges are uninitialized, nullptr when the arena is full.
+    std::shared_ptr<Mesh> Allocate(uint32_t vertexCount, uint32_t indexCount);
+    void                  Free(VmaVirtualAllocation vertices, VmaVirtualAllocation indices);
+
+    const std::shared_ptr<Buffer>& GetVertexBuffer() const
+    {
+        return m_vertexBuffer;
+    }
+
+    const std::shared_ptr<Buffer>& GetIndexBuffer() const
+    {
+        return m_indexBuffer;
+    }
+
+    uint32_t GetVertexSize() const
+    {
+        return m_vertexSize;
+    }
+
+  private:
+    uint32_t m_vertexSize;
+
+    std::shared_ptr<Buffer> m_vertexBuffer;
+    std::shared_ptr<Buffer> m_indexBuffer;
+
+    std::mutex      m_mutex;
+    VmaVirtualBlock m_vertexBlock;
+    VmaVirtualBlock m_indexBlock;
+};
+}; // namespace legs
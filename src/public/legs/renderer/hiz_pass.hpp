@@ -0,0 +1,81 @@
+#pragma once
+
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+#include <legs/renderer/device.hpp>
+#include <legs/renderer/vma_usage.hpp>
+
+namespace legs
+{
+// Hierarchical depth pyramid of the depth attachment for occlusion culling.
+//
+// Every level stores the farthest depth of the texels below it, at half the size of the one
+// above. Level 0 is half the size of the depth attachment. A texel always covers its share of the
+// level above, rounded outwards, so lookups by uv are conservative for any size.
+class HiZPass
+{
+  public:
+    HiZPass() = delete;
+    HiZPass(Device& device, VkShaderModule shader);
+    ~HiZPass();
+
+    HiZPass(const HiZPass&)            = delete;
+    HiZPass(HiZPass&&)                 = delete;
+    HiZPass& operator=(const HiZPass&) = delete;
+    HiZPass& operator=(HiZPass&&)      = delete;
+
+    // Recreates the pyramid for the current depth attachment, the GPU must be idle.
+    void Resize();
+
+    // Downsamples the depth attachment, once per frame after the early culled draws. Must be
+    // recorded outside of rendering, the attachment is back in its attachment layout afterwards
+    // and the pyramid is readable by compute shaders.
+    void Build(VkCommandBuffer commandBuffer);
+
+    // All levels in VK_IMAGE_LAYOUT_GENERAL.
+    VkImageView GetView() const
+    {
+        return m_vkView;
+    }
+
+    VkSampler GetSampler() const
+    {
+        return m_vkSampler;
+    }
+
+    uint32_t GetLevels() const
+    {
+        return static_cast<uint32_t>(m_levelSizes.size());
+    }
+
+  private:
+    struct PushConstants
+    {
+        int32_t sourceWidth;
+        int32_t sourceHeight;
+        int32_t destinationWidth;
+        int32_t destinationHeight;
+    };
+
+    void CreatePyramid();
+    void DestroyPyramid();
+
+    Device& m_device;
+
+    VkSampler             m_vkSampler;
+    VkDescriptorSetLayout m_vkSetLayout;
+    VkPipelineLayout      m_vkPipelineLayout;
+    VkPipeline            m_vkPipeline;
+
+    // Recreated with the depth attachment.
+    VkImage                      m_vkImage = VK_NULL_HANDLE;
+    VmaAllocation                m_vmaAllocation;
+    VkImageView                  m_vkView;
+    std::vector<VkImageView>     m_vkLevelViews;
+    std::vector<VkExtent2D>      m_levelSizes;
+    VkDescriptorPool             m_vkDescriptorPool;
+    std::vector<VkDescriptorSet> m_vkSets; // One per level
+};
+}; // namespace legs
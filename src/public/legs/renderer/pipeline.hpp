@@ -20,7 +20,8 @@ class Pipeline
         std::shared_ptr<DescriptorSet>               descriptorSet,
         std::vector<VkPipelineShaderStageCreateInfo> shaderStages,
         bool                                         enableCulling = true,
-        bool                                         enableDepth   = true
+        bool                                         enableDepth   = true,
+        bool                                         drawLines     = false
     );
     ~Pipeline();
 
@@ -50,7 +51,8 @@ Pipeline<V>::Pipeline(
     std::shared_ptr<DescriptorSet>               descriptorSet,
     std::vector<VkPipelineShaderStageCreateInfo> shaderStages,
     bool                                         enableCulling,
-    bool                                         enableDepth
+    bool                                         enableDepth,
+    bool                                         drawLines
 ) :
     m_device(device),
     m_descriptorSet(descriptorSet)
@@ -82,7 +84,8 @@ Pipeline<V>::Pipeline(
 
     VkPipelineInputAssemblyStateCreateInfo inputAssemblyState {};
     inputAssemblyState.sType    = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    inputAssemblyState.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    inputAssemblyState.topology =
+        drawLines ? VK_PRIMITIVE_TOPOLOGY_LINE_LIST : VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
     inputAssemblyState.primitiveRestartEnable = VK_FALSE;
 
     VkViewport viewport {};
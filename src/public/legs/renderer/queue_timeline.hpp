@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <span>
+
+#include <vulkan/vulkan_core.h>
+
+namespace legs
+{
+// Wait on a timeline value, binary semaphores ignore the value.
+struct SemaphoreWait
+{
+    VkSemaphore          semaphore;
+    uint64_t             value;
+    VkPipelineStageFlags stages;
+};
+
+// Timeline semaphore of a queue.
+//
+// Every submission through the timeline signals the next value, so work on the queue is tracked
+// by the value its submission signalled. The CPU and other queues wait for exactly the values
+// they depend on instead of fences or idling the queue. Submitting and presenting are thread safe.
+class QueueTimeline
+{
+  public:
+    QueueTimeline() = delete;
+    QueueTimeline(VkDevice device, VkQueue queue);
+    ~QueueTimeline();
+
+    QueueTimeline(const QueueTimeline&)            = delete;
+    QueueTimeline(QueueTimeline&&)                 = delete;
+    QueueTimeline& operator=(const QueueTimeline&) = delete;
+    QueueTimeline& operator=(QueueTimeline&&)      = delete;
+
+    // Returns the value signalled once the command buffers finished. The binary semaphore, if
+    // any, is signalled as well for presentation.
+    uint64_t Submit(
+        std::span<const VkCommandBuffer> commandBuffers,
+        std::span<const SemaphoreWait>   waits  = {},
+        VkSemaphore                      signal = VK_NULL_HANDLE
+    );
+
+    // Presents on the timeline's queue, serialized with Submit as both use the VkQueue.
+    VkResult Present(const VkPresentInfoKHR& presentInfo);
+
+    // Blocks until the value was signalled.
+    void Wait(uint64_t value) const;
+
+    bool IsComplete(uint64_t value) const;
+
+    uint64_t GetCompletedValue() const;
+
+    // Signalled once everything submitted so far finished.
+    uint64_t GetSubmittedValue() const
+    {
+        return m_submittedValue.load(std::memory_order_acquire);
+    }
+
+    VkSemaphore GetVkSemaphore() const
+    {
+        return m_vkSemaphore;
+    }
+
+    VkQueue GetVkQueue() const
+    {
+        return m_vkQueue;
+    }
+
+  private:
+    VkDevice    m_vkDevice;
+    VkQueue     m_vkQueue;
+    VkSemaphore m_vkSemaphore;
+
+    // Values are signalled in submission order, so reserving one and submitting can't be split.
+    // Also external synchronization of the VkQueue, which presenting needs as well.
+    std::mutex            m_submitMutex;
+    std::atomic<uint64_t> m_submittedValue {0};
+
+    // Last value seen completed, saves querying the semaphore for older values.
+    mutable std::atomic<uint64_t> m_completedValue {0};
+};
+}; // namespace legs
@@ -1,18 +1,29 @@
 #pragma once
 
+#include <functional>
+#include <map>
 #include <memory>
+#include <span>
 #include <stdexcept>
+#include <utility>
 
 #include <imgui_impl_vulkan.h>
 
 #include <legs/entity/camera.hpp>
 #include <legs/renderer/buffer.hpp>
+#include <legs/renderer/command_recorder.hpp>
 #include <legs/renderer/common.hpp>
+#include <legs/renderer/culling_pass.hpp>
+#include <legs/renderer/deletion_queue.hpp>
 #include <legs/renderer/descriptor_set.hpp>
 #include <legs/renderer/device.hpp>
+#include <legs/renderer/geometry_arena.hpp>
+#include <legs/renderer/hiz_pass.hpp>
 #include <legs/renderer/instance.hpp>
 #include <legs/renderer/pipeline.hpp>
 #include <legs/renderer/ubo.hpp>
+#include <legs/renderer/upload_manager.hpp>
+#include <legs/world/transform_hierarchy.hpp>
 
 namespace legs
 {
@@ -23,12 +34,26 @@ enum RenderPipeline
     GEO_P_N_C,
     FULLSCREEN,
     SKY,
+    DEBUG_LINE_P_C,
+    DEBUG_TRIANGLE_P_C,
+};
+
+// Persistent draw of Renderer::AddCulledDraw.
+using DrawId = uint32_t;
+
+// Draw counts and recording of the current frame.
+struct RenderStats
+{
+    uint32_t    meshDraws;    // Meshes drawn
+    uint32_t    drawCalls;    // Draw calls issued for them
+    uint32_t    meshesCulled; // Meshes skipped by CPU frustum culling
+    RecordStats record;       // Recording of the queued draws
 };
 
 class Renderer
 {
   public:
-    Renderer(std::shared_ptr<Window> window);
+    Renderer(std::shared_ptr<Window> window, uint32_t framesInFlight);
     ~Renderer();
 
     Renderer(const Renderer&)            = delete;
@@ -38,6 +63,9 @@ class Renderer
 
     void SetWindow(std::shared_ptr<Window> window);
 
+    // Draws are recorded on the job system's workers once set, on the render thread before.
+    void SetJobSystem(std::shared_ptr<JobSystemThreadPool> jobSystem);
+
     void ResetViewport()
     {
         m_device.ResetViewport();
@@ -57,6 +85,19 @@ class Renderer
     void  UpdateUBO();
     void  WaitForIdle();
 
+    // Keeps a resource alive until the GPU finished the frame being recorded.
+    void ReleaseAfterFrame(std::shared_ptr<void> resource)
+    {
+        m_deletionQueue.Hold(m_device.GetCurrentFrame(), std::move(resource));
+    }
+
+    // Destroys Vulkan handles, like pipelines and images, once the GPU finished the frame being
+    // recorded.
+    void DestroyAfterFrame(std::function<void()> destroy)
+    {
+        m_deletionQueue.Defer(m_device.GetCurrentFrame(), std::move(destroy));
+    }
+
     std::shared_ptr<UniformBufferObject> GetUBO()
     {
         return m_ubo;
@@ -69,6 +110,11 @@ class Renderer
 
     void GetImGuiInfo(ImGuiCreationInfo& info);
 
+    VkDevice GetVkDevice() const
+    {
+        return m_device.GetVkDevice();
+    }
+
     VkCommandBuffer GetVkCommandBuffer() const
     {
         return m_device.GetCommandBuffer();
@@ -84,68 +130,148 @@ class Renderer
         m_device.SubmitTemporaryCommandBuffer(buffer);
     }
 
-    void CreateBuffer(
+    // Frames and temporary command buffers signal the next value when they finished, see
+    // Engine::WaitForTimeline.
+    const QueueTimeline& GetGraphicsTimeline() const
+    {
+        return m_device.GetGraphicsTimeline();
+    }
+
+    // Creates a device buffer filled with data. The upload is batched with the others of the
+    // frame, the buffer isn't drawn before it was flushed.
+    std::shared_future<void> CreateBuffer(
         std::shared_ptr<Buffer>& buffer,
         BufferType               bufferType,
-        void*                    data,
+        const void*              data,
         uint32_t                 elementSize,
         uint32_t                 elementCount
-    )
+    );
+
+    // Uploads a mesh into the shared geometry arena of its vertex size. Meshes of an arena are
+    // drawn with indirect multi-draws instead of one draw each. Completion of the upload is
+    // Mesh::GetUpload.
+    std::shared_ptr<Mesh> CreateMesh(
+        const void*            vertices,
+        uint32_t               vertexSize,
+        uint32_t               vertexCount,
+        std::span<const Index> indices
+    );
+
+    template<class V>
+    std::shared_ptr<Mesh> CreateMesh(const std::vector<V>& vertices, std::span<const Index> indices)
+    {
+        const auto count = static_cast<uint32_t>(vertices.size());
+        return CreateMesh(vertices.data(), sizeof(V), count, indices);
+    }
+
+    // Model matrices of the frame indexed by TransformId, copied once to a mapped storage buffer.
+    // Call before drawing.
+    void SetTransforms(std::span<const glm::mat4x4> matrices);
+
+    // Draws immediately with the model matrix of transform, identity for cInvalidTransformId.
+    void DrawWithBuffers(
+        std::shared_ptr<Buffer> vertexBuffer,
+        std::shared_ptr<Buffer> indexBuffer,
+        TransformId             transform = cInvalidTransformId
+    );
+
+    // Queues a mesh for FlushDraws, which draws all queued meshes sharing a pipeline and buffers
+    // as one instanced draw.
+    void QueueDraw(
+        RenderPipeline          pipe,
+        std::shared_ptr<Buffer> vertexBuffer,
+        std::shared_ptr<Buffer> indexBuffer,
+        TransformId             transform
+    );
+    void QueueDraw(RenderPipeline pipe, std::shared_ptr<Mesh> mesh, TransformId transform);
+
+    // Draws the queue, and the culled draws on the first call of the frame.
+    void FlushDraws();
+
+    // Draws an arena mesh every frame until removed. Culled draws are frustum and occlusion
+    // culled by compute passes, they stay on the GPU and only adding and removing them costs CPU
+    // time. Render thread only.
+    DrawId AddCulledDraw(RenderPipeline pipe, std::shared_ptr<Mesh> mesh, TransformId transform);
+    void   RemoveCulledDraw(DrawId id);
+
+    // The world draws arena mesh entities as culled draws while enabled, instead of queueing
+    // them every frame.
+    void SetGpuCulling(bool enabled)
+    {
+        m_gpuCulling = enabled;
+    }
+
+    bool GetGpuCulling() const
     {
-        auto hostBuffer =
-            std::make_shared<Buffer>(bufferType, HostBuffer, elementSize, elementCount);
-        auto deviceBuffer =
-            std::make_shared<Buffer>(bufferType, DeviceBuffer, elementSize, elementCount);
-        hostBuffer->Write(data, elementSize * elementCount);
-        auto tempBuffer = GetTemporaryCommandBuffer();
-        hostBuffer->CopyToDevice(tempBuffer, static_pointer_cast<Buffer>(deviceBuffer));
-        SubmitTemporaryCommandBuffer(tempBuffer);
-        buffer = static_pointer_cast<Buffer>(deviceBuffer);
+        return m_gpuCulling;
     }
 
-    void DrawWithBuffers(std::shared_ptr<Buffer> vertexBuffer, std::shared_ptr<Buffer> indexBuffer)
+    RenderStats GetStats() const
     {
-        auto commandBuffer = GetCommandBuffer();
-        if (commandBuffer != nullptr)
+        auto stats = m_stats;
+        if (m_recorder != nullptr)
         {
-            vertexBuffer->Bind(commandBuffer);
-            indexBuffer->Bind(commandBuffer);
-            indexBuffer->Draw(commandBuffer);
-            m_frameBuffers.push_back(vertexBuffer);
-            m_frameBuffers.push_back(indexBuffer);
+            stats.record = m_recorder->GetStats();
         }
+        return stats;
     }
 
+    void AddCulledMeshes(uint32_t count)
+    {
+        m_stats.meshesCulled += count;
+    }
+
+    // Draws world space vertices through one of the DEBUG pipelines. The vertices are copied to
+    // a persistently mapped ring buffer of the current frame, so calling this every frame doesn't
+    // allocate or upload through a staging buffer.
+    void DrawDebug(RenderPipeline pipe, std::span<const Vertex_P_C> vertices);
+
+    // Sizes the debug ring, vertices past count are dropped each frame. The buffers are only
+    // allocated while count is non zero, the old ones are released once the GPU is done with them.
+    void SetMaxDebugVertices(uint32_t count);
+
     void BindPipeline(RenderPipeline pipe)
     {
-        auto commandBuffer = m_device.GetCommandBuffer();
-        auto currentFrame  = m_device.GetCurrentFrame();
+        BindPipeline(pipe, m_device.GetCommandBuffer());
+    }
 
+    void BindPipeline(RenderPipeline pipe, VkCommandBuffer commandBuffer)
+    {
         switch (pipe)
         {
             case GEO_P_C:
             {
-                m_testPipeline->Bind(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, currentFrame);
+                BindPipeline(m_testPipeline, commandBuffer);
                 break;
             }
 
             case GEO_P_N_C:
             {
-                m_geoPNCPipeline
-                    ->Bind(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, currentFrame);
+                BindPipeline(m_geoPNCPipeline, commandBuffer);
                 break;
             }
 
             case FULLSCREEN:
             {
-                m_fullscreenPipeline
-                    ->Bind(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, currentFrame);
+                BindPipeline(m_fullscreenPipeline, commandBuffer);
                 break;
             }
 
             case SKY:
             {
-                m_skyPipeline->Bind(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, currentFrame);
+                BindPipeline(m_skyPipeline, commandBuffer);
+                break;
+            }
+
+            case DEBUG_LINE_P_C:
+            {
+                BindPipeline(m_debugLinePipeline, commandBuffer);
+                break;
+            }
+
+            case DEBUG_TRIANGLE_P_C:
+            {
+                BindPipeline(m_debugTrianglePipeline, commandBuffer);
                 break;
             }
 
@@ -157,14 +283,102 @@ class Renderer
     }
 
   private:
+    struct QueuedDraw
+    {
+        RenderPipeline          pipeline;
+        std::shared_ptr<Buffer> vertexBuffer;
+        std::shared_ptr<Buffer> indexBuffer;
+        std::shared_ptr<Mesh>   mesh; // Arena meshes only
+        uint32_t                transformSlot;
+    };
+
+    // Queued draws [begin, end) sharing binds, arena groups own the indirect commands
+    // [firstCommand, lastCommand).
+    struct DrawGroup
+    {
+        uint32_t begin;
+        uint32_t end;
+        uint32_t firstCommand;
+        uint32_t lastCommand;
+    };
+
+    // Culled draws of a mesh with a pipeline, drawn by the batch's command. Free while the mesh
+    // is null.
+    struct CulledBatch
+    {
+        RenderPipeline        pipeline;
+        std::shared_ptr<Mesh> mesh;
+        uint32_t              count;
+    };
+
+    // Batches sharing binds, drawn from the compacted commands
+    // [firstCommand, firstCommand + numCommands).
+    struct CulledGroup
+    {
+        RenderPipeline          pipeline;
+        std::shared_ptr<Buffer> vertexBuffer;
+        std::shared_ptr<Buffer> indexBuffer;
+        uint32_t                firstCommand;
+        uint32_t                numCommands;
+    };
+
+    template<class V>
+    void BindPipeline(const std::shared_ptr<Pipeline<V>>& pipeline, VkCommandBuffer commandBuffer)
+    {
+        pipeline->Bind(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_device.GetCurrentFrame());
+    }
+
+    // Buffers created by CreateBuffer are drawable once their upload was flushed.
+    bool IsUploaded(const Buffer& buffer) const
+    {
+        return m_uploads->IsFlushed(buffer.GetUploadValue());
+    }
+
+    uint32_t GetTransformSlot(TransformId transform) const
+    {
+        return transform < m_numTransforms ? transform + 1 : 0;
+    }
+
+    // Reserves count instance slots in the current frame, returns the first or 0 when full. The
+    // buffers then grow at the start of the next frame.
+    uint32_t AllocateInstances(uint32_t count);
+
+    // (Re)creates the transform, instance and indirect buffers at the current capacities.
+    void CreateDrawBuffers();
+    void GrowDrawBuffers();
+
+    // Sorts, groups and draws m_drawQueue.
+    void DrawQueue();
+
+    // Draws m_drawGroups.
+    void DrawGroups(uint32_t firstInstance);
+
+    // Records the draw groups [begin, end), called from recording jobs.
+    void RecordGroups(
+        VkCommandBuffer commandBuffer,
+        uint32_t        begin,
+        uint32_t        end,
+        uint32_t        firstInstance
+    );
+
+    // Culls and draws the culled draws, once per frame.
+    void DrawCulled();
+
+    // Draws m_culledGroups from the commands compacted by the early or the late pass.
+    void RecordCulledGroups(VkCommandBuffer commandBuffer, const CullOutput& culled, bool late);
+
+    // Frees a batch without culled draws.
+    void ReleaseBatch(uint32_t batch);
+
     VkShaderModule& CreateShaderModule(VkShaderModuleCreateInfo createInfo);
     constexpr VkPipelineShaderStageCreateInfo FillShaderStageCreateInfo(
         VkShaderModule&       module,
         VkShaderStageFlagBits stage
     );
 
-    Instance m_instance;
-    Device   m_device;
+    Instance      m_instance;
+    Device        m_device;
+    DeletionQueue m_deletionQueue;
 
     std::shared_ptr<DescriptorSet> m_descriptorSet;
     std::vector<VkShaderModule>    m_vkShaderModules;
@@ -173,11 +387,70 @@ class Renderer
     std::shared_ptr<Pipeline<Vertex_P_N_C>> m_geoPNCPipeline;
     std::shared_ptr<Pipeline<VertexEmpty>>  m_fullscreenPipeline;
     std::shared_ptr<Pipeline<Vertex_P>>     m_skyPipeline;
+    std::shared_ptr<Pipeline<Vertex_P_C>>   m_debugLinePipeline;
+    std::shared_ptr<Pipeline<Vertex_P_C>>   m_debugTrianglePipeline;
 
-    std::shared_ptr<UniformBufferObject> m_ubo;
+    // Debug vertex ring, one mapped buffer per frame in flight.
+    std::vector<std::shared_ptr<Buffer>> m_debugVertexBuffers;
+    uint32_t                             m_maxDebugVertices  = 0;
+    uint32_t                             m_debugVertexOffset = 0;
+    bool                                 m_debugOverflowed   = false;
 
-    // Hold so we don't call Buffer destructor
-    // while still in use by command buffer.
-    std::vector<std::shared_ptr<Buffer>> m_frameBuffers;
+    // Model matrices, one mapped buffer per frame in flight. Slot 0 is the identity, transform
+    // ids start at slot 1.
+    std::vector<std::shared_ptr<Buffer>> m_transformBuffers;
+    uint32_t                             m_maxTransforms;
+    uint32_t                             m_transformsNeeded   = 0;
+    uint32_t                             m_numTransforms      = 0;
+    bool                                 m_transformsOverflow = false;
+
+    // Transform slot of every drawn instance, indexed by gl_InstanceIndex. Instance 0 always
+    // uses the identity so non-instanced draws need no setup.
+    std::vector<std::shared_ptr<Buffer>> m_instanceBuffers;
+    uint32_t                             m_maxInstances;
+    uint32_t                             m_instancesNeeded   = 0;
+    uint32_t                             m_instanceOffset    = 1;
+    bool                                 m_instancesOverflow = false;
+
+    // Indirect commands of arena meshes, one mapped buffer per frame in flight. There are never
+    // more commands than instances, so it can't overflow.
+    std::vector<std::shared_ptr<Buffer>> m_indirectBuffers;
+    uint32_t                             m_indirectOffset = 0;
+
+    std::vector<std::shared_ptr<GeometryArena>> m_geometryArenas;
+
+    std::shared_ptr<UploadManager> m_uploads;
+
+    // Null until a job system was set.
+    std::shared_ptr<CommandRecorder> m_recorder;
+
+    std::shared_ptr<CullingPass> m_cullingPass;
+    bool                         m_gpuCulling = true;
+
+    // Culled draws. Their commands are indexed by batch, m_culledOrder has the live batches
+    // sorted by binds.
+    std::vector<CulledBatch>                                   m_culledBatches;
+    std::vector<uint32_t>                                      m_freeBatches;
+    std::map<std::pair<RenderPipeline, const Mesh*>, uint32_t> m_batchLookup;
+    std::vector<uint32_t>                                      m_drawBatches; // By DrawId
+    std::vector<uint32_t>                                      m_culledOrder;
+    std::vector<CulledGroup>                                   m_culledGroups;
+    std::vector<CullCommand>                                   m_cullCommands;
+    bool                                                       m_culledOrderDirty = false;
+    bool                                                       m_culledDrawn      = false;
+
+    // Rebuilt after the early culled draws. Invalid until the first build for the current
+    // swapchain, the early pass then only frustum culls.
+    std::shared_ptr<HiZPass> m_hizPass;
+    uint32_t                 m_hizVersion = 0;
+    bool                     m_hizValid   = false;
+
+    std::vector<QueuedDraw>                   m_drawQueue;
+    std::vector<DrawGroup>                    m_drawGroups;
+    std::vector<uint32_t>                     m_instanceSlots;
+    std::vector<VkDrawIndexedIndirectCommand> m_indirectCommands;
+    RenderStats                               m_stats {};
+
+    std::shared_ptr<UniformBufferObject> m_ubo;
 };
 } // namespace legs
@@ -3,8 +3,10 @@
 #include <vulkan/vulkan_core.h>
 
 // Generated files by glslang
+#include <cull_comp.h>
 #include <fullscreen_frag.h>
 #include <fullscreen_vert.h>
+#include <hiz_comp.h>
 #include <lit_pnc_vert.h>
 #include <lit_pnc_frag.h>
 #include <unlit_pc_frag.h>
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <algorithm>
+#include <iterator>
+
 #include <glm/ext/matrix_clip_space.hpp>
 #include <glm/ext/matrix_transform.hpp>
 #include <glm/ext/quaternion_common.hpp>
@@ -10,6 +13,7 @@
 #include <glm/matrix.hpp>
 #include <glm/vec3.hpp>
 
+#include <legs/components/frustum.hpp>
 #include <legs/entity/camera.hpp>
 
 namespace legs
@@ -31,6 +35,9 @@ struct UniformBufferObject
     alignas(16) glm::vec3 sunDir;
     alignas(16) glm::vec3 sunColor;
 
+    // Camera frustum in world space, for culling on the GPU.
+    alignas(16) glm::vec4 frustumPlanes[SFrustum::cNumPlanes];
+
     void SetCamera(const std::shared_ptr<Camera> cam)
     {
         model       = glm::identity<glm::mat4>();
@@ -44,6 +51,17 @@ struct UniformBufferObject
         eye         = cam->GetPosition();
 
         viewport = cam->viewport;
+
+        const SFrustum frustum(proj * view);
+        std::copy(std::begin(frustum.planes), std::end(frustum.planes), frustumPlanes);
+    }
+
+    // The planes extracted by SetCamera, for culling on the CPU.
+    SFrustum GetFrustum() const
+    {
+        SFrustum frustum;
+        std::copy(std::begin(frustumPlanes), std::end(frustumPlanes), frustum.planes);
+        return frustum;
     }
 };
 
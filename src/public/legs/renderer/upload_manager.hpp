@@ -0,0 +1,126 @@
+#pragma once
+
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+
+#include <vulkan/vulkan_core.h>
+
+#include <legs/renderer/buffer.hpp>
+#include <legs/renderer/device.hpp>
+
+namespace legs
+{
+// Copy of host data into part of a device buffer.
+struct UploadRegion
+{
+    const void*             data;
+    VkDeviceSize            size;
+    std::shared_ptr<Buffer> destination;
+    VkDeviceSize            offset; // In bytes
+};
+
+// Batch an upload went into. Batches are numbered in flush order starting at 1, the future
+// completes once the GPU finished the copies.
+struct UploadTicket
+{
+    uint64_t                 value = 0;
+    std::shared_future<void> complete;
+};
+
+// Batched uploads through a persistent staging ring.
+//
+// Uploads can be queued from any thread, the data is copied into the ring right away. Once per
+// frame the render thread flushes everything queued into one submission on the transfer queue's
+// timeline. Graphics work waits for the flushed timeline value and acquires the written ranges
+// when the transfer queue is a different family. Uploads that don't fit in the free part of the
+// ring get a staging buffer of their own, so queueing never blocks on the GPU.
+class UploadManager
+{
+  public:
+    UploadManager() = delete;
+    UploadManager(Device& device, VkDeviceSize stagingSize);
+    ~UploadManager();
+
+    UploadManager(const UploadManager&)            = delete;
+    UploadManager(UploadManager&&)                 = delete;
+    UploadManager& operator=(const UploadManager&) = delete;
+    UploadManager& operator=(UploadManager&&)      = delete;
+
+    // All regions go into the same batch. Thread safe.
+    UploadTicket Upload(std::span<const UploadRegion> regions);
+
+    // Submits the queued uploads and makes the device's next submit wait for everything
+    // flushed so far. Returns true when the written ranges have to be acquired by graphics with
+    // RecordAcquire. Render thread only.
+    bool Flush();
+
+    // Queue family ownership acquire of the last flush, must be recorded outside of rendering.
+    void RecordAcquire(VkCommandBuffer commandBuffer);
+
+    // Completes the futures of finished batches and frees their staging. Render thread only.
+    void Poll();
+
+    // Batches up to this value were flushed, draws reading them are ordered after the copies.
+    uint64_t GetFlushedValue() const
+    {
+        return m_flushedValue;
+    }
+
+    bool IsFlushed(uint64_t value) const
+    {
+        return value <= m_flushedValue;
+    }
+
+  private:
+    struct Copy
+    {
+        std::shared_ptr<Buffer> source; // The ring when null
+        VkDeviceSize            sourceOffset;
+        std::shared_ptr<Buffer> destination;
+        VkDeviceSize            offset;
+        VkDeviceSize            size;
+    };
+
+    struct Batch
+    {
+        uint64_t                             value;
+        uint64_t                             signal; // Transfer timeline value
+        uint64_t                             stagingEnd; // Ring position freed on completion
+        VkCommandBuffer                      commandBuffer;
+        std::promise<void>                   promise;
+        std::vector<std::shared_ptr<Buffer>> buffers; // Kept alive until completion
+    };
+
+    // Ring positions count up forever, the offset in the ring is the position modulo its size.
+    bool AllocateStaging(VkDeviceSize size, uint64_t& position);
+
+    VkCommandBuffer GetCommandBuffer();
+
+    Device&        m_device;
+    QueueTimeline& m_timeline;
+    bool           m_ownershipTransfer; // Transfer and graphics are different families
+
+    VkCommandPool m_vkCommandPool;
+
+    std::vector<VkCommandBuffer> m_freeCommandBuffers;
+
+    std::shared_ptr<Buffer> m_staging;
+    VkDeviceSize            m_stagingSize;
+    uint64_t                m_stagingHead = 0;
+    uint64_t                m_stagingTail = 0;
+
+    std::mutex               m_mutex;
+    std::vector<Copy>        m_pending;
+    std::promise<void>       m_pendingPromise;
+    std::shared_future<void> m_pendingFuture;
+
+    std::deque<Batch>                  m_inFlight;
+    uint64_t                           m_flushedValue  = 0;
+    uint64_t                           m_flushedSignal = 0;
+    std::vector<VkBufferMemoryBarrier> m_acquireBarriers;
+};
+}; // namespace legs
@@ -0,0 +1,15 @@
+layout(std430, binding = 1) readonly buffer TransformBuffer
+{
+    mat4 models[];
+} transforms;
+
+// Transform slot of every instance, gl_InstanceIndex includes the draw's first instance.
+layout(std430, binding = 2) readonly buffer InstanceBuffer
+{
+    uint transformSlots[];
+} instances;
+
+mat4 GetModelMatrix()
+{
+    return transforms.models[instances.transformSlots[gl_InstanceIndex]];
+}
@@ -14,4 +14,6 @@ layout(binding = 0) uniform UniformBufferObject
 
     vec3 sunDir;
     vec3 sunColor;
+
+    vec4 frustumPlanes[6];
 } ubo;
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+
+#include <glm/vec3.hpp>
+
+#include <legs/jolt_pch.hpp>
+
+namespace legs
+{
+// Process wide cache of immutable Jolt shapes, so identical colliders share one shape instead of
+// creating their own. Shapes stay alive until Clear, which Physics calls on shutdown.
+//
+// Cooked shapes (meshes, convex hulls) are keyed by a hash of their source data and also saved to
+// the disk cache, later runs load them from there instead of cooking again.
+class ShapeCache
+{
+  public:
+    static JPH::ShapeRefC GetSphere(float radius);
+    static JPH::ShapeRefC GetBox(glm::vec3 halfExtent);
+
+    // Vertices are read with the given stride and must start with a glm::vec3 position,
+    // like the vertex types passed to Renderer::CreateBuffer.
+    static JPH::ShapeRefC GetMesh(
+        const void*               vertices,
+        uint32_t                  vertexSize,
+        uint32_t                  vertexCount,
+        std::span<const uint32_t> indices
+    );
+    static JPH::ShapeRefC GetConvexHull(
+        const void* vertices,
+        uint32_t    vertexSize,
+        uint32_t    vertexCount
+    );
+
+    static void SetDiskCacheDirectory(const std::string& directory)
+    {
+        std::scoped_lock lock {s_mutex};
+        s_diskCacheDirectory = directory;
+    }
+
+    static void   Clear();
+    static size_t GetSize();
+
+  private:
+    struct Key
+    {
+        JPH::EShapeSubType   subType;
+        std::array<float, 3> params;
+
+        bool operator==(const Key& other) const = default;
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const
+        {
+            return JPH::HashBytes(
+                key.params.data(),
+                sizeof(key.params),
+                static_cast<uint64_t>(key.subType)
+            );
+        }
+    };
+
+    // Hash of the source data and its size, a cooked shape is only reused when all match. Also
+    // the header of the disk cache files.
+    struct CookKey
+    {
+        uint64_t hash;
+        uint32_t vertexCount;
+        uint32_t indexCount;
+
+        bool operator==(const CookKey& other) const = default;
+    };
+
+    struct CookKeyHash
+    {
+        size_t operator()(const CookKey& key) const
+        {
+            return static_cast<size_t>(key.hash);
+        }
+    };
+
+    using CookFunction = std::function<JPH::ShapeSettings::ShapeResult()>;
+
+    static JPH::ShapeRefC GetOrCreate(const Key& key, const JPH::ShapeSettings& settings);
+    static JPH::ShapeRefC GetOrCook(const CookKey& key, const CookFunction& cook);
+
+    static JPH::ShapeRefC LoadShape(const std::string& path, const CookKey& key);
+    static void           SaveShape(
+        const std::string&    path,
+        const CookKey&        key,
+        const JPH::ShapeRefC& shape
+    );
+
+    static inline std::mutex                                               s_mutex;
+    static inline std::unordered_map<Key, JPH::ShapeRefC, KeyHash>         s_shapes;
+    static inline std::unordered_map<CookKey, JPH::ShapeRefC, CookKeyHash> s_cookedShapes;
+
+    static inline std::string s_diskCacheDirectory = "cache/shapes";
+};
+}; // namespace legs
@@ -0,0 +1,318 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <legs/log.hpp>
+
+namespace legs
+{
+template<class T>
+class TaskPromise;
+
+// Detached tasks that haven't completed yet, so their owner can destroy the ones still suspended
+// on shutdown.
+class DetachedTasks
+{
+  public:
+    void Add(std::coroutine_handle<> handle)
+    {
+        std::scoped_lock lock(m_mutex);
+        m_handles.insert(handle);
+    }
+
+    void Remove(std::coroutine_handle<> handle)
+    {
+        std::scoped_lock lock(m_mutex);
+        m_handles.erase(handle);
+    }
+
+    // None of the tasks may be running or resumed afterwards. Tasks they await are owned by their
+    // frames and destroyed with them.
+    void DestroyAll()
+    {
+        std::scoped_lock lock(m_mutex);
+        for (auto handle : m_handles)
+        {
+            handle.destroy();
+        }
+        m_handles.clear();
+    }
+
+  private:
+    std::mutex                                  m_mutex;
+    std::unordered_set<std::coroutine_handle<>> m_handles;
+};
+
+// Lazily started coroutine, it runs when awaited (or started with Engine::StartTask) and resumes
+// the awaiting coroutine when it completes. Exceptions are rethrown in the awaiting coroutine.
+template<class T = void>
+class [[nodiscard]] Task
+{
+  public:
+    using promise_type = TaskPromise<T>;
+    using Handle       = std::coroutine_handle<promise_type>;
+
+    Task() = default;
+
+    explicit Task(Handle handle) : m_handle(handle)
+    {
+    }
+
+    ~Task()
+    {
+        if (m_handle)
+        {
+            m_handle.destroy();
+        }
+    }
+
+    Task(const Task&)            = delete;
+    Task& operator=(const Task&) = delete;
+
+    Task(Task&& other) noexcept : m_handle(std::exchange(other.m_handle, {}))
+    {
+    }
+
+    Task& operator=(Task&& other) noexcept
+    {
+        if (this != &other)
+        {
+            if (m_handle)
+            {
+                m_handle.destroy();
+            }
+            m_handle = std::exchange(other.m_handle, {});
+        }
+        return *this;
+    }
+
+    bool IsDone() const
+    {
+        return !m_handle || m_handle.done();
+    }
+
+    // Give up ownership, the coroutine frame destroys itself when it completes. The returned
+    // handle starts the task when resumed, a no-op for an empty task. Tracked by owner until it
+    // completed when given.
+    std::coroutine_handle<> Detach(DetachedTasks* owner = nullptr)
+    {
+        if (!m_handle)
+        {
+            return std::noop_coroutine();
+        }
+
+        auto handle = std::exchange(m_handle, {});
+
+        handle.promise().m_detached = true;
+        handle.promise().m_owner    = owner;
+        if (owner != nullptr)
+        {
+            owner->Add(handle);
+        }
+        return handle;
+    }
+
+    auto operator co_await() && noexcept
+    {
+        struct Awaiter
+        {
+            Handle handle;
+
+            bool await_ready() const noexcept
+            {
+                return !handle || handle.done();
+            }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> continuation) noexcept
+            {
+                handle.promise().m_continuation = continuation;
+                return handle;
+            }
+
+            T await_resume()
+            {
+                return handle.promise().TakeResult();
+            }
+        };
+        return Awaiter {m_handle};
+    }
+
+  private:
+    Handle m_handle;
+};
+
+class TaskPromiseBase
+{
+  public:
+    struct FinalAwaiter
+    {
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        template<class P>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<P> handle) noexcept
+        {
+            auto& promise = handle.promise();
+            if (promise.m_detached)
+            {
+                promise.LogException();
+                if (promise.m_owner != nullptr)
+                {
+                    promise.m_owner->Remove(handle);
+                }
+                handle.destroy();
+                return std::noop_coroutine();
+            }
+            return promise.m_continuation ? promise.m_continuation : std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept
+        {
+        }
+    };
+
+    std::suspend_always initial_suspend() const noexcept
+    {
+        return {};
+    }
+
+    FinalAwaiter final_suspend() const noexcept
+    {
+        return {};
+    }
+
+    void unhandled_exception()
+    {
+        m_exception = std::current_exception();
+    }
+
+    std::coroutine_handle<> m_continuation;
+    std::exception_ptr      m_exception;
+    bool                    m_detached = false;
+    DetachedTasks*          m_owner    = nullptr;
+
+  protected:
+    void RethrowException()
+    {
+        if (m_exception)
+        {
+            std::rethrow_exception(m_exception);
+        }
+    }
+
+    // Nobody awaits a detached task, don't lose its error.
+    void LogException()
+    {
+        if (!m_exception)
+        {
+            return;
+        }
+
+        try
+        {
+            std::rethrow_exception(m_exception);
+        }
+        catch (const std::exception& ex)
+        {
+            LOG_ERROR("Unhandled exception in task: {}", ex.what());
+        }
+        catch (...)
+        {
+            LOG_ERROR("Unhandled exception in task");
+        }
+    }
+};
+
+template<class T>
+class TaskPromise : public TaskPromiseBase
+{
+  public:
+    Task<T> get_return_object()
+    {
+        return Task<T>(Task<T>::Handle::from_promise(*this));
+    }
+
+    void return_value(T value)
+    {
+        m_value.emplace(std::move(value));
+    }
+
+    T TakeResult()
+    {
+        RethrowException();
+        return std::move(*m_value);
+    }
+
+  private:
+    std::optional<T> m_value;
+};
+
+template<>
+class TaskPromise<void> : public TaskPromiseBase
+{
+  public:
+    Task<void> get_return_object()
+    {
+        return Task<void>(Task<void>::Handle::from_promise(*this));
+    }
+
+    void return_void() const
+    {
+    }
+
+    void TakeResult()
+    {
+        RethrowException();
+    }
+};
+
+// Coroutines suspended until the owner of the list takes and resumes them.
+class TaskWaitList
+{
+  public:
+    struct Awaiter
+    {
+        TaskWaitList& list;
+
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            std::scoped_lock lock(list.m_mutex);
+            list.m_handles.push_back(handle);
+        }
+
+        void await_resume() const noexcept
+        {
+        }
+    };
+
+    Awaiter Wait()
+    {
+        return Awaiter {*this};
+    }
+
+    std::vector<std::coroutine_handle<>> TakeAll()
+    {
+        std::scoped_lock                     lock(m_mutex);
+        std::vector<std::coroutine_handle<>> handles;
+        handles.swap(m_handles);
+        return handles;
+    }
+
+  private:
+    std::mutex                           m_mutex;
+    std::vector<std::coroutine_handle<>> m_handles;
+};
+}; // namespace legs
@@ -4,6 +4,7 @@
 
 #include <glm/vec2.hpp>
 
+#include <legs/jobs.hpp>
 #include <legs/renderer/renderer.hpp>
 #include <legs/window/window.hpp>
 
@@ -42,13 +43,22 @@ class UI
 
     void Render();
 
+    // Latest job system counters, shown as rates averaged over a short window.
+    void SetJobStats(const JobSystemStats& stats);
+
   private:
     void DebugWindow();
     void DemoWindow();
+    void JobStats();
 
     std::shared_ptr<Window>   m_window;
     std::shared_ptr<Renderer> m_renderer;
     ImGuiCreationInfo         m_info;
     UIState                   m_state;
+
+    // Times as fractions of a second and counts per second.
+    JobSystemStats m_jobRates {};
+    JobSystemStats m_jobStatsPrev {};
+    double         m_jobStatsTime = 0.0;
 };
 }; // namespace legs
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+#include <legs/components/frustum.hpp>
+
+namespace legs
+{
+// Candidates of the latest FrustumCuller::Cull.
+struct CullStats
+{
+    uint32_t visible;
+    uint32_t culled;
+};
+
+// Tests world space bounding spheres against the six planes of a frustum.
+//
+// Spheres are kept as separate x, y, z and radius arrays so each plane test covers a full SIMD
+// register: eight spheres per iteration with AVX, four with SSE and one at a time otherwise.
+class FrustumCuller
+{
+  public:
+    FrustumCuller() = default;
+
+    FrustumCuller(const FrustumCuller&)            = delete;
+    FrustumCuller(FrustumCuller&&)                 = delete;
+    FrustumCuller& operator=(const FrustumCuller&) = delete;
+    FrustumCuller& operator=(FrustumCuller&&)      = delete;
+
+    void Clear();
+
+    // Returns the index of the candidate for IsVisible.
+    uint32_t Add(const glm::vec3& center, float radius);
+
+    void Cull(const SFrustum& frustum);
+
+    bool IsVisible(uint32_t index) const
+    {
+        return m_visible[index] != 0;
+    }
+
+    CullStats GetStats() const
+    {
+        return m_stats;
+    }
+
+  private:
+    std::vector<float>   m_x;
+    std::vector<float>   m_y;
+    std::vector<float>   m_z;
+    std::vector<float>   m_radius;
+    std::vector<uint8_t> m_visible;
+    uint32_t             m_count = 0;
+    CullStats            m_stats {};
+};
+}; // namespace legs
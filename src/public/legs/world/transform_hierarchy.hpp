@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/ext/matrix_float4x4.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/vec3.hpp>
+
+namespace legs
+{
+using TransformId = uint32_t;
+
+static constexpr TransformId cInvalidTransformId = UINT32_MAX;
+
+// Parent/child transforms with cached world matrices.
+//
+// Nodes live in contiguous arrays sorted by depth, so parents always come before their children
+// and one linear pass computes every world transform. Setting a local transform marks the node
+// dirty, Update only recomputes dirty nodes and the subtrees below them. Ids stay stable when the
+// arrays are resorted. Not thread safe, the world uses it from the tick thread.
+class TransformHierarchy
+{
+  public:
+    TransformHierarchy() = default;
+
+    TransformHierarchy(const TransformHierarchy&)            = delete;
+    TransformHierarchy(TransformHierarchy&&)                 = delete;
+    TransformHierarchy& operator=(const TransformHierarchy&) = delete;
+    TransformHierarchy& operator=(TransformHierarchy&&)      = delete;
+
+    TransformId Create(TransformId parent = cInvalidTransformId);
+    // Children become roots, keeping their local transforms.
+    void        Destroy(TransformId id);
+
+    // Local transforms are relative to the parent, cInvalidTransformId detaches.
+    void        SetParent(TransformId id, TransformId parent);
+    TransformId GetParent(TransformId id) const;
+
+    // Only marks the node dirty if the transform changed.
+    void SetLocal(TransformId id, const glm::vec3& position, const glm::quat& rotation);
+
+    const glm::mat4x4& GetWorldMatrix(TransformId id) const
+    {
+        return m_worldMatrix[m_indices[id]];
+    }
+
+    glm::vec3 GetWorldPosition(TransformId id) const
+    {
+        return m_worldPosition[m_indices[id]];
+    }
+
+    glm::quat GetWorldRotation(TransformId id) const
+    {
+        return m_worldRotation[m_indices[id]];
+    }
+
+    // Recompute the world transforms of dirty subtrees, returns the number of nodes updated.
+    uint32_t Update();
+
+    // World matrices indexed by id, identity for free ids. For handing a snapshot to another
+    // thread.
+    void CopyWorldMatrices(std::vector<glm::mat4x4>& out) const;
+
+    size_t GetSize() const
+    {
+        return m_ids.size();
+    }
+
+  private:
+    static constexpr uint32_t cNoParent = UINT32_MAX;
+
+    // Restore depth order after parents changed or nodes were destroyed.
+    void Sort();
+
+    // Per node, indexed by position in depth order.
+    std::vector<TransformId> m_ids;
+    std::vector<uint32_t>    m_parent; // Index of the parent, cNoParent for roots
+    std::vector<glm::vec3>   m_localPosition;
+    std::vector<glm::quat>   m_localRotation;
+    std::vector<glm::vec3>   m_worldPosition;
+    std::vector<glm::quat>   m_worldRotation;
+    std::vector<glm::mat4x4> m_worldMatrix;
+    std::vector<uint8_t>     m_dirty;
+    std::vector<uint8_t>     m_changed; // Recomputed in the latest Update
+    std::vector<uint8_t>     m_alive;
+
+    // Id to index, cNoParent for free ids.
+    std::vector<uint32_t>    m_indices;
+    std::vector<TransformId> m_freeIds;
+    bool                     m_needsSort = false;
+};
+}; // namespace legs
@@ -2,19 +2,24 @@
 
 #include <memory>
 #include <mutex>
+#include <unordered_map>
 
 #include <legs/iphysics.hpp>
 
 #include <legs/entity/mesh_entity.hpp>
 #include <legs/entity/sky.hpp>
+#include <legs/world/frustum_culler.hpp>
+#include <legs/world/transform_hierarchy.hpp>
 
 namespace legs
 {
+class JobSystemThreadPool;
+
 class World
 {
   public:
     World() = delete;
-    World(std::shared_ptr<Renderer> renderer);
+    World(std::shared_ptr<Renderer> renderer, std::shared_ptr<JobSystemThreadPool> jobSystem);
     ~World();
 
     World(const World&)            = delete;
@@ -26,9 +31,20 @@ class World
     void Tick();
     void Render();
 
+    // Safe from any thread. Changes made from entity callbacks during Tick are applied after the
+    // tick loops, Frame and Render see them from their next call on.
     void AddEntity(std::shared_ptr<Entity> entity);
     void RemoveEntity(std::shared_ptr<Entity> entity);
 
+    // Attach an entity to another, its transform becomes relative to the parent. nullptr
+    // detaches. Both must be in this world, entities added during Tick only are after it.
+    void SetParent(std::shared_ptr<Entity> entity, std::shared_ptr<Entity> parent);
+
+    TransformHierarchy& GetTransforms()
+    {
+        return m_transforms;
+    }
+
     void SetSky(std::shared_ptr<Sky> sky)
     {
         m_sky = sky;
@@ -44,15 +60,78 @@ class World
         return m_physics;
     }
 
+    // Time spent in entity OnTick during the latest Tick, in seconds. Physics entities sync their
+    // transforms from the bodies here.
+    double GetSyncTime() const
+    {
+        return m_syncTime;
+    }
+
   private:
-    std::mutex m_worldMutex;
+    struct EntityChange
+    {
+        std::shared_ptr<Entity> entity;
+        bool                    add;
+    };
+
+    struct RetiredEntity
+    {
+        std::shared_ptr<Entity> entity;
+        // Published entity list version without the entity.
+        uint64_t version;
+    };
+
+    void SpawnEntity(std::shared_ptr<Entity> entity);
+    void DestroyEntity(std::shared_ptr<Entity> entity);
+    void ApplyEntityChanges();
+    void PublishEntities();
+
+    // Adds culled draws for the arena mesh entities of a new render list and removes the ones of
+    // entities that left it, the others are drawn through MeshEntity::Render.
+    void SyncCulledDraws(bool gpuCulling);
+
+    // Held by Tick and changes to the entities, reentrant as entities add and remove others from
+    // their tick callbacks.
+    std::recursive_mutex m_worldMutex;
 
     std::shared_ptr<Renderer> m_renderer;
 
+    // Tick thread copy, only changed outside of the tick loops.
     std::vector<std::shared_ptr<Entity>> m_entities;
+    std::vector<EntityChange>            m_entityChanges;
+    bool                                 m_ticking       = false;
+    bool                                 m_entitiesDirty = false;
+
+    // Removed entities keep their transform until the render thread let go of them.
+    std::vector<std::shared_ptr<Entity>> m_retiring;
+    std::vector<RetiredEntity>           m_retired;
 
     std::shared_ptr<Sky> m_sky;
 
     std::shared_ptr<IPhysics> m_physics;
+
+    TransformHierarchy m_transforms;
+
+    // World matrices of the latest tick, by TransformId, and the entity list for the main and
+    // render threads.
+    std::mutex                           m_renderMutex;
+    std::vector<glm::mat4x4>             m_renderTransforms;
+    std::vector<std::shared_ptr<Entity>> m_publishedEntities;
+    uint64_t                             m_publishedVersion = 0;
+    uint64_t                             m_renderedVersion  = 0;
+
+    // Main thread only.
+    std::vector<std::shared_ptr<Entity>> m_frameEntities;
+    uint64_t                             m_frameVersion = 0;
+
+    // Render thread only, candidate index of every entity drawn through Render.
+    std::vector<std::shared_ptr<Entity>>                m_renderEntities;
+    std::vector<std::shared_ptr<Entity>>                m_drawnEntities;
+    std::unordered_map<std::shared_ptr<Entity>, DrawId> m_culledDraws;
+    bool                                                m_culledDrawsEnabled = false;
+    FrustumCuller                                       m_culler;
+    std::vector<uint32_t>                               m_cullIndices;
+
+    double m_syncTime = 0.0;
 };
 } // namespace legs
@@ -43,6 +43,26 @@ Buffer::Buffer(
             break;
         }
 
+        case StorageBuffer:
+        {
+            bufferInfo.usage |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+            break;
+        }
+
+        case IndirectBuffer:
+        {
+            // Also written by compute culling.
+            bufferInfo.usage |=
+                VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+            break;
+        }
+
+        case StagingBuffer:
+        {
+            bufferInfo.usage |= VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+            break;
+        }
+
         default:
         {
             std::runtime_error("Unhandled buffer type");
@@ -73,13 +93,36 @@ Buffer::Buffer(
             break;
         }
 
+        case MappedBuffer:
+        {
+            allocInfo.usage = VMA_MEMORY_USAGE_AUTO;
+            allocInfo.flags |= VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT
+                               | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+            allocInfo.requiredFlags |= VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+
+            break;
+        }
+
         default:
         {
             throw std::runtime_error("Unhandled buffer destination");
         }
     }
 
-    vmaCreateBuffer(g_vma, &bufferInfo, &allocInfo, &m_vkBuffer, &m_vmaAllocation, nullptr);
+    VmaAllocationInfo allocationInfo {};
+    vmaCreateBuffer(
+        g_vma,
+        &bufferInfo,
+        &allocInfo,
+        &m_vkBuffer,
+        &m_vmaAllocation,
+        &allocationInfo
+    );
+
+    if (m_bufferLocation == MappedBuffer)
+    {
+        m_mappedData = allocationInfo.pMappedData;
+    }
 }
 
 Buffer::~Buffer()
@@ -91,12 +134,34 @@ Buffer::~Buffer()
     vmaDestroyBuffer(g_vma, m_vkBuffer, m_vmaAllocation);
 }
 
-void Buffer::Write(void* data, size_t size)
+void Buffer::Write(const void* data, size_t size)
 {
     vmaCopyMemoryToAllocation(g_vma, data, m_vmaAllocation, 0, size);
 }
 
-void Buffer::CopyToDevice(void* commandBuffer, std::shared_ptr<Buffer> deviceBuffer)
+void Buffer::WriteMapped(const void* data, size_t offset, size_t size)
+{
+    if (m_bufferLocation != MappedBuffer)
+    {
+        throw std::runtime_error("Tried writing mapped data to a non-mapped buffer");
+    }
+
+    if (offset + size > m_size)
+    {
+        throw std::runtime_error("Tried to write more data than allocated");
+    }
+
+    std::memcpy(static_cast<uint8_t*>(m_mappedData) + offset, data, size);
+
+    // No-op for coherent memory.
+    vmaFlushAllocation(g_vma, m_vmaAllocation, offset, size);
+}
+
+void Buffer::CopyToDevice(
+    void*                   commandBuffer,
+    std::shared_ptr<Buffer> deviceBuffer,
+    VkDeviceSize            dstOffset
+)
 {
     if (m_bufferLocation != HostBuffer)
     {
@@ -109,7 +174,7 @@ void Buffer::CopyToDevice(void* commandBuffer, std::shared_ptr<Buffer> deviceBuf
     }
 
     VkDeviceSize requiredSize = GetElementCount() * GetElementSize();
-    if (deviceBuffer->GetSize() < requiredSize)
+    if (deviceBuffer->GetSize() < dstOffset + requiredSize)
     {
         throw std::runtime_error("Tried copying to a buffer that is too small");
     }
@@ -119,12 +184,16 @@ void Buffer::CopyToDevice(void* commandBuffer, std::shared_ptr<Buffer> deviceBuf
     VkBufferCopy copyRegion {};
     copyRegion.size      = requiredSize;
     copyRegion.srcOffset = 0;
-    copyRegion.dstOffset = 0;
+    copyRegion.dstOffset = dstOffset;
 
     auto vkDeviceBuffer = static_pointer_cast<Buffer>(deviceBuffer);
     vkCmdCopyBuffer(vkCommandBuffer, m_vkBuffer, vkDeviceBuffer->GetVkBuffer(), 1, &copyRegion);
 
-    deviceBuffer->SetElementCount(m_elementCount);
+    // Sub-range uploads leave the element count of the whole buffer alone.
+    if (dstOffset == 0 && requiredSize == deviceBuffer->GetSize())
+    {
+        deviceBuffer->SetElementCount(m_elementCount);
+    }
 }
 
 void Buffer::Clear()
@@ -148,11 +217,11 @@ void Buffer::Clear()
     }
 }
 
-void Buffer::Bind(void* commandBuffer)
+void Buffer::Bind(void* commandBuffer, VkDeviceSize offset)
 {
-    if (m_bufferLocation != DeviceBuffer)
+    if (m_bufferLocation == HostBuffer)
     {
-        throw std::runtime_error("Tried to bind a non-device buffer");
+        throw std::runtime_error("Tried to bind a host buffer");
     }
 
     auto vkCommandBuffer = static_cast<VkCommandBuffer>(commandBuffer);
@@ -162,14 +231,14 @@ void Buffer::Bind(void* commandBuffer)
         case VertexBuffer:
         {
             VkBuffer     buffers[] = {m_vkBuffer};
-            VkDeviceSize offsets[] = {0};
+            VkDeviceSize offsets[] = {offset};
             vkCmdBindVertexBuffers(vkCommandBuffer, 0, 1, buffers, offsets);
             break;
         }
 
         case IndexBuffer:
         {
-            vkCmdBindIndexBuffer(vkCommandBuffer, m_vkBuffer, 0, VK_INDEX_TYPE_UINT32);
+            vkCmdBindIndexBuffer(vkCommandBuffer, m_vkBuffer, offset, VK_INDEX_TYPE_UINT32);
             break;
         }
 
@@ -229,6 +298,31 @@ void Buffer::Draw(
     }
 }
 
+void Buffer::DrawInstanced(void* commandBuffer, uint32_t instanceCount, uint32_t firstInstance)
+{
+    auto vkCommandBuffer = static_cast<VkCommandBuffer>(commandBuffer);
+
+    switch (m_bufferType)
+    {
+        case VertexBuffer:
+        {
+            vkCmdDraw(vkCommandBuffer, m_elementCount, instanceCount, 0, firstInstance);
+            break;
+        }
+
+        case IndexBuffer:
+        {
+            vkCmdDrawIndexed(vkCommandBuffer, m_elementCount, instanceCount, 0, 0, firstInstance);
+            break;
+        }
+
+        default:
+        {
+            throw std::runtime_error("Unhandled buffer type");
+        }
+    }
+}
+
 void Buffer::Map(void** data)
 {
     if (m_isMapped)
@@ -0,0 +1,209 @@
+#include <algorithm>
+#include <cmath>
+
+#include "../job_system_thread_pool.hpp"
+
+#include <legs/log.hpp>
+#include <legs/renderer/command_recorder.hpp>
+#include <legs/renderer/common.hpp>
+#include <legs/time.hpp>
+
+namespace legs
+{
+// Below this much recording time per job, in seconds, starting the job and executing its
+// secondary command buffer costs more than recording on one thread saves.
+static constexpr double cMinJobTime = 50e-6;
+
+// Weight of the latest recording in the time per item.
+static constexpr double cItemTimeWeight = 0.1;
+
+CommandRecorder::CommandRecorder(Device& device, std::shared_ptr<JobSystemThreadPool> jobSystem) :
+    m_device(device),
+    m_jobSystem(jobSystem),
+    m_maxJobs(static_cast<uint32_t>(jobSystem->GetMaxConcurrency()))
+{
+    LOG_DEBUG("Creating CommandRecorder with {} jobs", m_maxJobs);
+
+    VkCommandPoolCreateInfo poolInfo {};
+    poolInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = m_device.GetGraphicsQueueIndex();
+
+    m_pools.resize(m_device.GetMaxFramesInFlight());
+    for (auto& framePools : m_pools)
+    {
+        framePools.resize(m_maxJobs);
+        for (auto& jobPool : framePools)
+        {
+            VK_CHECK(
+                vkCreateCommandPool(m_device.GetVkDevice(), &poolInfo, nullptr, &jobPool.pool),
+                "Failed to create recording command pool"
+            );
+        }
+    }
+}
+
+CommandRecorder::~CommandRecorder()
+{
+    LOG_DEBUG("Destroying CommandRecorder");
+
+    for (auto& framePools : m_pools)
+    {
+        for (auto& jobPool : framePools)
+        {
+            vkDestroyCommandPool(m_device.GetVkDevice(), jobPool.pool, nullptr);
+        }
+    }
+}
+
+void CommandRecorder::Reset()
+{
+    m_stats = {};
+
+    for (auto& jobPool : m_pools[m_device.GetCurrentFrame()])
+    {
+        if (jobPool.used > 0)
+        {
+            VK_CHECK(
+                vkResetCommandPool(m_device.GetVkDevice(), jobPool.pool, 0),
+                "Failed to reset recording command pool"
+            );
+            jobPool.used = 0;
+        }
+    }
+}
+
+void CommandRecorder::Record(uint32_t count, const RecordFunction& record)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    // Items cost about the same to record, the time they took before says how many jobs are
+    // worth it.
+    const double estimate = m_itemTime * count;
+    const auto   numJobs  = static_cast<uint32_t>(
+        std::clamp(estimate / cMinJobTime, 1.0, static_cast<double>(m_maxJobs))
+    );
+
+    JPH::JobSystem::Barrier* barrier = numJobs > 1 ? m_jobSystem->CreateBarrier() : nullptr;
+    if (barrier == nullptr)
+    {
+        const auto start = Time::Now();
+        record(m_device.GetCommandBuffer(), 0, count);
+        AddRecordTime(Time::Now() - start, count);
+        return;
+    }
+
+    const uint32_t perJob  = (count + numJobs - 1) / numJobs;
+    const uint32_t numUsed = (count + perJob - 1) / perJob;
+    m_recorded.assign(numUsed, VK_NULL_HANDLE);
+    m_jobTimes.assign(numUsed, 0.0);
+
+    uint32_t job = 0;
+    for (uint32_t begin = 0; begin < count; begin += perJob, job++)
+    {
+        const uint32_t end    = std::min(begin + perJob, count);
+        JPH::JobHandle handle = m_jobSystem->CreateJob(
+            "RecordDraws",
+            JPH::Color::sOrange,
+            [this, &record, job, begin, end]()
+            {
+                const auto start         = Time::Now();
+                auto       commandBuffer = BeginCommandBuffer(job);
+                record(commandBuffer, begin, end);
+                VK_CHECK(vkEndCommandBuffer(commandBuffer), "Failed to end recorded draws");
+                m_recorded[job] = commandBuffer;
+                m_jobTimes[job] = Time::Now() - start;
+            },
+            JobPriority::FrameCritical
+        );
+        barrier->AddJob(handle);
+    }
+
+    // The render thread records a share itself while waiting.
+    m_jobSystem->WaitForJobs(barrier);
+    m_jobSystem->DestroyBarrier(barrier);
+
+    double recordTime = 0.0;
+    for (const auto time : m_jobTimes)
+    {
+        recordTime += time;
+    }
+    AddRecordTime(recordTime, count);
+    m_stats.jobs += numUsed;
+
+    // Same render pass instance, only the contents switch to the secondary command buffers.
+    auto commandBuffer = m_device.GetCommandBuffer();
+    m_device.SuspendRendering();
+    m_device.ResumeRendering(VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT);
+    vkCmdExecuteCommands(commandBuffer, numUsed, m_recorded.data());
+    m_device.SuspendRendering();
+    m_device.ResumeRendering();
+
+    // Executing secondary command buffers leaves the dynamic state undefined.
+    m_device.ApplyViewport(commandBuffer);
+}
+
+void CommandRecorder::AddRecordTime(double time, uint32_t count)
+{
+    const double itemTime = time / count;
+    m_itemTime = m_itemTime == 0.0 ? itemTime : std::lerp(m_itemTime, itemTime, cItemTimeWeight);
+    m_stats.time += time;
+}
+
+VkCommandBuffer CommandRecorder::BeginCommandBuffer(uint32_t job)
+{
+    auto& jobPool = m_pools[m_device.GetCurrentFrame()][job];
+    if (jobPool.used == jobPool.commandBuffers.size())
+    {
+        VkCommandBufferAllocateInfo allocInfo {};
+        allocInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocInfo.commandPool        = jobPool.pool;
+        allocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer commandBuffer {};
+        VK_CHECK(
+            vkAllocateCommandBuffers(m_device.GetVkDevice(), &allocInfo, &commandBuffer),
+            "Failed to allocate recording command buffer"
+        );
+        jobPool.commandBuffers.push_back(commandBuffer);
+    }
+    auto commandBuffer = jobPool.commandBuffers[jobPool.used++];
+
+    // Formats and flags have to match the rendering the buffer is executed in.
+    const VkFormat colorFormat = m_device.GetSwapchainImageFormat();
+
+    VkCommandBufferInheritanceRenderingInfo renderingInfo {};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+
+    // Executed in a resumed rendering that is suspended again, see Device::ResumeRendering.
+    renderingInfo.flags                   = VK_RENDERING_RESUMING_BIT | VK_RENDERING_SUSPENDING_BIT;
+    renderingInfo.viewMask                = 0;
+    renderingInfo.colorAttachmentCount    = 1;
+    renderingInfo.pColorAttachmentFormats = &colorFormat;
+    renderingInfo.depthAttachmentFormat   = m_device.GetDepthFormat();
+    renderingInfo.stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
+    renderingInfo.rasterizationSamples    = VK_SAMPLE_COUNT_1_BIT;
+
+    VkCommandBufferInheritanceInfo inheritanceInfo {};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.pNext = &renderingInfo;
+
+    VkCommandBufferBeginInfo beginInfo {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
+                      | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+    VK_CHECK(
+        vkBeginCommandBuffer(commandBuffer, &beginInfo),
+        "Failed to begin recording command buffer"
+    );
+    m_device.ApplyViewport(commandBuffer);
+
+    return commandBuffer;
+}
+}; // namespace legs
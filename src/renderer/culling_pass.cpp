@@ -0,0 +1,527 @@
+#include <algorithm>
+#include <utility>
+
+#include <legs/log.hpp>
+#include <legs/renderer/common.hpp>
+#include <legs/renderer/culling_pass.hpp>
+
+namespace legs
+{
+// Matches local_size_x of cull_comp.
+static constexpr uint32_t cWorkgroupSize = 64;
+
+// Buffers, followed by the Hi-Z pyramid.
+static constexpr uint32_t cNumBuffers  = 7;
+static constexpr uint32_t cNumBindings = cNumBuffers + 1;
+
+CullingPass::CullingPass(
+    const Device&                        device,
+    VkShaderModule                       shader,
+    std::vector<std::shared_ptr<Buffer>> uboBuffers,
+    std::vector<std::shared_ptr<Buffer>> transformBuffers,
+    std::vector<std::shared_ptr<Buffer>> instanceBuffers,
+    uint32_t                             maxObjects
+) :
+    m_device(device),
+    m_maxObjects(maxObjects),
+    m_uboBuffers(std::move(uboBuffers))
+{
+    LOG_DEBUG("Creating CullingPass");
+
+    m_dirtyObjects.resize(m_uboBuffers.size());
+    m_writeAll.resize(m_uboBuffers.size(), false);
+
+    CreateBuffers();
+    CreateDescriptors();
+    WriteDescriptors(transformBuffers, instanceBuffers);
+    CreatePipeline(shader);
+}
+
+CullingPass::~CullingPass()
+{
+    LOG_DEBUG("Destroying CullingPass");
+
+    vkDestroyPipeline(m_device.GetVkDevice(), m_vkPipeline, nullptr);
+    vkDestroyPipelineLayout(m_device.GetVkDevice(), m_vkPipelineLayout, nullptr);
+    vkDestroyDescriptorSetLayout(m_device.GetVkDevice(), m_vkSetLayout, nullptr);
+    vkDestroyDescriptorPool(m_device.GetVkDevice(), m_vkDescriptorPool, nullptr);
+}
+
+void CullingPass::Resize(
+    const std::vector<std::shared_ptr<Buffer>>& transformBuffers,
+    const std::vector<std::shared_ptr<Buffer>>& instanceBuffers,
+    uint32_t                                    maxObjects
+)
+{
+    m_maxObjects = maxObjects;
+    CreateBuffers();
+    WriteDescriptors(transformBuffers, instanceBuffers);
+
+    // The new buffers hold none of the objects.
+    std::ranges::fill(m_writeAll, true);
+}
+
+void CullingPass::Reset()
+{
+    m_commandOffset = 0;
+    m_groupOffset   = 0;
+}
+
+uint32_t CullingPass::AddObject(const CullObject& object)
+{
+    uint32_t id = static_cast<uint32_t>(m_idObjects.size());
+    if (!m_freeIds.empty())
+    {
+        id = m_freeIds.back();
+        m_freeIds.pop_back();
+    }
+    else
+    {
+        m_idObjects.push_back(cInvalidCullObject);
+    }
+
+    const auto index = static_cast<uint32_t>(m_objects.size());
+    m_objects.push_back(object);
+    m_objects.back().retest = 0;
+    m_objectIds.push_back(id);
+    m_idObjects[id] = index;
+    MarkObject(index);
+
+    return id;
+}
+
+void CullingPass::RemoveObject(uint32_t id)
+{
+    const uint32_t index = m_idObjects[id];
+    const auto     last  = static_cast<uint32_t>(m_objects.size() - 1);
+    if (index != last)
+    {
+        m_objects[index]                = m_objects[last];
+        m_objectIds[index]              = m_objectIds[last];
+        m_idObjects[m_objectIds[index]] = index;
+        MarkObject(index);
+    }
+
+    m_objects.pop_back();
+    m_objectIds.pop_back();
+    m_idObjects[id] = cInvalidCullObject;
+    m_freeIds.push_back(id);
+}
+
+void CullingPass::MarkObject(uint32_t index)
+{
+    for (auto& dirty : m_dirtyObjects)
+    {
+        // More changes than objects are a full copy anyway.
+        if (dirty.size() <= m_objects.size())
+        {
+            dirty.push_back(index);
+        }
+    }
+}
+
+void CullingPass::WriteObjects(uint32_t frame)
+{
+    auto& dirty  = m_dirtyObjects[frame];
+    auto& buffer = m_objectBuffers[frame];
+
+    // Past this many changes one copy of everything is cheaper.
+    if (m_writeAll[frame] || dirty.size() >= m_objects.size() / 2)
+    {
+        buffer->WriteMapped(m_objects.data(), 0, m_objects.size() * sizeof(CullObject));
+    }
+    else
+    {
+        for (const auto index : dirty)
+        {
+            // Objects removed after the change are gone.
+            if (index < m_objects.size())
+            {
+                buffer->WriteMapped(
+                    &m_objects[index],
+                    index * sizeof(CullObject),
+                    sizeof(CullObject)
+                );
+            }
+        }
+    }
+    dirty.clear();
+    m_writeAll[frame] = false;
+}
+
+void CullingPass::SetHiZ(VkImageView view, VkSampler sampler)
+{
+    VkDescriptorImageInfo imageInfo {};
+    imageInfo.sampler     = sampler;
+    imageInfo.imageView   = view;
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+    for (auto set : m_vkSets)
+    {
+        VkWriteDescriptorSet descriptorWrite {};
+        descriptorWrite.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrite.dstSet          = set;
+        descriptorWrite.dstBinding      = cNumBuffers;
+        descriptorWrite.dstArrayElement = 0;
+        descriptorWrite.descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        descriptorWrite.descriptorCount = 1;
+        descriptorWrite.pImageInfo      = &imageInfo;
+
+        vkUpdateDescriptorSets(m_device.GetVkDevice(), 1, &descriptorWrite, 0, nullptr);
+    }
+}
+
+bool CullingPass::Dispatch(
+    VkCommandBuffer              commandBuffer,
+    std::span<const CullCommand> commands,
+    uint32_t                     groupCount,
+    uint32_t                     hizLevels,
+    CullOutput&                  output
+)
+{
+    const auto numObjects  = static_cast<uint32_t>(m_objects.size());
+    const auto numCommands = static_cast<uint32_t>(commands.size());
+    if (numObjects > m_maxObjects || numCommands > m_maxObjects - m_commandOffset
+        || groupCount > m_maxObjects - m_groupOffset)
+    {
+        return false;
+    }
+
+    const auto frame       = m_device.GetCurrentFrame();
+    auto       countBuffer = m_countBuffers[frame];
+    auto       drawBuffer  = m_drawBuffers[frame];
+
+    WriteObjects(frame);
+    m_commandBuffers[frame]->WriteMapped(
+        commands.data(),
+        m_commandOffset * sizeof(CullCommand),
+        commands.size_bytes()
+    );
+
+    // Draws and counts of the late pass follow the early ones.
+    const uint32_t drawOffset  = m_commandOffset * 2;
+    const uint32_t countOffset = m_groupOffset * 2;
+
+    vkCmdFillBuffer(
+        commandBuffer,
+        countBuffer->GetVkBuffer(),
+        countOffset * sizeof(uint32_t),
+        groupCount * 2 * sizeof(uint32_t),
+        0
+    );
+
+    VkMemoryBarrier fillBarrier {};
+    fillBarrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    fillBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    fillBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        1,
+        &fillBarrier,
+        0,
+        nullptr,
+        0,
+        nullptr
+    );
+
+    PushConstants constants {};
+    constants.mode          = 0;
+    constants.objectOffset  = 0;
+    constants.commandOffset = m_commandOffset;
+    constants.drawOffset    = drawOffset;
+    constants.countOffset   = countOffset;
+    constants.hizLevels     = hizLevels;
+    Record(commandBuffer, constants, numObjects, numCommands);
+
+    output.drawBuffer      = drawBuffer->GetVkBuffer();
+    output.drawOffset      = drawOffset * sizeof(VkDrawIndexedIndirectCommand);
+    output.lateDrawOffset  = (drawOffset + numCommands) * sizeof(VkDrawIndexedIndirectCommand);
+    output.countBuffer     = countBuffer->GetVkBuffer();
+    output.countOffset     = countOffset * sizeof(uint32_t);
+    output.lateCountOffset = (countOffset + groupCount) * sizeof(uint32_t);
+
+    m_lastDispatch = constants;
+    m_lastObjects  = numObjects;
+    m_lastCommands = numCommands;
+    m_lastGroups   = groupCount;
+
+    m_commandOffset += numCommands;
+    m_groupOffset += groupCount;
+
+    return true;
+}
+
+void CullingPass::DispatchLate(VkCommandBuffer commandBuffer, uint32_t hizLevels)
+{
+    auto constants        = m_lastDispatch;
+    constants.mode        = 2;
+    constants.drawOffset  = m_lastDispatch.drawOffset + m_lastCommands;
+    constants.countOffset = m_lastDispatch.countOffset + m_lastGroups;
+    constants.hizLevels   = hizLevels;
+    Record(commandBuffer, constants, m_lastObjects, m_lastCommands);
+}
+
+void CullingPass::Record(
+    VkCommandBuffer commandBuffer,
+    PushConstants   constants,
+    uint32_t        numObjects,
+    uint32_t        numCommands
+)
+{
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_vkPipeline);
+    vkCmdBindDescriptorSets(
+        commandBuffer,
+        VK_PIPELINE_BIND_POINT_COMPUTE,
+        m_vkPipelineLayout,
+        0,
+        1,
+        &m_vkSets[m_device.GetCurrentFrame()],
+        0,
+        nullptr
+    );
+
+    constants.count = numObjects;
+    vkCmdPushConstants(
+        commandBuffer,
+        m_vkPipelineLayout,
+        VK_SHADER_STAGE_COMPUTE_BIT,
+        0,
+        sizeof(PushConstants),
+        &constants
+    );
+    vkCmdDispatch(commandBuffer, (numObjects + cWorkgroupSize - 1) / cWorkgroupSize, 1, 1);
+
+    // Instance counts of the commands are final before compacting.
+    VkMemoryBarrier cullBarrier {};
+    cullBarrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    cullBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        1,
+        &cullBarrier,
+        0,
+        nullptr,
+        0,
+        nullptr
+    );
+
+    constants.mode++;
+    constants.count = numCommands;
+    vkCmdPushConstants(
+        commandBuffer,
+        m_vkPipelineLayout,
+        VK_SHADER_STAGE_COMPUTE_BIT,
+        0,
+        sizeof(PushConstants),
+        &constants
+    );
+    vkCmdDispatch(commandBuffer, (numCommands + cWorkgroupSize - 1) / cWorkgroupSize, 1, 1);
+
+    // Draws read the compacted commands, counts and instance slots.
+    VkMemoryBarrier drawBarrier {};
+    drawBarrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    drawBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    drawBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+        0,
+        1,
+        &drawBarrier,
+        0,
+        nullptr,
+        0,
+        nullptr
+    );
+}
+
+void CullingPass::CreateBuffers()
+{
+    m_objectBuffers.clear();
+    m_commandBuffers.clear();
+    m_drawBuffers.clear();
+    m_countBuffers.clear();
+
+    for (size_t i = 0; i < m_uboBuffers.size(); i++)
+    {
+        m_objectBuffers.push_back(
+            std::make_shared<Buffer>(StorageBuffer, MappedBuffer, sizeof(CullObject), m_maxObjects)
+        );
+        m_commandBuffers.push_back(
+            std::make_shared<Buffer>(StorageBuffer, MappedBuffer, sizeof(CullCommand), m_maxObjects)
+        );
+        m_drawBuffers.push_back(std::make_shared<Buffer>(
+            IndirectBuffer,
+            DeviceBuffer,
+            sizeof(VkDrawIndexedIndirectCommand),
+            m_maxObjects * 2
+        ));
+        m_countBuffers.push_back(std::make_shared<Buffer>(
+            IndirectBuffer,
+            DeviceBuffer,
+            sizeof(uint32_t),
+            m_maxObjects * 2
+        ));
+    }
+}
+
+void CullingPass::CreateDescriptors()
+{
+    const auto maxFrames = static_cast<uint32_t>(m_uboBuffers.size());
+
+    VkDescriptorPoolSize poolSizes[3] {};
+    poolSizes[0].type            = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    poolSizes[0].descriptorCount = maxFrames;
+    poolSizes[1].type            = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[1].descriptorCount = maxFrames * (cNumBuffers - 1);
+    poolSizes[2].type            = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[2].descriptorCount = maxFrames;
+
+    VkDescriptorPoolCreateInfo poolInfo {};
+    poolInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = 3;
+    poolInfo.pPoolSizes    = poolSizes;
+    poolInfo.maxSets       = maxFrames;
+
+    VK_CHECK(
+        vkCreateDescriptorPool(m_device.GetVkDevice(), &poolInfo, nullptr, &m_vkDescriptorPool),
+        "Failed to create culling descriptor pool"
+    );
+
+    // 0 UBO, 1 transforms, 2 instance slots, 3 objects, 4 commands, 5 draws, 6 draw counts,
+    // 7 Hi-Z pyramid.
+    VkDescriptorSetLayoutBinding bindings[cNumBindings] {};
+    for (uint32_t i = 0; i < cNumBindings; i++)
+    {
+        bindings[i].binding         = i;
+        bindings[i].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    bindings[0].descriptorType           = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    bindings[cNumBuffers].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo {};
+    layoutInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = cNumBindings;
+    layoutInfo.pBindings    = bindings;
+
+    VK_CHECK(
+        vkCreateDescriptorSetLayout(m_device.GetVkDevice(), &layoutInfo, nullptr, &m_vkSetLayout),
+        "Failed to create culling descriptor set layout"
+    );
+
+    std::vector<VkDescriptorSetLayout> layouts(maxFrames, m_vkSetLayout);
+    m_vkSets.resize(maxFrames);
+
+    VkDescriptorSetAllocateInfo allocInfo {};
+    allocInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool     = m_vkDescriptorPool;
+    allocInfo.descriptorSetCount = maxFrames;
+    allocInfo.pSetLayouts        = layouts.data();
+
+    VK_CHECK(
+        vkAllocateDescriptorSets(m_device.GetVkDevice(), &allocInfo, m_vkSets.data()),
+        "Failed to allocate culling descriptor sets"
+    );
+}
+
+void CullingPass::WriteDescriptors(
+    const std::vector<std::shared_ptr<Buffer>>& transformBuffers,
+    const std::vector<std::shared_ptr<Buffer>>& instanceBuffers
+)
+{
+    for (uint32_t i = 0; i < m_vkSets.size(); i++)
+    {
+        // The pyramid is written by SetHiZ.
+        const std::shared_ptr<Buffer> buffers[cNumBuffers] = {
+            m_uboBuffers[i],
+            transformBuffers[i],
+            instanceBuffers[i],
+            m_objectBuffers[i],
+            m_commandBuffers[i],
+            m_drawBuffers[i],
+            m_countBuffers[i],
+        };
+
+        VkDescriptorBufferInfo bufferInfos[cNumBuffers] {};
+        VkWriteDescriptorSet   descriptorWrites[cNumBuffers] {};
+        for (uint32_t binding = 0; binding < cNumBuffers; binding++)
+        {
+            bufferInfos[binding].buffer = buffers[binding]->GetVkBuffer();
+            bufferInfos[binding].offset = 0;
+            bufferInfos[binding].range  = VK_WHOLE_SIZE;
+
+            descriptorWrites[binding].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[binding].dstSet          = m_vkSets[i];
+            descriptorWrites[binding].dstBinding      = binding;
+            descriptorWrites[binding].dstArrayElement = 0;
+            descriptorWrites[binding].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            descriptorWrites[binding].descriptorCount = 1;
+            descriptorWrites[binding].pBufferInfo     = &bufferInfos[binding];
+        }
+        descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+
+        vkUpdateDescriptorSets(
+            m_device.GetVkDevice(),
+            cNumBuffers,
+            descriptorWrites,
+            0,
+            nullptr
+        );
+    }
+}
+
+void CullingPass::CreatePipeline(VkShaderModule shader)
+{
+    VkPushConstantRange pushConstants {};
+    pushConstants.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstants.offset     = 0;
+    pushConstants.size       = sizeof(PushConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo {};
+    pipelineLayoutInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount         = 1;
+    pipelineLayoutInfo.pSetLayouts            = &m_vkSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges    = &pushConstants;
+
+    VK_CHECK(
+        vkCreatePipelineLayout(
+            m_device.GetVkDevice(),
+            &pipelineLayoutInfo,
+            nullptr,
+            &m_vkPipelineLayout
+        ),
+        "Failed to create culling pipeline layout"
+    );
+
+    VkComputePipelineCreateInfo createInfo {};
+    createInfo.sType        = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    createInfo.stage.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    createInfo.stage.stage  = VK_SHADER_STAGE_COMPUTE_BIT;
+    createInfo.stage.module = shader;
+    createInfo.stage.pName  = "main";
+    createInfo.layout       = m_vkPipelineLayout;
+
+    VK_CHECK(
+        vkCreateComputePipelines(
+            m_device.GetVkDevice(),
+            VK_NULL_HANDLE,
+            1,
+            &createInfo,
+            nullptr,
+            &m_vkPipeline
+        ),
+        "Failed to create culling pipeline"
+    );
+}
+}; // namespace legs
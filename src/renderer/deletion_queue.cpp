@@ -0,0 +1,50 @@
+#include <utility>
+
+#include <legs/log.hpp>
+#include <legs/renderer/deletion_queue.hpp>
+
+namespace legs
+{
+DeletionQueue::DeletionQueue(uint32_t maxFramesInFlight) :
+    m_frames(maxFramesInFlight)
+{
+    LOG_DEBUG("Creating DeletionQueue for {} frames", maxFramesInFlight);
+}
+
+DeletionQueue::~DeletionQueue()
+{
+    LOG_DEBUG("Destroying DeletionQueue");
+    ReleaseAll();
+}
+
+void DeletionQueue::Hold(uint32_t frame, std::shared_ptr<void> resource)
+{
+    m_frames[frame].resources.push_back(std::move(resource));
+}
+
+void DeletionQueue::Defer(uint32_t frame, std::function<void()> destroy)
+{
+    m_frames[frame].callbacks.push_back(std::move(destroy));
+}
+
+void DeletionQueue::Release(uint32_t frame)
+{
+    auto& pending = m_frames[frame];
+
+    // Newest first, views go before the images they were created from.
+    for (auto it = pending.callbacks.rbegin(); it != pending.callbacks.rend(); it++)
+    {
+        (*it)();
+    }
+    pending.callbacks.clear();
+    pending.resources.clear();
+}
+
+void DeletionQueue::ReleaseAll()
+{
+    for (uint32_t i = 0; i < m_frames.size(); i++)
+    {
+        Release(i);
+    }
+}
+}; // namespace legs
@@ -1,5 +1,6 @@
 #include <cstdint>
 #include <cstring>
+#include <utility>
 
 #include <legs/renderer/common.hpp>
 #include <legs/renderer/descriptor_set.hpp>
@@ -10,10 +11,14 @@ namespace legs
 {
 DescriptorSet::DescriptorSet(
     const Device&                        device,
-    std::vector<std::shared_ptr<Buffer>> uboBuffers
+    std::vector<std::shared_ptr<Buffer>> uboBuffers,
+    std::vector<std::shared_ptr<Buffer>> transformBuffers,
+    std::vector<std::shared_ptr<Buffer>> instanceBuffers
 ) :
     m_device(device),
-    m_uniformBuffers(uboBuffers)
+    m_uniformBuffers(uboBuffers),
+    m_transformBuffers(transformBuffers),
+    m_instanceBuffers(instanceBuffers)
 {
     VkDescriptorSetLayoutBinding uboBinding {};
     uboBinding.binding            = 0;
@@ -22,10 +27,22 @@ DescriptorSet::DescriptorSet(
     uboBinding.stageFlags         = VK_SHADER_STAGE_VERTEX_BIT;
     uboBinding.pImmutableSamplers = nullptr;
 
+    VkDescriptorSetLayoutBinding transformBinding {};
+    transformBinding.binding            = 1;
+    transformBinding.descriptorType     = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    transformBinding.descriptorCount    = 1;
+    transformBinding.stageFlags         = VK_SHADER_STAGE_VERTEX_BIT;
+    transformBinding.pImmutableSamplers = nullptr;
+
+    VkDescriptorSetLayoutBinding instanceBinding = transformBinding;
+    instanceBinding.binding                      = 2;
+
+    VkDescriptorSetLayoutBinding bindings[] = {uboBinding, transformBinding, instanceBinding};
+
     VkDescriptorSetLayoutCreateInfo layoutInfo {};
     layoutInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    layoutInfo.bindingCount = 1;
-    layoutInfo.pBindings    = &uboBinding;
+    layoutInfo.bindingCount = 3;
+    layoutInfo.pBindings    = bindings;
 
     const auto maxFrames = static_cast<uint32_t>(m_uniformBuffers.size());
     m_vkLayouts.resize(maxFrames);
@@ -77,12 +94,15 @@ DescriptorSet::DescriptorSet(
         descriptorWrite.pBufferInfo     = &bufferInfo;
 
         vkUpdateDescriptorSets(m_device.GetVkDevice(), 1, &descriptorWrite, 0, nullptr);
+        WriteStorageBuffers(i);
     }
 }
 
 DescriptorSet::~DescriptorSet()
 {
     m_uniformBuffers.clear();
+    m_transformBuffers.clear();
+    m_instanceBuffers.clear();
 
     for (auto& layout : m_vkLayouts)
     {
@@ -95,6 +115,48 @@ void DescriptorSet::UpdateUBO(uint32_t frameIndex, const std::shared_ptr<Uniform
     std::memcpy(m_ubosMappedMemory[frameIndex], ubo.get(), sizeof(UniformBufferObject));
 }
 
+void DescriptorSet::SetStorageBuffers(
+    std::vector<std::shared_ptr<Buffer>> transformBuffers,
+    std::vector<std::shared_ptr<Buffer>> instanceBuffers
+)
+{
+    m_transformBuffers = std::move(transformBuffers);
+    m_instanceBuffers  = std::move(instanceBuffers);
+
+    for (uint32_t i = 0; i < m_vkSets.size(); i++)
+    {
+        WriteStorageBuffers(i);
+    }
+}
+
+void DescriptorSet::WriteStorageBuffers(uint32_t frameIndex)
+{
+    VkDescriptorBufferInfo transformInfo {};
+    transformInfo.buffer = m_transformBuffers[frameIndex]->GetVkBuffer();
+    transformInfo.offset = 0;
+    transformInfo.range  = VK_WHOLE_SIZE;
+
+    VkDescriptorBufferInfo instanceInfo {};
+    instanceInfo.buffer = m_instanceBuffers[frameIndex]->GetVkBuffer();
+    instanceInfo.offset = 0;
+    instanceInfo.range  = VK_WHOLE_SIZE;
+
+    VkWriteDescriptorSet descriptorWrites[2] {};
+    descriptorWrites[0].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrites[0].dstSet          = m_vkSets[frameIndex];
+    descriptorWrites[0].dstBinding      = 1;
+    descriptorWrites[0].dstArrayElement = 0;
+    descriptorWrites[0].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptorWrites[0].descriptorCount = 1;
+    descriptorWrites[0].pBufferInfo     = &transformInfo;
+
+    descriptorWrites[1]             = descriptorWrites[0];
+    descriptorWrites[1].dstBinding  = 2;
+    descriptorWrites[1].pBufferInfo = &instanceInfo;
+
+    vkUpdateDescriptorSets(m_device.GetVkDevice(), 2, descriptorWrites, 0, nullptr);
+}
+
 void DescriptorSet::Bind(
     VkCommandBuffer     commandBuffer,
     VkPipelineBindPoint bindPoint,
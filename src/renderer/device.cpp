@@ -50,6 +50,11 @@ Device::Device(const Instance& instance, uint32_t maxFramesInFlight) :
 {
     LOG_INFO("Creating Device");
 
+    if (maxFramesInFlight < 2 || maxFramesInFlight > 3)
+    {
+        throw std::runtime_error("Frames in flight must be 2 or 3");
+    }
+
     PickPhysicalDevice();
     CreateLogicalDevice();
 
@@ -60,6 +65,7 @@ Device::Device(const Instance& instance, uint32_t maxFramesInFlight) :
     CreateCommandPool();
     CreateCommandBuffers();
     CreateSyncObjects();
+    CreateTimelines();
     CreateDescriptorPools();
 }
 
@@ -72,10 +78,9 @@ Device::~Device()
     vkDestroyDescriptorPool(m_vkDevice, m_vkUboDescriptorPool, nullptr);
     vkDestroyDescriptorPool(m_vkDevice, m_vkImGuiDescriptorPool, nullptr);
 
-    for (auto& fence : m_vkInFlightFences)
-    {
-        vkDestroyFence(m_vkDevice, fence, nullptr);
-    }
+    m_transferTimeline.reset();
+    m_graphicsTimeline.reset();
+
     for (auto& semaphore : m_vkImageSemaphores)
     {
         vkDestroySemaphore(m_vkDevice, semaphore, nullptr);
@@ -96,10 +101,7 @@ Device::~Device()
 
 void Device::Begin()
 {
-    VK_CHECK(
-        vkWaitForFences(m_vkDevice, 1, &m_vkInFlightFences[m_currentFrame], VK_TRUE, UINT64_MAX),
-        "Failed waiting for in flight fence"
-    );
+    m_graphicsTimeline->Wait(m_frameValues[m_currentFrame]);
 
     auto imageResult = vkAcquireNextImageKHR(
         m_vkDevice,
@@ -120,11 +122,6 @@ void Device::Begin()
         throw std::runtime_error("Failed to acquire next swapchain image");
     }
 
-    VK_CHECK(
-        vkResetFences(m_vkDevice, 1, &m_vkInFlightFences[m_currentFrame]),
-        "Failed to reset in flight fence"
-    );
-
     VK_CHECK(
         vkResetCommandBuffer(m_vkCommandBuffers[m_currentFrame], 0),
         "Failed to reset command buffer"
@@ -145,6 +142,92 @@ void Device::Begin()
         VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
     );
 
+    // Cleared below, the previous frame's contents only live on in the Hi-Z pyramid. There is
+    // one depth attachment for all frames in flight, so the clear waits for the previous frame's
+    // depth tests and Hi-Z reads.
+    VkImageSubresourceRange depthRange {};
+    depthRange.aspectMask     = VK_IMAGE_ASPECT_DEPTH_BIT;
+    depthRange.baseMipLevel   = 0;
+    depthRange.levelCount     = 1;
+    depthRange.baseArrayLayer = 0;
+    depthRange.layerCount     = 1;
+    TransitionImageLayout(
+        m_vkCommandBuffers[m_currentFrame],
+        m_vkDepthImage,
+        VK_IMAGE_LAYOUT_UNDEFINED,
+        VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+        depthRange,
+        VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT
+            | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+        GetAccessFlags(VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL)
+    );
+
+    // Rendering is kept suspendable, see SuspendRendering.
+    BeginRendering(VK_ATTACHMENT_LOAD_OP_CLEAR, VK_RENDERING_SUSPENDING_BIT);
+
+    ResetViewport();
+}
+
+void Device::SuspendRendering()
+{
+    _vkCmdEndRenderingKHR(m_instance.GetVkInstance(), m_vkCommandBuffers[m_currentFrame]);
+}
+
+void Device::ResumeRendering(VkRenderingFlags flags)
+{
+    BeginRendering(
+        m_renderingLoadOp,
+        VK_RENDERING_RESUMING_BIT | VK_RENDERING_SUSPENDING_BIT | flags
+    );
+}
+
+void Device::EndRendering()
+{
+    // Rendering is always suspended at its end, resuming it without suspending again ends the
+    // render pass instance.
+    _vkCmdEndRenderingKHR(m_instance.GetVkInstance(), m_vkCommandBuffers[m_currentFrame]);
+    BeginRendering(m_renderingLoadOp, VK_RENDERING_RESUMING_BIT);
+    _vkCmdEndRenderingKHR(m_instance.GetVkInstance(), m_vkCommandBuffers[m_currentFrame]);
+}
+
+void Device::RestartRendering()
+{
+    // Loading the attachments again reads what the last rendering stored.
+    VkMemoryBarrier attachmentBarrier {};
+    attachmentBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    attachmentBarrier.srcAccessMask =
+        VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    attachmentBarrier.dstAccessMask =
+        VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+        | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT
+        | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+    const VkPipelineStageFlags attachmentStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
+                                                  | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT
+                                                  | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    vkCmdPipelineBarrier(
+        m_vkCommandBuffers[m_currentFrame],
+        attachmentStages,
+        attachmentStages,
+        0,
+        1,
+        &attachmentBarrier,
+        0,
+        nullptr,
+        0,
+        nullptr
+    );
+
+    // Viewport and scissor are command buffer state, they survive the break.
+    BeginRendering(VK_ATTACHMENT_LOAD_OP_LOAD, VK_RENDERING_SUSPENDING_BIT);
+}
+
+void Device::BeginRendering(VkAttachmentLoadOp loadOp, VkRenderingFlags flags)
+{
+    m_renderingLoadOp = loadOp;
+
     VkClearValue clearColor {};
     clearColor.color = {
         {0.0f, 0.0f, 0.0f, 1.0f}
@@ -155,7 +238,7 @@ void Device::Begin()
     VkRenderingAttachmentInfoKHR colorAttachment {};
     colorAttachment.sType       = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
     colorAttachment.clearValue  = clearColor;
-    colorAttachment.loadOp      = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    colorAttachment.loadOp      = loadOp;
     colorAttachment.storeOp     = VK_ATTACHMENT_STORE_OP_STORE;
     colorAttachment.imageView   = m_vkSwapchainImageViews[m_currentImageIndex];
     colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
@@ -164,7 +247,7 @@ void Device::Begin()
     VkRenderingAttachmentInfoKHR depthAttachment {};
     depthAttachment.sType       = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
     depthAttachment.clearValue  = clearDepth;
-    depthAttachment.loadOp      = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthAttachment.loadOp      = loadOp;
     depthAttachment.storeOp     = VK_ATTACHMENT_STORE_OP_STORE;
     depthAttachment.imageView   = m_vkDepthImageView;
     depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL;
@@ -183,54 +266,54 @@ void Device::Begin()
     renderingInfo.pColorAttachments    = &colorAttachment;
     renderingInfo.pDepthAttachment     = &depthAttachment;
     renderingInfo.pStencilAttachment   = nullptr;
-    renderingInfo.flags                = 0;
+    renderingInfo.flags                = flags;
 
     _vkCmdBeginRenderingKHR(
         m_instance.GetVkInstance(),
         m_vkCommandBuffers[m_currentFrame],
         &renderingInfo
     );
-
-    ResetViewport();
 }
 
 void Device::ResetViewport()
 {
-    VkViewport viewport {};
-    viewport.x        = 0.0f;
-    viewport.y        = 0.0f;
-    viewport.width    = static_cast<float>(m_vkSwapchainExtent.width);
-    viewport.height   = static_cast<float>(m_vkSwapchainExtent.height);
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-    vkCmdSetViewport(m_vkCommandBuffers[m_currentFrame], 0, 1, &viewport);
+    m_viewport.x        = 0.0f;
+    m_viewport.y        = 0.0f;
+    m_viewport.width    = static_cast<float>(m_vkSwapchainExtent.width);
+    m_viewport.height   = static_cast<float>(m_vkSwapchainExtent.height);
+    m_viewport.minDepth = 0.0f;
+    m_viewport.maxDepth = 1.0f;
+
+    m_scissor.offset = {0, 0};
+    m_scissor.extent = m_vkSwapchainExtent;
 
-    VkRect2D scissor {};
-    scissor.offset = {0, 0};
-    scissor.extent = m_vkSwapchainExtent;
-    vkCmdSetScissor(m_vkCommandBuffers[m_currentFrame], 0, 1, &scissor);
+    ApplyViewport(m_vkCommandBuffers[m_currentFrame]);
 }
 
 void Device::SetViewport(SRect rect)
 {
-    VkViewport viewport {};
-    viewport.x        = static_cast<float>(rect.offset.x);
-    viewport.y        = static_cast<float>(rect.offset.y);
-    viewport.width    = static_cast<float>(rect.size.x);
-    viewport.height   = static_cast<float>(rect.size.y);
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-    vkCmdSetViewport(m_vkCommandBuffers[m_currentFrame], 0, 1, &viewport);
+    m_viewport.x        = static_cast<float>(rect.offset.x);
+    m_viewport.y        = static_cast<float>(rect.offset.y);
+    m_viewport.width    = static_cast<float>(rect.size.x);
+    m_viewport.height   = static_cast<float>(rect.size.y);
+    m_viewport.minDepth = 0.0f;
+    m_viewport.maxDepth = 1.0f;
+
+    m_scissor.offset = {rect.offset.x, rect.offset.y};
+    m_scissor.extent = {static_cast<uint32_t>(rect.size.x), static_cast<uint32_t>(rect.size.y)};
 
-    VkRect2D scissor {};
-    scissor.offset = {rect.offset.x, rect.offset.y};
-    scissor.extent = {static_cast<uint32_t>(rect.size.x), static_cast<uint32_t>(rect.size.y)};
-    vkCmdSetScissor(m_vkCommandBuffers[m_currentFrame], 0, 1, &scissor);
+    ApplyViewport(m_vkCommandBuffers[m_currentFrame]);
+}
+
+void Device::ApplyViewport(VkCommandBuffer commandBuffer) const
+{
+    vkCmdSetViewport(commandBuffer, 0, 1, &m_viewport);
+    vkCmdSetScissor(commandBuffer, 0, 1, &m_scissor);
 }
 
 void Device::Submit()
 {
-    _vkCmdEndRenderingKHR(m_instance.GetVkInstance(), m_vkCommandBuffers[m_currentFrame]);
+    EndRendering();
 
     TransitionImageLayout(
         m_vkCommandBuffers[m_currentFrame],
@@ -244,24 +327,23 @@ void Device::Submit()
         "Failed to end command buffer"
     );
 
-    VkSemaphore          waitSemaphores[]   = {m_vkImageSemaphores[m_currentFrame]};
-    VkPipelineStageFlags waitStages[]       = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-    VkSemaphore          signalSemaphores[] = {m_vkRenderSemaphores[m_currentFrame]};
-
-    VkSubmitInfo submitInfo {};
-    submitInfo.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount   = 1;
-    submitInfo.pCommandBuffers      = &m_vkCommandBuffers[m_currentFrame];
-    submitInfo.waitSemaphoreCount   = 1;
-    submitInfo.pWaitSemaphores      = waitSemaphores;
-    submitInfo.pWaitDstStageMask    = waitStages;
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores    = signalSemaphores;
+    // The image semaphore is binary, its value is ignored.
+    m_submitWaits.push_back(
+        {m_vkImageSemaphores[m_currentFrame], 0, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT}
+    );
 
-    VK_CHECK(
-        vkQueueSubmit(m_vkGraphicsQueue, 1, &submitInfo, m_vkInFlightFences[m_currentFrame]),
-        "Failed to submit queue"
+    m_frameValues[m_currentFrame] = m_graphicsTimeline->Submit(
+        {&m_vkCommandBuffers[m_currentFrame], 1},
+        m_submitWaits,
+        m_vkRenderSemaphores[m_currentFrame]
     );
+
+    m_submitWaits.clear();
+}
+
+void Device::AddSubmitWait(VkSemaphore semaphore, uint64_t value, VkPipelineStageFlags stages)
+{
+    m_submitWaits.push_back({semaphore, value, stages});
 }
 
 void Device::Present()
@@ -277,7 +359,10 @@ void Device::Present()
     presentInfo.pSwapchains        = swapchains;
     presentInfo.pImageIndices      = &m_currentImageIndex;
 
-    auto presentResult = vkQueuePresentKHR(m_vkPresentQueue, &presentInfo);
+    // The present queue is usually the graphics queue, which other threads submit uploads to.
+    auto presentResult = m_vkPresentQueue == m_graphicsTimeline->GetVkQueue()
+        ? m_graphicsTimeline->Present(presentInfo)
+        : vkQueuePresentKHR(m_vkPresentQueue, &presentInfo);
     if (presentResult == VK_ERROR_OUT_OF_DATE_KHR || presentResult == VK_SUBOPTIMAL_KHR
         || m_frameBufferResized)
     {
@@ -292,9 +377,13 @@ void Device::Present()
     m_currentFrame = (m_currentFrame + 1) % m_maxFramesInFlight;
 }
 
-void Device::WaitForGraphicsIdle()
+void Device::WaitForIdle()
 {
-    vkQueueWaitIdle(m_vkGraphicsQueue);
+    m_graphicsTimeline->Wait(m_graphicsTimeline->GetSubmittedValue());
+    if (m_transferTimeline != nullptr)
+    {
+        m_transferTimeline->Wait(m_transferTimeline->GetSubmittedValue());
+    }
 }
 
 VkCommandBuffer Device::GetTemporaryCommandBuffer()
@@ -328,17 +417,8 @@ void Device::SubmitTemporaryCommandBuffer(VkCommandBuffer commandBuffer)
 {
     VK_CHECK(vkEndCommandBuffer(commandBuffer), "Failed to end temporary command buffer");
 
-    VkSubmitInfo submitInfo {};
-    submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers    = &commandBuffer;
-
-    VK_CHECK(
-        vkQueueSubmit(m_vkGraphicsQueue, 1, &submitInfo, VK_NULL_HANDLE),
-        "Failed to submit temporary command buffer"
-    );
-    // TODO: wait all copies with fences?
-    WaitForGraphicsIdle();
+    // Waits for the value of this submission, frames submitted after it keep running.
+    m_graphicsTimeline->Wait(m_graphicsTimeline->Submit({&commandBuffer, 1}));
 
     vkFreeCommandBuffers(m_vkDevice, m_vkCommandPool, 1, &commandBuffer);
 }
@@ -382,11 +462,26 @@ void Device::PickPhysicalDevice()
     std::vector<VkPhysicalDevice> devices(deviceCount);
     vkEnumeratePhysicalDevices(m_instance.GetVkInstance(), &deviceCount, devices.data());
 
+    // Prefer a discrete GPU, anything else that works (integrated, lavapipe) is a fallback.
     for (const auto& device : devices)
     {
-        if (IsDeviceSuitable(device))
+        if (!IsDeviceSuitable(device))
+        {
+            continue;
+        }
+
+        VkPhysicalDeviceProperties deviceProperties {};
+        vkGetPhysicalDeviceProperties(device, &deviceProperties);
+
+        if (m_vkPhysicalDevice == VK_NULL_HANDLE
+            || deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU)
         {
             m_vkPhysicalDevice = device;
+            LOG_DEBUG("Suitable physical device: {}", deviceProperties.deviceName);
+        }
+
+        if (deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU)
+        {
             break;
         }
     }
@@ -399,12 +494,13 @@ void Device::PickPhysicalDevice()
 
 bool Device::IsDeviceSuitable(const VkPhysicalDevice device)
 {
-    VkPhysicalDeviceProperties deviceProperties {};
-    vkGetPhysicalDeviceProperties(device, &deviceProperties);
+    VkPhysicalDeviceVulkan12Features vulkan12Features {};
+    vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    vulkan12Features.pNext = nullptr;
 
     VkPhysicalDeviceDynamicRenderingFeatures dynamicRenderingFeature {};
     dynamicRenderingFeature.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES;
-    dynamicRenderingFeature.pNext = nullptr;
+    dynamicRenderingFeature.pNext = &vulkan12Features;
 
     VkPhysicalDeviceFeatures2 deviceFeatures {};
     deviceFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
@@ -414,7 +510,18 @@ bool Device::IsDeviceSuitable(const VkPhysicalDevice device)
 
     auto dynamicRenderingSupported = dynamicRenderingFeature.dynamicRendering == VK_TRUE;
 
-    auto featuresSupported = dynamicRenderingSupported;
+    // Indirect multi-draws of the geometry arenas.
+    auto indirectSupported = deviceFeatures.features.multiDrawIndirect == VK_TRUE
+                             && deviceFeatures.features.drawIndirectFirstInstance == VK_TRUE;
+
+    // Draw counts written by compute culling.
+    auto indirectCountSupported = vulkan12Features.drawIndirectCount == VK_TRUE;
+
+    // Completion of uploads.
+    auto timelineSupported = vulkan12Features.timelineSemaphore == VK_TRUE;
+
+    auto featuresSupported = dynamicRenderingSupported && indirectSupported
+                             && indirectCountSupported && timelineSupported;
 
     auto familyIndices       = FindQueueFamilies(device);
     auto extensionsSupported = CheckDeviceExtensionSupport(device);
@@ -427,8 +534,7 @@ bool Device::IsDeviceSuitable(const VkPhysicalDevice device)
             !swapchainSupport.formats.empty() && !swapchainSupport.presentModes.empty();
     }
 
-    return deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU
-           && familyIndices.IsComplete() && featuresSupported && extensionsSupported
+    return familyIndices.IsComplete() && featuresSupported && extensionsSupported
            && swapchainAdequate;
 }
 
@@ -442,6 +548,18 @@ QueueFamilyIndices Device::FindQueueFamilies(const VkPhysicalDevice device)
     std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
     vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
 
+    // Dedicated transfer families copy without taking time from graphics work.
+    for (uint32_t family = 0; family < queueFamilyCount; family++)
+    {
+        const auto flags = queueFamilies[family].queueFlags;
+        if ((flags & VK_QUEUE_TRANSFER_BIT)
+            && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+        {
+            familyIndices.transferFamily = family;
+            break;
+        }
+    }
+
     uint32_t i = 0;
     for (const auto& family : queueFamilies)
     {
@@ -652,10 +770,12 @@ void Device::CreateSwapchain()
         &m_vmaDepthAllocation,
         VK_IMAGE_TYPE_2D,
         GetDepthFormat(),
-        VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+        VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
         extent.width,
         extent.height
     );
+
+    m_swapchainVersion++;
 }
 
 void Device::CreateImage(
@@ -753,6 +873,10 @@ void Device::CreateLogicalDevice()
         familyIndices.graphicsFamily.value(),
         familyIndices.presentFamily.value()
     };
+    if (familyIndices.transferFamily.has_value())
+    {
+        uniqueQueueFamilies.insert(familyIndices.transferFamily.value());
+    }
 
     auto queuePriority = 1.0f;
     for (uint32_t familyIndex : uniqueQueueFamilies)
@@ -765,14 +889,22 @@ void Device::CreateLogicalDevice()
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
+    VkPhysicalDeviceVulkan12Features vulkan12Features {};
+    vulkan12Features.sType             = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    vulkan12Features.drawIndirectCount = VK_TRUE;
+    vulkan12Features.timelineSemaphore = VK_TRUE;
+    vulkan12Features.pNext             = nullptr;
+
     VkPhysicalDeviceDynamicRenderingFeatures dynamicRenderingFeature {};
     dynamicRenderingFeature.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES;
     dynamicRenderingFeature.dynamicRendering = VK_TRUE;
-    dynamicRenderingFeature.pNext            = nullptr;
+    dynamicRenderingFeature.pNext            = &vulkan12Features;
 
     VkPhysicalDeviceFeatures2 deviceFeatures {};
     deviceFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
     deviceFeatures.pNext = &dynamicRenderingFeature;
+    deviceFeatures.features.multiDrawIndirect         = VK_TRUE;
+    deviceFeatures.features.drawIndirectFirstInstance = VK_TRUE;
 
     VkDeviceCreateInfo deviceCreateInfo {};
     deviceCreateInfo.sType                   = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -790,8 +922,15 @@ void Device::CreateLogicalDevice()
 
     m_vkGraphicsQueueIndex = familyIndices.graphicsFamily.value();
     m_vkPresentQueueIndex  = familyIndices.presentFamily.value();
+    m_vkTransferQueueIndex = familyIndices.transferFamily.value_or(m_vkGraphicsQueueIndex);
     vkGetDeviceQueue(m_vkDevice, m_vkGraphicsQueueIndex, 0, &m_vkGraphicsQueue);
     vkGetDeviceQueue(m_vkDevice, m_vkPresentQueueIndex, 0, &m_vkPresentQueue);
+    vkGetDeviceQueue(m_vkDevice, m_vkTransferQueueIndex, 0, &m_vkTransferQueue);
+
+    if (familyIndices.transferFamily.has_value())
+    {
+        LOG_INFO("Using transfer queue family {} for uploads", m_vkTransferQueueIndex);
+    }
 }
 
 void Device::CreateCommandPool()
@@ -829,15 +968,10 @@ void Device::CreateSyncObjects()
 {
     m_vkImageSemaphores.resize(m_maxFramesInFlight);
     m_vkRenderSemaphores.resize(m_maxFramesInFlight);
-    m_vkInFlightFences.resize(m_maxFramesInFlight);
 
     VkSemaphoreCreateInfo semaphoreInfo {};
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-    VkFenceCreateInfo fenceInfo {};
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
     for (uint32_t i = 0; i < m_maxFramesInFlight; i++)
     {
         VK_CHECK(
@@ -848,23 +982,33 @@ void Device::CreateSyncObjects()
             vkCreateSemaphore(m_vkDevice, &semaphoreInfo, nullptr, &m_vkRenderSemaphores[i]),
             "Failed to create render semaphore"
         );
-        VK_CHECK(
-            vkCreateFence(m_vkDevice, &fenceInfo, nullptr, &m_vkInFlightFences[i]),
-            "Failed to create in flight fence"
-        );
     }
 }
 
+void Device::CreateTimelines()
+{
+    m_graphicsTimeline = std::make_unique<QueueTimeline>(m_vkDevice, m_vkGraphicsQueue);
+    if (m_vkTransferQueue != m_vkGraphicsQueue)
+    {
+        m_transferTimeline = std::make_unique<QueueTimeline>(m_vkDevice, m_vkTransferQueue);
+    }
+
+    // Nothing to wait for before the first submit of a frame.
+    m_frameValues.assign(m_maxFramesInFlight, 0);
+}
+
 void Device::CreateDescriptorPools()
 {
-    VkDescriptorPoolSize uboPoolSize {};
-    uboPoolSize.type            = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    uboPoolSize.descriptorCount = m_maxFramesInFlight;
+    VkDescriptorPoolSize uboPoolSizes[2] {};
+    uboPoolSizes[0].type            = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    uboPoolSizes[0].descriptorCount = m_maxFramesInFlight;
+    uboPoolSizes[1].type            = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    uboPoolSizes[1].descriptorCount = m_maxFramesInFlight * 2;
 
     VkDescriptorPoolCreateInfo uboPoolInfo {};
     uboPoolInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    uboPoolInfo.poolSizeCount = 1;
-    uboPoolInfo.pPoolSizes    = &uboPoolSize;
+    uboPoolInfo.poolSizeCount = 2;
+    uboPoolInfo.pPoolSizes    = uboPoolSizes;
     uboPoolInfo.maxSets       = m_maxFramesInFlight;
 
     VK_CHECK(
@@ -0,0 +1,104 @@
+#include <legs/log.hpp>
+#include <legs/renderer/common.hpp>
+#include <legs/renderer/geometry_arena.hpp>
+
+namespace legs
+{
+Mesh::Mesh(
+    std::shared_ptr<GeometryArena> arena,
+    VmaVirtualAllocation           vertexAllocation,
+    VmaVirtualAllocation           indexAllocation,
+    uint32_t                       vertexOffset,
+    uint32_t                       firstIndex,
+    uint32_t                       indexCount
+) :
+    m_arena(arena),
+    m_vertexAllocation(vertexAllocation),
+    m_indexAllocation(indexAllocation),
+    m_vertexOffset(vertexOffset),
+    m_firstIndex(firstIndex),
+    m_indexCount(indexCount)
+{
+}
+
+Mesh::~Mesh()
+{
+    m_arena->Free(m_vertexAllocation, m_indexAllocation);
+}
+
+GeometryArena::GeometryArena(uint32_t vertexSize, uint32_t maxVertices, uint32_t maxIndices) :
+    m_vertexSize(vertexSize)
+{
+    LOG_DEBUG("Creating GeometryArena for {} byte vertices", vertexSize);
+
+    m_vertexBuffer = std::make_shared<Buffer>(VertexBuffer, DeviceBuffer, vertexSize, maxVertices);
+    m_indexBuffer  = std::make_shared<Buffer>(IndexBuffer, DeviceBuffer, sizeof(Index), maxIndices);
+
+    VmaVirtualBlockCreateInfo vertexInfo {};
+    vertexInfo.size = maxVertices;
+    VK_CHECK(
+        vmaCreateVirtualBlock(&vertexInfo, &m_vertexBlock),
+        "Failed to create vertex virtual block"
+    );
+
+    VmaVirtualBlockCreateInfo indexInfo {};
+    indexInfo.size = maxIndices;
+    VK_CHECK(
+        vmaCreateVirtualBlock(&indexInfo, &m_indexBlock),
+        "Failed to create index virtual block"
+    );
+}
+
+GeometryArena::~GeometryArena()
+{
+    LOG_DEBUG("Destroying GeometryArena");
+
+    // Meshes hold the arena, nothing can be allocated anymore.
+    vmaDestroyVirtualBlock(m_vertexBlock);
+    vmaDestroyVirtualBlock(m_indexBlock);
+}
+
+std::shared_ptr<Mesh> GeometryArena::Allocate(uint32_t vertexCount, uint32_t indexCount)
+{
+    VmaVirtualAllocationCreateInfo vertexInfo {};
+    vertexInfo.size = vertexCount;
+
+    VmaVirtualAllocationCreateInfo indexInfo {};
+    indexInfo.size = indexCount;
+
+    VmaVirtualAllocation vertices;
+    VmaVirtualAllocation indices;
+    VkDeviceSize         vertexOffset;
+    VkDeviceSize         firstIndex;
+    {
+        std::scoped_lock lock {m_mutex};
+
+        if (vmaVirtualAllocate(m_vertexBlock, &vertexInfo, &vertices, &vertexOffset) != VK_SUCCESS)
+        {
+            return nullptr;
+        }
+
+        if (vmaVirtualAllocate(m_indexBlock, &indexInfo, &indices, &firstIndex) != VK_SUCCESS)
+        {
+            vmaVirtualFree(m_vertexBlock, vertices);
+            return nullptr;
+        }
+    }
+
+    return std::make_shared<Mesh>(
+        shared_from_this(),
+        vertices,
+        indices,
+        static_cast<uint32_t>(vertexOffset),
+        static_cast<uint32_t>(firstIndex),
+        indexCount
+    );
+}
+
+void GeometryArena::Free(VmaVirtualAllocation vertices, VmaVirtualAllocation indices)
+{
+    std::scoped_lock lock {m_mutex};
+    vmaVirtualFree(m_vertexBlock, vertices);
+    vmaVirtualFree(m_indexBlock, indices);
+}
+}; // namespace legs
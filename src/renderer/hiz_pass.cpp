@@ -0,0 +1,406 @@
+#include <algorithm>
+
+#include <legs/log.hpp>
+#include <legs/renderer/common.hpp>
+#include <legs/renderer/hiz_pass.hpp>
+
+namespace legs
+{
+// Matches local_size_x and local_size_y of hiz_comp.
+static constexpr uint32_t cTileSize = 8;
+
+static constexpr VkFormat cHiZFormat = VK_FORMAT_R32_SFLOAT;
+
+HiZPass::HiZPass(Device& device, VkShaderModule shader) : m_device(device)
+{
+    LOG_DEBUG("Creating HiZPass");
+
+    VkSamplerCreateInfo samplerInfo {};
+    samplerInfo.sType        = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter    = VK_FILTER_NEAREST;
+    samplerInfo.minFilter    = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode   = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.minLod       = 0.0f;
+    samplerInfo.maxLod       = VK_LOD_CLAMP_NONE;
+
+    VK_CHECK(
+        vkCreateSampler(m_device.GetVkDevice(), &samplerInfo, nullptr, &m_vkSampler),
+        "Failed to create Hi-Z sampler"
+    );
+
+    VkDescriptorSetLayoutBinding bindings[2] {};
+    bindings[0].binding         = 0;
+    bindings[0].descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[0].descriptorCount = 1;
+    bindings[0].stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT;
+    bindings[1].binding         = 1;
+    bindings[1].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    bindings[1].descriptorCount = 1;
+    bindings[1].stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo {};
+    layoutInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 2;
+    layoutInfo.pBindings    = bindings;
+
+    VK_CHECK(
+        vkCreateDescriptorSetLayout(m_device.GetVkDevice(), &layoutInfo, nullptr, &m_vkSetLayout),
+        "Failed to create Hi-Z descriptor set layout"
+    );
+
+    VkPushConstantRange pushConstants {};
+    pushConstants.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstants.offset     = 0;
+    pushConstants.size       = sizeof(PushConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo {};
+    pipelineLayoutInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount         = 1;
+    pipelineLayoutInfo.pSetLayouts            = &m_vkSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges    = &pushConstants;
+
+    VK_CHECK(
+        vkCreatePipelineLayout(
+            m_device.GetVkDevice(),
+            &pipelineLayoutInfo,
+            nullptr,
+            &m_vkPipelineLayout
+        ),
+        "Failed to create Hi-Z pipeline layout"
+    );
+
+    VkComputePipelineCreateInfo createInfo {};
+    createInfo.sType        = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    createInfo.stage.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    createInfo.stage.stage  = VK_SHADER_STAGE_COMPUTE_BIT;
+    createInfo.stage.module = shader;
+    createInfo.stage.pName  = "main";
+    createInfo.layout       = m_vkPipelineLayout;
+
+    VK_CHECK(
+        vkCreateComputePipelines(
+            m_device.GetVkDevice(),
+            VK_NULL_HANDLE,
+            1,
+            &createInfo,
+            nullptr,
+            &m_vkPipeline
+        ),
+        "Failed to create Hi-Z pipeline"
+    );
+
+    CreatePyramid();
+}
+
+HiZPass::~HiZPass()
+{
+    LOG_DEBUG("Destroying HiZPass");
+
+    DestroyPyramid();
+
+    vkDestroyPipeline(m_device.GetVkDevice(), m_vkPipeline, nullptr);
+    vkDestroyPipelineLayout(m_device.GetVkDevice(), m_vkPipelineLayout, nullptr);
+    vkDestroyDescriptorSetLayout(m_device.GetVkDevice(), m_vkSetLayout, nullptr);
+    vkDestroySampler(m_device.GetVkDevice(), m_vkSampler, nullptr);
+}
+
+void HiZPass::Resize()
+{
+    LOG_DEBUG("Resizing Hi-Z pyramid");
+
+    DestroyPyramid();
+    CreatePyramid();
+}
+
+void HiZPass::Build(VkCommandBuffer commandBuffer)
+{
+    VkImageSubresourceRange depthRange {};
+    depthRange.aspectMask     = VK_IMAGE_ASPECT_DEPTH_BIT;
+    depthRange.baseMipLevel   = 0;
+    depthRange.levelCount     = 1;
+    depthRange.baseArrayLayer = 0;
+    depthRange.layerCount     = 1;
+
+    VkImageSubresourceRange pyramidRange {};
+    pyramidRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    pyramidRange.baseMipLevel   = 0;
+    pyramidRange.levelCount     = GetLevels();
+    pyramidRange.baseArrayLayer = 0;
+    pyramidRange.layerCount     = 1;
+
+    TransitionImageLayout(
+        commandBuffer,
+        m_device.GetDepthImage(),
+        VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        depthRange,
+        VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+        VK_ACCESS_SHADER_READ_BIT
+    );
+
+    // The previous pyramid is thrown away, earlier culling must be done reading it.
+    TransitionImageLayout(
+        commandBuffer,
+        m_vkImage,
+        VK_IMAGE_LAYOUT_UNDEFINED,
+        VK_IMAGE_LAYOUT_GENERAL,
+        pyramidRange,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        VK_ACCESS_SHADER_WRITE_BIT
+    );
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_vkPipeline);
+
+    auto source = m_device.GetSwapchainExtent();
+    for (uint32_t level = 0; level < GetLevels(); level++)
+    {
+        const auto destination = m_levelSizes[level];
+
+        vkCmdBindDescriptorSets(
+            commandBuffer,
+            VK_PIPELINE_BIND_POINT_COMPUTE,
+            m_vkPipelineLayout,
+            0,
+            1,
+            &m_vkSets[level],
+            0,
+            nullptr
+        );
+
+        PushConstants constants {};
+        constants.sourceWidth       = static_cast<int32_t>(source.width);
+        constants.sourceHeight      = static_cast<int32_t>(source.height);
+        constants.destinationWidth  = static_cast<int32_t>(destination.width);
+        constants.destinationHeight = static_cast<int32_t>(destination.height);
+        vkCmdPushConstants(
+            commandBuffer,
+            m_vkPipelineLayout,
+            VK_SHADER_STAGE_COMPUTE_BIT,
+            0,
+            sizeof(PushConstants),
+            &constants
+        );
+        vkCmdDispatch(
+            commandBuffer,
+            (destination.width + cTileSize - 1) / cTileSize,
+            (destination.height + cTileSize - 1) / cTileSize,
+            1
+        );
+
+        // Read by the next level, or by culling after the last one.
+        VkMemoryBarrier levelBarrier {};
+        levelBarrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        levelBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        levelBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0,
+            1,
+            &levelBarrier,
+            0,
+            nullptr,
+            0,
+            nullptr
+        );
+
+        source = destination;
+    }
+
+    TransitionImageLayout(
+        commandBuffer,
+        m_device.GetDepthImage(),
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
+        depthRange,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+        0,
+        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+    );
+}
+
+void HiZPass::CreatePyramid()
+{
+    const auto extent = m_device.GetSwapchainExtent();
+
+    m_levelSizes.clear();
+    VkExtent2D size = {std::max(extent.width / 2, 1u), std::max(extent.height / 2, 1u)};
+    while (true)
+    {
+        m_levelSizes.push_back(size);
+        if (size.width == 1 && size.height == 1)
+        {
+            break;
+        }
+        size = {std::max(size.width / 2, 1u), std::max(size.height / 2, 1u)};
+    }
+
+    const auto levels = GetLevels();
+
+    VkImageCreateInfo imageInfo {};
+    imageInfo.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType     = VK_IMAGE_TYPE_2D;
+    imageInfo.format        = cHiZFormat;
+    imageInfo.extent.width  = m_levelSizes[0].width;
+    imageInfo.extent.height = m_levelSizes[0].height;
+    imageInfo.extent.depth  = 1;
+    imageInfo.mipLevels     = levels;
+    imageInfo.arrayLayers   = 1;
+    imageInfo.tiling        = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage         = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.samples       = VK_SAMPLE_COUNT_1_BIT;
+
+    VmaAllocationCreateInfo allocInfo {};
+    allocInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+
+    VK_CHECK(
+        vmaCreateImage(g_vma, &imageInfo, &allocInfo, &m_vkImage, &m_vmaAllocation, nullptr),
+        "Failed to create Hi-Z image"
+    );
+
+    VkImageSubresourceRange pyramidRange {};
+    pyramidRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+    pyramidRange.baseMipLevel   = 0;
+    pyramidRange.levelCount     = levels;
+    pyramidRange.baseArrayLayer = 0;
+    pyramidRange.layerCount     = 1;
+
+    VkImageViewCreateInfo viewInfo {};
+    viewInfo.sType            = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image            = m_vkImage;
+    viewInfo.viewType         = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format           = cHiZFormat;
+    viewInfo.subresourceRange = pyramidRange;
+
+    VK_CHECK(
+        vkCreateImageView(m_device.GetVkDevice(), &viewInfo, nullptr, &m_vkView),
+        "Failed to create Hi-Z view"
+    );
+
+    m_vkLevelViews.resize(levels);
+    for (uint32_t level = 0; level < levels; level++)
+    {
+        viewInfo.subresourceRange.baseMipLevel = level;
+        viewInfo.subresourceRange.levelCount   = 1;
+        VK_CHECK(
+            vkCreateImageView(m_device.GetVkDevice(), &viewInfo, nullptr, &m_vkLevelViews[level]),
+            "Failed to create Hi-Z level view"
+        );
+    }
+
+    VkDescriptorPoolSize poolSizes[2] {};
+    poolSizes[0].type            = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[0].descriptorCount = levels;
+    poolSizes[1].type            = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    poolSizes[1].descriptorCount = levels;
+
+    VkDescriptorPoolCreateInfo poolInfo {};
+    poolInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = 2;
+    poolInfo.pPoolSizes    = poolSizes;
+    poolInfo.maxSets       = levels;
+
+    VK_CHECK(
+        vkCreateDescriptorPool(m_device.GetVkDevice(), &poolInfo, nullptr, &m_vkDescriptorPool),
+        "Failed to create Hi-Z descriptor pool"
+    );
+
+    std::vector<VkDescriptorSetLayout> layouts(levels, m_vkSetLayout);
+    m_vkSets.resize(levels);
+
+    VkDescriptorSetAllocateInfo setInfo {};
+    setInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    setInfo.descriptorPool     = m_vkDescriptorPool;
+    setInfo.descriptorSetCount = levels;
+    setInfo.pSetLayouts        = layouts.data();
+
+    VK_CHECK(
+        vkAllocateDescriptorSets(m_device.GetVkDevice(), &setInfo, m_vkSets.data()),
+        "Failed to allocate Hi-Z descriptor sets"
+    );
+
+    // Descriptors of culling are bound before the first Build.
+    auto commandBuffer = m_device.GetTemporaryCommandBuffer();
+    TransitionImageLayout(
+        commandBuffer,
+        m_vkImage,
+        VK_IMAGE_LAYOUT_UNDEFINED,
+        VK_IMAGE_LAYOUT_GENERAL,
+        pyramidRange,
+        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        VK_ACCESS_SHADER_READ_BIT
+    );
+    m_device.SubmitTemporaryCommandBuffer(commandBuffer);
+
+    // Level 0 reads the depth attachment, every other level the one above it.
+    for (uint32_t level = 0; level < levels; level++)
+    {
+        VkDescriptorImageInfo sourceInfo {};
+        sourceInfo.sampler = m_vkSampler;
+        if (level == 0)
+        {
+            sourceInfo.imageView   = m_device.GetDepthImageView();
+            sourceInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        }
+        else
+        {
+            sourceInfo.imageView   = m_vkLevelViews[level - 1];
+            sourceInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        }
+
+        VkDescriptorImageInfo destinationInfo {};
+        destinationInfo.imageView   = m_vkLevelViews[level];
+        destinationInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+        VkWriteDescriptorSet descriptorWrites[2] {};
+        descriptorWrites[0].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[0].dstSet          = m_vkSets[level];
+        descriptorWrites[0].dstBinding      = 0;
+        descriptorWrites[0].dstArrayElement = 0;
+        descriptorWrites[0].descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        descriptorWrites[0].descriptorCount = 1;
+        descriptorWrites[0].pImageInfo      = &sourceInfo;
+
+        descriptorWrites[1]                = descriptorWrites[0];
+        descriptorWrites[1].dstBinding     = 1;
+        descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        descriptorWrites[1].pImageInfo     = &destinationInfo;
+
+        vkUpdateDescriptorSets(m_device.GetVkDevice(), 2, descriptorWrites, 0, nullptr);
+    }
+}
+
+void HiZPass::DestroyPyramid()
+{
+    if (m_vkImage == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    vkDestroyDescriptorPool(m_device.GetVkDevice(), m_vkDescriptorPool, nullptr);
+    for (auto view : m_vkLevelViews)
+    {
+        vkDestroyImageView(m_device.GetVkDevice(), view, nullptr);
+    }
+    vkDestroyImageView(m_device.GetVkDevice(), m_vkView, nullptr);
+    vmaDestroyImage(g_vma, m_vkImage, m_vmaAllocation);
+
+    m_vkImage = VK_NULL_HANDLE;
+    m_vkLevelViews.clear();
+    m_vkSets.clear();
+}
+}; // namespace legs
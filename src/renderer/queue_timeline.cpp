@@ -0,0 +1,139 @@
+#include <vector>
+
+#include <legs/log.hpp>
+#include <legs/renderer/common.hpp>
+#include <legs/renderer/queue_timeline.hpp>
+
+namespace legs
+{
+static void StoreMax(std::atomic<uint64_t>& target, uint64_t value)
+{
+    auto current = target.load(std::memory_order_relaxed);
+    while (current < value && !target.compare_exchange_weak(current, value))
+    {
+    }
+}
+
+QueueTimeline::QueueTimeline(VkDevice device, VkQueue queue) :
+    m_vkDevice(device),
+    m_vkQueue(queue)
+{
+    LOG_DEBUG("Creating QueueTimeline");
+
+    VkSemaphoreTypeCreateInfo typeInfo {};
+    typeInfo.sType         = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue  = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo {};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+
+    VK_CHECK(
+        vkCreateSemaphore(m_vkDevice, &semaphoreInfo, nullptr, &m_vkSemaphore),
+        "Failed to create queue timeline semaphore"
+    );
+}
+
+QueueTimeline::~QueueTimeline()
+{
+    LOG_DEBUG("Destroying QueueTimeline");
+
+    Wait(GetSubmittedValue());
+    vkDestroySemaphore(m_vkDevice, m_vkSemaphore, nullptr);
+}
+
+uint64_t QueueTimeline::Submit(
+    std::span<const VkCommandBuffer> commandBuffers,
+    std::span<const SemaphoreWait>   waits,
+    VkSemaphore                      signal
+)
+{
+    std::vector<VkSemaphore>          waitSemaphores;
+    std::vector<uint64_t>             waitValues;
+    std::vector<VkPipelineStageFlags> waitStages;
+    waitSemaphores.reserve(waits.size());
+    waitValues.reserve(waits.size());
+    waitStages.reserve(waits.size());
+    for (const auto& wait : waits)
+    {
+        waitSemaphores.push_back(wait.semaphore);
+        waitValues.push_back(wait.value);
+        waitStages.push_back(wait.stages);
+    }
+
+    std::scoped_lock lock {m_submitMutex};
+
+    const uint64_t value = m_submittedValue.load(std::memory_order_relaxed) + 1;
+
+    const VkSemaphore signalSemaphores[] = {m_vkSemaphore, signal};
+    const uint64_t    signalValues[]     = {value, 0};
+    const uint32_t    signalCount        = signal != VK_NULL_HANDLE ? 2 : 1;
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo {};
+    timelineInfo.sType                     = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount   = static_cast<uint32_t>(waitValues.size());
+    timelineInfo.pWaitSemaphoreValues      = waitValues.data();
+    timelineInfo.signalSemaphoreValueCount = signalCount;
+    timelineInfo.pSignalSemaphoreValues    = signalValues;
+
+    VkSubmitInfo submitInfo {};
+    submitInfo.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext                = &timelineInfo;
+    submitInfo.commandBufferCount   = static_cast<uint32_t>(commandBuffers.size());
+    submitInfo.pCommandBuffers      = commandBuffers.data();
+    submitInfo.waitSemaphoreCount   = static_cast<uint32_t>(waitSemaphores.size());
+    submitInfo.pWaitSemaphores      = waitSemaphores.data();
+    submitInfo.pWaitDstStageMask    = waitStages.data();
+    submitInfo.signalSemaphoreCount = signalCount;
+    submitInfo.pSignalSemaphores    = signalSemaphores;
+
+    VK_CHECK(vkQueueSubmit(m_vkQueue, 1, &submitInfo, VK_NULL_HANDLE), "Failed to submit queue");
+
+    m_submittedValue.store(value, std::memory_order_release);
+    return value;
+}
+
+VkResult QueueTimeline::Present(const VkPresentInfoKHR& presentInfo)
+{
+    std::scoped_lock lock {m_submitMutex};
+    return vkQueuePresentKHR(m_vkQueue, &presentInfo);
+}
+
+void QueueTimeline::Wait(uint64_t value) const
+{
+    if (value <= m_completedValue.load(std::memory_order_acquire))
+    {
+        return;
+    }
+
+    VkSemaphoreWaitInfo waitInfo {};
+    waitInfo.sType          = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores    = &m_vkSemaphore;
+    waitInfo.pValues        = &value;
+
+    VK_CHECK(
+        vkWaitSemaphores(m_vkDevice, &waitInfo, UINT64_MAX),
+        "Failed waiting for queue timeline"
+    );
+    StoreMax(m_completedValue, value);
+}
+
+bool QueueTimeline::IsComplete(uint64_t value) const
+{
+    return value <= m_completedValue.load(std::memory_order_acquire)
+           || value <= GetCompletedValue();
+}
+
+uint64_t QueueTimeline::GetCompletedValue() const
+{
+    uint64_t completed = 0;
+    VK_CHECK(
+        vkGetSemaphoreCounterValue(m_vkDevice, m_vkSemaphore, &completed),
+        "Failed to get queue timeline value"
+    );
+    StoreMax(m_completedValue, completed);
+    return completed;
+}
+}; // namespace legs
@@ -1,5 +1,9 @@
-#include <imgui_impl_vulkan.h>
+#include <algorithm>
+#include <bit>
 #include <memory>
+#include <tuple>
+
+#include <imgui_impl_vulkan.h>
 
 #include <legs/log.hpp>
 #include <legs/renderer/mesh_data.hpp>
@@ -8,23 +12,63 @@
 
 namespace legs
 {
+// Initial model matrices per frame including the identity in slot 0, 8 MiB per frame. The
+// buffers grow when a frame needs more.
+static constexpr uint32_t cInitialTransforms = 1 << 17;
+
+// Initial instanced meshes per frame including the identity instance 0, the instance, indirect
+// and culling buffers grow with them.
+static constexpr uint32_t cInitialInstances = 1 << 17;
+
+// Capacity of each geometry arena, a vertex size gets another arena when its arenas are full.
+static constexpr uint32_t cArenaVertices = 1 << 20;
+static constexpr uint32_t cArenaIndices  = 1 << 22;
 
-#define MAX_FRAMES_IN_FLIGHT 2
+// Upload staging ring, larger uploads get a staging buffer of their own.
+static constexpr VkDeviceSize cStagingSize = 32 << 20;
 
-Renderer::Renderer(std::shared_ptr<Window> window) :
+Renderer::Renderer(std::shared_ptr<Window> window, uint32_t framesInFlight) :
     m_instance(window),
-    m_device(m_instance, MAX_FRAMES_IN_FLIGHT)
+    m_device(m_instance, framesInFlight),
+    m_deletionQueue(framesInFlight),
+    m_maxTransforms(cInitialTransforms),
+    m_maxInstances(cInitialInstances)
 {
-    LOG_INFO("Creating Renderer");
+    LOG_INFO("Creating Renderer with {} frames in flight", framesInFlight);
+
+    m_uploads = std::make_shared<UploadManager>(m_device, cStagingSize);
 
     auto uboBuffers = std::vector<std::shared_ptr<Buffer>>();
-    for (unsigned int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    for (uint32_t i = 0; i < framesInFlight; i++)
     {
         uboBuffers.push_back(
             std::make_shared<Buffer>(UniformBuffer, HostBuffer, sizeof(UniformBufferObject), 1)
         );
     }
-    m_descriptorSet = std::make_shared<DescriptorSet>(m_device, uboBuffers);
+
+    CreateDrawBuffers();
+
+    m_descriptorSet = std::make_shared<DescriptorSet>(
+        m_device,
+        uboBuffers,
+        m_transformBuffers,
+        m_instanceBuffers
+    );
+
+    auto moduleHiZ = CreateShaderModule(LOAD_VULKAN_SPV(hiz_comp));
+    m_hizPass      = std::make_shared<HiZPass>(m_device, moduleHiZ);
+    m_hizVersion   = m_device.GetSwapchainVersion();
+
+    auto moduleCull = CreateShaderModule(LOAD_VULKAN_SPV(cull_comp));
+    m_cullingPass   = std::make_shared<CullingPass>(
+        m_device,
+        moduleCull,
+        uboBuffers,
+        m_transformBuffers,
+        m_instanceBuffers,
+        m_maxInstances
+    );
+    m_cullingPass->SetHiZ(m_hizPass->GetView(), m_hizPass->GetSampler());
 
     // TODO: abstract away all the shader + pipeline setup
     auto moduleSimpleFrag = CreateShaderModule(LOAD_VULKAN_SPV(unlit_pc_frag));
@@ -71,6 +115,22 @@ Renderer::Renderer(std::shared_ptr<Window> window) :
 
     m_skyPipeline = std::make_shared<Pipeline<Vertex_P>>(m_device, m_descriptorSet, skyStages);
 
+    m_debugLinePipeline = std::make_shared<Pipeline<Vertex_P_C>>(
+        m_device,
+        m_descriptorSet,
+        simpleStages,
+        false,
+        true,
+        true
+    );
+    m_debugTrianglePipeline = std::make_shared<Pipeline<Vertex_P_C>>(
+        m_device,
+        m_descriptorSet,
+        simpleStages,
+        false,
+        true
+    );
+
     m_ubo = std::make_shared<UniformBufferObject>();
 }
 
@@ -78,21 +138,35 @@ Renderer::~Renderer()
 {
     LOG_INFO("Destroying Renderer");
 
-    vkDeviceWaitIdle(m_device.GetVkDevice());
+    m_device.WaitForIdle();
 
     m_testPipeline.reset();
     m_geoPNCPipeline.reset();
     m_fullscreenPipeline.reset();
     m_skyPipeline.reset();
+    m_debugLinePipeline.reset();
+    m_debugTrianglePipeline.reset();
+    m_debugVertexBuffers.clear();
 
+    m_recorder.reset();
+    m_cullingPass.reset();
+    m_hizPass.reset();
     m_descriptorSet.reset();
+    m_transformBuffers.clear();
+    m_instanceBuffers.clear();
+    m_indirectBuffers.clear();
+    m_drawQueue.clear();
+    m_culledBatches.clear();
+    m_culledGroups.clear();
+    m_batchLookup.clear();
+    m_deletionQueue.ReleaseAll();
+    m_geometryArenas.clear();
+    m_uploads.reset();
 
     for (auto& module : m_vkShaderModules)
     {
         vkDestroyShaderModule(m_device.GetVkDevice(), module, nullptr);
     }
-
-    m_frameBuffers.clear();
 }
 
 void Renderer::SetWindow(std::shared_ptr<Window> window)
@@ -102,6 +176,11 @@ void Renderer::SetWindow(std::shared_ptr<Window> window)
     Resize();
 }
 
+void Renderer::SetJobSystem(std::shared_ptr<JobSystemThreadPool> jobSystem)
+{
+    m_recorder = std::make_shared<CommandRecorder>(m_device, jobSystem);
+}
+
 void Renderer::ClearViewport()
 {
     auto commandBuffer = m_device.GetCommandBuffer();
@@ -122,16 +201,111 @@ float Renderer::GetAspect()
 
 void Renderer::Begin()
 {
+    // Draws were dropped for lack of space, the next frames have room for them.
+    if (m_transformsNeeded > m_maxTransforms || m_instancesNeeded > m_maxInstances)
+    {
+        GrowDrawBuffers();
+    }
+
     m_device.Begin();
+
+    // The GPU is done with the last frame that used this slot.
+    m_deletionQueue.Release(m_device.GetCurrentFrame());
+    if (m_recorder != nullptr)
+    {
+        m_recorder->Reset();
+    }
+
+    // Recreating the swapchain left the GPU idle.
+    if (m_device.GetSwapchainVersion() != m_hizVersion)
+    {
+        m_hizPass->Resize();
+        m_cullingPass->SetHiZ(m_hizPass->GetView(), m_hizPass->GetSampler());
+        m_hizVersion = m_device.GetSwapchainVersion();
+        m_hizValid   = false;
+    }
+
+    // Uploads queued since the last frame, drawable from this one on.
+    m_uploads->Poll();
+    if (m_uploads->Flush())
+    {
+        m_device.EndRendering();
+        m_uploads->RecordAcquire(m_device.GetCommandBuffer());
+        m_device.RestartRendering();
+    }
+
+    m_debugVertexOffset = 0;
+    m_debugOverflowed   = false;
+    m_numTransforms     = 0;
+    m_instanceOffset    = 1;
+    m_indirectOffset    = 0;
+    m_stats             = {};
+    m_culledDrawn       = false;
+    m_cullingPass->Reset();
+}
+
+void Renderer::CreateDrawBuffers()
+{
+    m_transformBuffers.clear();
+    m_instanceBuffers.clear();
+    m_indirectBuffers.clear();
+
+    const auto identity = glm::identity<glm::mat4x4>();
+    for (uint32_t i = 0; i < m_device.GetMaxFramesInFlight(); i++)
+    {
+        auto buffer = std::make_shared<Buffer>(
+            StorageBuffer,
+            MappedBuffer,
+            sizeof(glm::mat4x4),
+            m_maxTransforms
+        );
+        buffer->WriteMapped(&identity, 0, sizeof(glm::mat4x4));
+        m_transformBuffers.push_back(buffer);
+    }
+
+    const uint32_t identitySlot = 0;
+    for (uint32_t i = 0; i < m_device.GetMaxFramesInFlight(); i++)
+    {
+        auto buffer =
+            std::make_shared<Buffer>(StorageBuffer, MappedBuffer, sizeof(uint32_t), m_maxInstances);
+        buffer->WriteMapped(&identitySlot, 0, sizeof(uint32_t));
+        m_instanceBuffers.push_back(buffer);
+    }
+
+    for (uint32_t i = 0; i < m_device.GetMaxFramesInFlight(); i++)
+    {
+        m_indirectBuffers.push_back(std::make_shared<Buffer>(
+            IndirectBuffer,
+            MappedBuffer,
+            sizeof(VkDrawIndexedIndirectCommand),
+            m_maxInstances
+        ));
+    }
+}
+
+void Renderer::GrowDrawBuffers()
+{
+    m_maxTransforms = std::max(m_maxTransforms, std::bit_ceil(m_transformsNeeded));
+    m_maxInstances  = std::max(m_maxInstances, std::bit_ceil(m_instancesNeeded));
+    LOG_INFO(
+        "Growing draw buffers to {} transforms, {} instances",
+        m_maxTransforms,
+        m_maxInstances
+    );
+
+    // Rare enough to wait for, every frame in flight uses the old buffers.
+    m_device.WaitForIdle();
+    CreateDrawBuffers();
+    m_descriptorSet->SetStorageBuffers(m_transformBuffers, m_instanceBuffers);
+    m_cullingPass->Resize(m_transformBuffers, m_instanceBuffers, m_maxInstances);
+
+    m_transformsOverflow = false;
+    m_instancesOverflow  = false;
 }
 
 void Renderer::Submit()
 {
     m_device.Submit();
-
-    // Not ideal but guarantees chunk buffers aren't freed too early.
-    m_device.WaitForGraphicsIdle();
-    m_frameBuffers.clear();
 }
 
 void Renderer::Present()
@@ -145,9 +319,677 @@ void Renderer::UpdateUBO()
     m_descriptorSet->UpdateUBO(currentFrame, m_ubo);
 }
 
+std::shared_ptr<Mesh> Renderer::CreateMesh(
+    const void*            vertices,
+    uint32_t               vertexSize,
+    uint32_t               vertexCount,
+    std::span<const Index> indices
+)
+{
+    if (vertexCount == 0 || indices.empty())
+    {
+        throw std::runtime_error("Tried to create an empty mesh");
+    }
+
+    const auto            indexCount = static_cast<uint32_t>(indices.size());
+    std::shared_ptr<Mesh> mesh;
+    for (const auto& arena : m_geometryArenas)
+    {
+        if (arena->GetVertexSize() == vertexSize)
+        {
+            mesh = arena->Allocate(vertexCount, indexCount);
+            if (mesh != nullptr)
+            {
+                break;
+            }
+        }
+    }
+
+    // The arenas of the vertex size are full, meshes larger than an arena get one of their size.
+    if (mesh == nullptr)
+    {
+        auto arena = std::make_shared<GeometryArena>(
+            vertexSize,
+            std::max(cArenaVertices, vertexCount),
+            std::max(cArenaIndices, indexCount)
+        );
+        m_geometryArenas.push_back(arena);
+
+        mesh = arena->Allocate(vertexCount, indexCount);
+        if (mesh == nullptr)
+        {
+            throw std::runtime_error("Failed to allocate a mesh in a new geometry arena");
+        }
+    }
+    mesh->SetBounds(SBounds::FromVertices(vertices, vertexSize, vertexCount));
+
+    const UploadRegion regions[] = {
+        {
+            vertices,
+            VkDeviceSize(vertexSize) * vertexCount,
+            arena->GetVertexBuffer(),
+            VkDeviceSize(mesh->GetVertexOffset()) * vertexSize,
+        },
+        {
+            indices.data(),
+            indices.size_bytes(),
+            arena->GetIndexBuffer(),
+            VkDeviceSize(mesh->GetFirstIndex()) * sizeof(Index),
+        },
+    };
+    mesh->SetUpload(m_uploads->Upload(regions));
+
+    return mesh;
+}
+
+std::shared_future<void> Renderer::CreateBuffer(
+    std::shared_ptr<Buffer>& buffer,
+    BufferType               bufferType,
+    const void*              data,
+    uint32_t                 elementSize,
+    uint32_t                 elementCount
+)
+{
+    auto deviceBuffer =
+        std::make_shared<Buffer>(bufferType, DeviceBuffer, elementSize, elementCount);
+
+    // Vertex types start with the position, bounds are taken like for meshes.
+    if (bufferType == VertexBuffer && elementSize >= sizeof(glm::vec3))
+    {
+        deviceBuffer->SetBounds(SBounds::FromVertices(data, elementSize, elementCount));
+    }
+
+    const UploadRegion region {data, deviceBuffer->GetSize(), deviceBuffer, 0};
+    auto               upload = m_uploads->Upload({&region, 1});
+    deviceBuffer->SetUploadValue(upload.value);
+
+    buffer = std::move(deviceBuffer);
+    return upload.complete;
+}
+
+void Renderer::SetTransforms(std::span<const glm::mat4x4> matrices)
+{
+    const auto count =
+        static_cast<uint32_t>(std::min<size_t>(matrices.size(), m_maxTransforms - 1));
+    if (count < matrices.size())
+    {
+        m_transformsNeeded = static_cast<uint32_t>(matrices.size() + 1);
+        if (!m_transformsOverflow)
+        {
+            LOG_WARN(
+                "Transform buffer full, {} transforms drawn as identity until it grew",
+                matrices.size() - count
+            );
+            m_transformsOverflow = true;
+        }
+    }
+
+    auto buffer = m_transformBuffers[m_device.GetCurrentFrame()];
+    buffer->WriteMapped(matrices.data(), sizeof(glm::mat4x4), count * sizeof(glm::mat4x4));
+    m_numTransforms = count;
+}
+
+void Renderer::DrawWithBuffers(
+    std::shared_ptr<Buffer> vertexBuffer,
+    std::shared_ptr<Buffer> indexBuffer,
+    TransformId             transform
+)
+{
+    auto commandBuffer = GetCommandBuffer();
+    if (commandBuffer == nullptr || !IsUploaded(*vertexBuffer) || !IsUploaded(*indexBuffer))
+    {
+        return;
+    }
+
+    uint32_t instance = 0;
+    if (transform != cInvalidTransformId)
+    {
+        const uint32_t slot = GetTransformSlot(transform);
+        instance            = AllocateInstances(1);
+        if (instance != 0)
+        {
+            m_instanceBuffers[m_device.GetCurrentFrame()]
+                ->WriteMapped(&slot, instance * sizeof(uint32_t), sizeof(uint32_t));
+        }
+    }
+
+    vertexBuffer->Bind(commandBuffer);
+    indexBuffer->Bind(commandBuffer);
+    indexBuffer->DrawInstanced(commandBuffer, 1, instance);
+    ReleaseAfterFrame(vertexBuffer);
+    ReleaseAfterFrame(indexBuffer);
+
+    m_stats.meshDraws++;
+    m_stats.drawCalls++;
+}
+
+void Renderer::QueueDraw(
+    RenderPipeline          pipe,
+    std::shared_ptr<Buffer> vertexBuffer,
+    std::shared_ptr<Buffer> indexBuffer,
+    TransformId             transform
+)
+{
+    if (!IsUploaded(*vertexBuffer) || !IsUploaded(*indexBuffer))
+    {
+        return;
+    }
+
+    m_drawQueue.push_back({
+        pipe,
+        std::move(vertexBuffer),
+        std::move(indexBuffer),
+        nullptr,
+        GetTransformSlot(transform),
+    });
+}
+
+void Renderer::QueueDraw(RenderPipeline pipe, std::shared_ptr<Mesh> mesh, TransformId transform)
+{
+    if (!m_uploads->IsFlushed(mesh->GetUpload().value))
+    {
+        return;
+    }
+
+    const auto& arena = mesh->GetArena();
+    m_drawQueue.push_back({
+        pipe,
+        arena->GetVertexBuffer(),
+        arena->GetIndexBuffer(),
+        std::move(mesh),
+        GetTransformSlot(transform),
+    });
+}
+
+void Renderer::FlushDraws()
+{
+    if (!m_drawQueue.empty())
+    {
+        DrawQueue();
+    }
+
+    DrawCulled();
+}
+
+DrawId Renderer::AddCulledDraw(
+    RenderPipeline        pipe,
+    std::shared_ptr<Mesh> mesh,
+    TransformId           transform
+)
+{
+    auto [lookup, added] = m_batchLookup.try_emplace({pipe, mesh.get()}, 0);
+    if (added)
+    {
+        auto batch = static_cast<uint32_t>(m_culledBatches.size());
+        if (!m_freeBatches.empty())
+        {
+            batch = m_freeBatches.back();
+            m_freeBatches.pop_back();
+        }
+        else
+        {
+            m_culledBatches.emplace_back();
+        }
+
+        m_culledBatches[batch] = {pipe, mesh, 0};
+        lookup->second         = batch;
+        m_culledOrderDirty     = true;
+    }
+
+    // The culling pass draws transforms past the buffer as identity, like queued draws.
+    const uint32_t batch  = lookup->second;
+    const auto&    bounds = mesh->GetBounds();
+    const uint32_t slot   = transform + 1;
+
+    const DrawId id =
+        m_cullingPass->AddObject({glm::vec4(bounds.center, bounds.radius), slot, batch, 0, 0});
+
+    m_culledBatches[batch].count++;
+    if (id >= m_drawBatches.size())
+    {
+        m_drawBatches.resize(id + 1);
+    }
+    m_drawBatches[id] = batch;
+
+    return id;
+}
+
+void Renderer::RemoveCulledDraw(DrawId id)
+{
+    const uint32_t batch = m_drawBatches[id];
+    m_cullingPass->RemoveObject(id);
+    if (--m_culledBatches[batch].count == 0)
+    {
+        ReleaseBatch(batch);
+    }
+}
+
+void Renderer::ReleaseBatch(uint32_t batch)
+{
+    auto& culledBatch = m_culledBatches[batch];
+    m_batchLookup.erase({culledBatch.pipeline, culledBatch.mesh.get()});
+
+    // Frames in flight may still draw the mesh.
+    ReleaseAfterFrame(std::move(culledBatch.mesh));
+
+    m_freeBatches.push_back(batch);
+    m_culledOrderDirty = true;
+}
+
+void Renderer::DrawQueue()
+{
+    const auto key = [](const QueuedDraw& draw)
+    {
+        return std::tie(draw.pipeline, draw.vertexBuffer, draw.indexBuffer, draw.mesh);
+    };
+    std::ranges::sort(m_drawQueue, {}, key);
+
+    auto count = static_cast<uint32_t>(m_drawQueue.size());
+    auto first = AllocateInstances(count);
+    if (first == 0)
+    {
+        // Draws what fits, the buffers grow for the next frame.
+        count = m_maxInstances - m_instanceOffset;
+        m_drawQueue.resize(count);
+        first = count > 0 ? AllocateInstances(count) : 0;
+        if (first == 0)
+        {
+            m_drawQueue.clear();
+            return;
+        }
+    }
+
+    // One write for the whole frame, instances of a group are consecutive.
+    m_instanceSlots.clear();
+    for (const auto& draw : m_drawQueue)
+    {
+        m_instanceSlots.push_back(draw.transformSlot);
+    }
+    m_instanceBuffers[m_device.GetCurrentFrame()]->WriteMapped(
+        m_instanceSlots.data(),
+        first * sizeof(uint32_t),
+        count * sizeof(uint32_t)
+    );
+
+    // Group everything drawn with the same binds, arena groups get one indirect command per
+    // distinct mesh.
+    m_drawGroups.clear();
+    m_indirectCommands.clear();
+    for (uint32_t begin = 0; begin < count;)
+    {
+        const auto& draw = m_drawQueue[begin];
+
+        uint32_t end = begin + 1;
+        while (end < count && m_drawQueue[end].pipeline == draw.pipeline
+               && m_drawQueue[end].vertexBuffer == draw.vertexBuffer
+               && m_drawQueue[end].indexBuffer == draw.indexBuffer)
+        {
+            end++;
+        }
+
+        const auto firstCommand = static_cast<uint32_t>(m_indirectCommands.size());
+        if (draw.mesh != nullptr)
+        {
+            for (uint32_t i = begin; i < end;)
+            {
+                const auto& mesh = m_drawQueue[i].mesh;
+
+                uint32_t next = i + 1;
+                while (next < end && m_drawQueue[next].mesh == mesh)
+                {
+                    next++;
+                }
+
+                VkDrawIndexedIndirectCommand command {};
+                command.indexCount    = mesh->GetIndexCount();
+                command.instanceCount = next - i;
+                command.firstIndex    = mesh->GetFirstIndex();
+                command.vertexOffset  = static_cast<int32_t>(mesh->GetVertexOffset());
+                command.firstInstance = first + i;
+                m_indirectCommands.push_back(command);
+                ReleaseAfterFrame(mesh);
+
+                i = next;
+            }
+        }
+
+        const auto lastCommand = static_cast<uint32_t>(m_indirectCommands.size());
+        m_drawGroups.push_back({begin, end, firstCommand, lastCommand});
+        begin = end;
+    }
+
+    DrawGroups(first);
+
+    // Recorded commands only read the buffer on submit.
+    constexpr uint32_t commandSize = sizeof(VkDrawIndexedIndirectCommand);
+    const auto         numCommands = static_cast<uint32_t>(m_indirectCommands.size());
+    if (numCommands > 0)
+    {
+        m_indirectBuffers[m_device.GetCurrentFrame()]->WriteMapped(
+            m_indirectCommands.data(),
+            m_indirectOffset * commandSize,
+            numCommands * commandSize
+        );
+        m_indirectOffset += numCommands;
+    }
+
+    m_stats.meshDraws += count;
+    m_drawQueue.clear();
+}
+
+void Renderer::DrawGroups(uint32_t firstInstance)
+{
+    // Bookkeeping stays on the render thread, recording jobs only write their command buffers.
+    for (const auto& drawGroup : m_drawGroups)
+    {
+        const auto& draw = m_drawQueue[drawGroup.begin];
+        ReleaseAfterFrame(draw.vertexBuffer);
+        ReleaseAfterFrame(draw.indexBuffer);
+        m_stats.drawCalls++;
+    }
+
+    const auto numGroups = static_cast<uint32_t>(m_drawGroups.size());
+    const auto record    = [&](VkCommandBuffer commandBuffer, uint32_t begin, uint32_t end)
+    {
+        RecordGroups(commandBuffer, begin, end, firstInstance);
+    };
+
+    if (m_recorder != nullptr)
+    {
+        m_recorder->Record(numGroups, record);
+    }
+    else
+    {
+        record(m_device.GetCommandBuffer(), 0, numGroups);
+    }
+}
+
+void Renderer::RecordGroups(
+    VkCommandBuffer commandBuffer,
+    uint32_t        begin,
+    uint32_t        end,
+    uint32_t        firstInstance
+)
+{
+    constexpr uint32_t commandSize    = sizeof(VkDrawIndexedIndirectCommand);
+    const auto&        indirectBuffer = m_indirectBuffers[m_device.GetCurrentFrame()];
+
+    RenderPipeline bound = INVALID;
+    for (uint32_t group = begin; group < end; group++)
+    {
+        const auto& drawGroup = m_drawGroups[group];
+        const auto& draw      = m_drawQueue[drawGroup.begin];
+        if (draw.pipeline != bound)
+        {
+            BindPipeline(draw.pipeline, commandBuffer);
+            bound = draw.pipeline;
+        }
+
+        draw.vertexBuffer->Bind(commandBuffer);
+        draw.indexBuffer->Bind(commandBuffer);
+
+        if (draw.mesh == nullptr)
+        {
+            // Own buffers, the whole group is one mesh.
+            const uint32_t instances = drawGroup.end - drawGroup.begin;
+            draw.indexBuffer->DrawInstanced(
+                commandBuffer,
+                instances,
+                firstInstance + drawGroup.begin
+            );
+        }
+        else
+        {
+            vkCmdDrawIndexedIndirect(
+                commandBuffer,
+                indirectBuffer->GetVkBuffer(),
+                (m_indirectOffset + drawGroup.firstCommand) * commandSize,
+                drawGroup.lastCommand - drawGroup.firstCommand,
+                commandSize
+            );
+        }
+    }
+}
+
+void Renderer::DrawCulled()
+{
+    const uint32_t numObjects = m_cullingPass->GetObjectCount();
+    if (m_culledDrawn || numObjects == 0)
+    {
+        return;
+    }
+    m_culledDrawn = true;
+
+    if (m_culledOrderDirty)
+    {
+        m_culledOrder.clear();
+        for (uint32_t batch = 0; batch < m_culledBatches.size(); batch++)
+        {
+            if (m_culledBatches[batch].mesh != nullptr)
+            {
+                m_culledOrder.push_back(batch);
+            }
+        }
+
+        const auto key = [this](uint32_t batch)
+        {
+            const auto& culledBatch = m_culledBatches[batch];
+            return std::tuple(culledBatch.pipeline, culledBatch.mesh->GetArena().get());
+        };
+        std::ranges::sort(m_culledOrder, {}, key);
+        m_culledOrderDirty = false;
+    }
+
+    const uint32_t first = AllocateInstances(numObjects);
+    if (first == 0)
+    {
+        return;
+    }
+
+    // Work per batch, not per object. The commands of free batches stay empty.
+    m_cullCommands.assign(m_culledBatches.size(), {});
+    m_culledGroups.clear();
+
+    uint32_t instance = first;
+    for (uint32_t i = 0; i < m_culledOrder.size(); i++)
+    {
+        const uint32_t batch       = m_culledOrder[i];
+        const auto&    culledBatch = m_culledBatches[batch];
+        const auto&    mesh        = culledBatch.mesh;
+        const auto&    arena       = mesh->GetArena();
+
+        if (m_culledGroups.empty() || m_culledGroups.back().pipeline != culledBatch.pipeline
+            || m_culledGroups.back().vertexBuffer != arena->GetVertexBuffer())
+        {
+            m_culledGroups.push_back({
+                culledBatch.pipeline,
+                arena->GetVertexBuffer(),
+                arena->GetIndexBuffer(),
+                i,
+                0,
+            });
+        }
+        auto& group = m_culledGroups.back();
+        group.numCommands++;
+
+        // Meshes still uploading keep their instances but draw nothing.
+        const bool uploaded = m_uploads->IsFlushed(mesh->GetUpload().value);
+
+        VkDrawIndexedIndirectCommand draw {};
+        draw.indexCount    = uploaded ? mesh->GetIndexCount() : 0;
+        draw.instanceCount = 0;
+        draw.firstIndex    = mesh->GetFirstIndex();
+        draw.vertexOffset  = static_cast<int32_t>(mesh->GetVertexOffset());
+        draw.firstInstance = instance;
+
+        const auto groupIndex = static_cast<uint32_t>(m_culledGroups.size() - 1);
+        m_cullCommands[batch] = {draw, groupIndex, group.firstCommand, culledBatch.count, 0};
+        instance += culledBatch.count;
+    }
+
+    // Compute can't be dispatched while rendering.
+    auto       commandBuffer = m_device.GetCommandBuffer();
+    const auto numGroups     = static_cast<uint32_t>(m_culledGroups.size());
+    const auto hizLevels     = m_hizValid ? m_hizPass->GetLevels() : 0;
+
+    CullOutput culled {};
+    m_device.EndRendering();
+    const bool dispatched = m_cullingPass->Dispatch(
+        commandBuffer,
+        m_cullCommands,
+        numGroups,
+        hizLevels,
+        culled
+    );
+    m_device.RestartRendering();
+    if (!dispatched)
+    {
+        return;
+    }
+
+    RecordCulledGroups(commandBuffer, culled, false);
+
+    // Objects hidden by the previous frame's depth but not by this one's are drawn late. The
+    // culled draws are drawn once per frame, so the pyramid is built once per frame too.
+    m_device.EndRendering();
+    m_hizPass->Build(commandBuffer);
+    m_cullingPass->DispatchLate(commandBuffer, m_hizPass->GetLevels());
+    m_device.RestartRendering();
+    m_hizValid = true;
+
+    RecordCulledGroups(commandBuffer, culled, true);
+
+    m_stats.meshDraws += numObjects;
+}
+
+void Renderer::RecordCulledGroups(
+    VkCommandBuffer   commandBuffer,
+    const CullOutput& culled,
+    bool              late
+)
+{
+    constexpr uint32_t commandSize = sizeof(VkDrawIndexedIndirectCommand);
+    const auto         drawOffset  = late ? culled.lateDrawOffset : culled.drawOffset;
+    const auto         countOffset = late ? culled.lateCountOffset : culled.countOffset;
+
+    RenderPipeline bound = INVALID;
+    for (uint32_t group = 0; group < m_culledGroups.size(); group++)
+    {
+        const auto& culledGroup = m_culledGroups[group];
+        if (culledGroup.pipeline != bound)
+        {
+            BindPipeline(culledGroup.pipeline, commandBuffer);
+            bound = culledGroup.pipeline;
+        }
+
+        culledGroup.vertexBuffer->Bind(commandBuffer);
+        culledGroup.indexBuffer->Bind(commandBuffer);
+
+        // Visible commands were compacted to the start of the group's range.
+        vkCmdDrawIndexedIndirectCount(
+            commandBuffer,
+            culled.drawBuffer,
+            drawOffset + culledGroup.firstCommand * commandSize,
+            culled.countBuffer,
+            countOffset + group * sizeof(uint32_t),
+            culledGroup.numCommands,
+            commandSize
+        );
+
+        if (!late)
+        {
+            ReleaseAfterFrame(culledGroup.vertexBuffer);
+            ReleaseAfterFrame(culledGroup.indexBuffer);
+        }
+        m_stats.drawCalls++;
+    }
+}
+
+uint32_t Renderer::AllocateInstances(uint32_t count)
+{
+    if (count > m_maxInstances - m_instanceOffset)
+    {
+        m_instancesNeeded = std::max(m_instancesNeeded, m_instanceOffset + count);
+        if (!m_instancesOverflow)
+        {
+            LOG_WARN("Instance buffer full, dropping draws until it grew");
+            m_instancesOverflow = true;
+        }
+        return 0;
+    }
+
+    const uint32_t first = m_instanceOffset;
+    m_instanceOffset += count;
+    return first;
+}
+
+void Renderer::SetMaxDebugVertices(uint32_t count)
+{
+    if (count == m_maxDebugVertices)
+    {
+        return;
+    }
+
+    // Earlier frames may still read the old buffers, this frame's slot is released last.
+    for (auto& buffer : m_debugVertexBuffers)
+    {
+        m_deletionQueue.Hold(m_device.GetCurrentFrame(), std::move(buffer));
+    }
+    m_debugVertexBuffers.clear();
+
+    m_maxDebugVertices  = count;
+    m_debugVertexOffset = 0;
+    if (count == 0)
+    {
+        return;
+    }
+
+    for (uint32_t i = 0; i < m_device.GetMaxFramesInFlight(); i++)
+    {
+        m_debugVertexBuffers.push_back(
+            std::make_shared<Buffer>(VertexBuffer, MappedBuffer, sizeof(Vertex_P_C), count)
+        );
+    }
+}
+
+void Renderer::DrawDebug(RenderPipeline pipe, std::span<const Vertex_P_C> vertices)
+{
+    const uint32_t primitiveSize = pipe == DEBUG_LINE_P_C ? 2 : 3;
+    const uint32_t available     = m_maxDebugVertices - m_debugVertexOffset;
+
+    auto count = static_cast<uint32_t>(std::min<size_t>(vertices.size(), available));
+    count -= count % primitiveSize;
+    if (count < vertices.size() && !m_debugOverflowed)
+    {
+        LOG_WARN(
+            "Debug vertex buffer full, dropping {} vertices this frame",
+            vertices.size() - count
+        );
+        m_debugOverflowed = true;
+    }
+    if (count == 0)
+    {
+        return;
+    }
+
+    auto buffer = m_debugVertexBuffers[m_device.GetCurrentFrame()];
+    buffer->WriteMapped(
+        vertices.data(),
+        m_debugVertexOffset * sizeof(Vertex_P_C),
+        count * sizeof(Vertex_P_C)
+    );
+
+    auto commandBuffer = m_device.GetCommandBuffer();
+    BindPipeline(pipe);
+    buffer->Bind(commandBuffer, m_debugVertexOffset * sizeof(Vertex_P_C));
+    vkCmdDraw(commandBuffer, count, 1, 0, 0);
+
+    m_debugVertexOffset += count;
+}
+
 void Renderer::WaitForIdle()
 {
-    vkDeviceWaitIdle(m_device.GetVkDevice());
+    m_device.WaitForIdle();
 }
 
 void Renderer::GetImGuiInfo(ImGuiCreationInfo& info)
@@ -173,8 +1015,8 @@ void Renderer::GetImGuiInfo(ImGuiCreationInfo& info)
     info.imGuiInfo.DescriptorPool              = m_device.GetImGuiDescriptorPool();
     info.imGuiInfo.UseDynamicRendering         = true;
     info.imGuiInfo.PipelineRenderingCreateInfo = info.pipelineCreateInfo;
-    info.imGuiInfo.MinImageCount               = MAX_FRAMES_IN_FLIGHT;
-    info.imGuiInfo.ImageCount                  = MAX_FRAMES_IN_FLIGHT;
+    info.imGuiInfo.MinImageCount               = m_device.GetMaxFramesInFlight();
+    info.imGuiInfo.ImageCount                  = m_device.GetMaxFramesInFlight();
     info.imGuiInfo.MSAASamples                 = VK_SAMPLE_COUNT_1_BIT;
     info.imGuiInfo.Allocator                   = nullptr; // TODO vma?
     info.imGuiInfo.CheckVkResultFn             = ImGuiVkCheck;
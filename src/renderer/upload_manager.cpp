@@ -0,0 +1,288 @@
+#include <utility>
+
+#include <legs/log.hpp>
+#include <legs/renderer/common.hpp>
+#include <legs/renderer/upload_manager.hpp>
+
+namespace legs
+{
+// Keeps copy sources aligned for any element type.
+static constexpr VkDeviceSize cStagingAlignment = 16;
+
+// Everything that may read uploaded buffers.
+static constexpr VkPipelineStageFlags cReadStages = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT
+                                                    | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT
+                                                    | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+UploadManager::UploadManager(Device& device, VkDeviceSize stagingSize) :
+    m_device(device),
+    m_timeline(device.GetTransferTimeline()),
+    m_ownershipTransfer(device.GetTransferQueueIndex() != device.GetGraphicsQueueIndex()),
+    m_stagingSize(stagingSize)
+{
+    LOG_DEBUG("Creating UploadManager with {} byte staging ring", stagingSize);
+
+    VkCommandPoolCreateInfo poolInfo {};
+    poolInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags            = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = m_device.GetTransferQueueIndex();
+
+    VK_CHECK(
+        vkCreateCommandPool(m_device.GetVkDevice(), &poolInfo, nullptr, &m_vkCommandPool),
+        "Failed to create upload command pool"
+    );
+
+    m_staging = std::make_shared<Buffer>(
+        StagingBuffer,
+        MappedBuffer,
+        1,
+        static_cast<uint32_t>(stagingSize)
+    );
+
+    m_pendingFuture = m_pendingPromise.get_future().share();
+}
+
+UploadManager::~UploadManager()
+{
+    LOG_DEBUG("Destroying UploadManager");
+
+    // Nothing can be waiting for the GPU anymore.
+    m_timeline.Wait(m_flushedSignal);
+    Poll();
+
+    vkDestroyCommandPool(m_device.GetVkDevice(), m_vkCommandPool, nullptr);
+}
+
+UploadTicket UploadManager::Upload(std::span<const UploadRegion> regions)
+{
+    std::scoped_lock lock {m_mutex};
+
+    for (const auto& region : regions)
+    {
+        if (region.destination->GetLocation() != DeviceBuffer)
+        {
+            throw std::runtime_error("Tried uploading to a non-device buffer");
+        }
+
+        if (region.offset + region.size > region.destination->GetSize())
+        {
+            throw std::runtime_error("Tried uploading past the end of a buffer");
+        }
+
+        Copy copy {};
+        copy.destination = region.destination;
+        copy.offset      = region.offset;
+        copy.size        = region.size;
+
+        uint64_t position;
+        if (AllocateStaging(region.size, position))
+        {
+            copy.sourceOffset = position % m_stagingSize;
+            m_staging->WriteMapped(region.data, copy.sourceOffset, region.size);
+        }
+        else
+        {
+            // Too large for the ring or the ring is still busy.
+            copy.source = std::make_shared<Buffer>(
+                StagingBuffer,
+                MappedBuffer,
+                1,
+                static_cast<uint32_t>(region.size)
+            );
+            copy.sourceOffset = 0;
+            copy.source->WriteMapped(region.data, 0, region.size);
+        }
+
+        m_pending.push_back(std::move(copy));
+    }
+
+    return {m_flushedValue + 1, m_pendingFuture};
+}
+
+bool UploadManager::Flush()
+{
+    std::scoped_lock lock {m_mutex};
+
+    m_acquireBarriers.clear();
+    if (m_pending.empty())
+    {
+        if (m_flushedValue > 0)
+        {
+            m_device.AddSubmitWait(m_timeline.GetVkSemaphore(), m_flushedSignal, cReadStages);
+        }
+        return false;
+    }
+
+    Batch batch {};
+    batch.value         = m_flushedValue + 1;
+    batch.stagingEnd    = m_stagingHead;
+    batch.commandBuffer = GetCommandBuffer();
+    batch.promise       = std::exchange(m_pendingPromise, {});
+
+    VkCommandBufferBeginInfo beginInfo {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    VK_CHECK(
+        vkBeginCommandBuffer(batch.commandBuffer, &beginInfo),
+        "Failed to begin upload command buffer"
+    );
+
+    std::vector<VkBufferMemoryBarrier> releaseBarriers;
+    for (const auto& copy : m_pending)
+    {
+        const auto source = copy.source != nullptr ? copy.source : m_staging;
+
+        VkBufferCopy region {};
+        region.srcOffset = copy.sourceOffset;
+        region.dstOffset = copy.offset;
+        region.size      = copy.size;
+        vkCmdCopyBuffer(
+            batch.commandBuffer,
+            source->GetVkBuffer(),
+            copy.destination->GetVkBuffer(),
+            1,
+            &region
+        );
+
+        if (m_ownershipTransfer)
+        {
+            VkBufferMemoryBarrier barrier {};
+            barrier.sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            barrier.srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask       = 0;
+            barrier.srcQueueFamilyIndex = m_device.GetTransferQueueIndex();
+            barrier.dstQueueFamilyIndex = m_device.GetGraphicsQueueIndex();
+            barrier.buffer              = copy.destination->GetVkBuffer();
+            barrier.offset              = copy.offset;
+            barrier.size                = copy.size;
+            releaseBarriers.push_back(barrier);
+
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT
+                                    | VK_ACCESS_SHADER_READ_BIT;
+            m_acquireBarriers.push_back(barrier);
+        }
+
+        if (copy.source != nullptr)
+        {
+            batch.buffers.push_back(copy.source);
+        }
+        batch.buffers.push_back(copy.destination);
+    }
+
+    if (!releaseBarriers.empty())
+    {
+        vkCmdPipelineBarrier(
+            batch.commandBuffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+            0,
+            0,
+            nullptr,
+            static_cast<uint32_t>(releaseBarriers.size()),
+            releaseBarriers.data(),
+            0,
+            nullptr
+        );
+    }
+
+    VK_CHECK(vkEndCommandBuffer(batch.commandBuffer), "Failed to end upload command buffer");
+
+    batch.signal = m_timeline.Submit({&batch.commandBuffer, 1});
+
+    m_flushedValue  = batch.value;
+    m_flushedSignal = batch.signal;
+    m_device.AddSubmitWait(m_timeline.GetVkSemaphore(), m_flushedSignal, cReadStages);
+
+    m_inFlight.push_back(std::move(batch));
+    m_pending.clear();
+    m_pendingFuture = m_pendingPromise.get_future().share();
+
+    return !m_acquireBarriers.empty();
+}
+
+void UploadManager::RecordAcquire(VkCommandBuffer commandBuffer)
+{
+    if (m_acquireBarriers.empty())
+    {
+        return;
+    }
+
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        cReadStages,
+        0,
+        0,
+        nullptr,
+        static_cast<uint32_t>(m_acquireBarriers.size()),
+        m_acquireBarriers.data(),
+        0,
+        nullptr
+    );
+    m_acquireBarriers.clear();
+}
+
+void UploadManager::Poll()
+{
+    const auto completed = m_timeline.GetCompletedValue();
+
+    std::scoped_lock lock {m_mutex};
+    while (!m_inFlight.empty() && m_inFlight.front().signal <= completed)
+    {
+        auto& batch = m_inFlight.front();
+        batch.promise.set_value();
+
+        m_stagingTail = batch.stagingEnd;
+        vkResetCommandBuffer(batch.commandBuffer, 0);
+        m_freeCommandBuffers.push_back(batch.commandBuffer);
+
+        m_inFlight.pop_front();
+    }
+}
+
+bool UploadManager::AllocateStaging(VkDeviceSize size, uint64_t& position)
+{
+    position = (m_stagingHead + cStagingAlignment - 1) & ~(cStagingAlignment - 1);
+
+    // Allocations never wrap, skip to the start of the ring instead.
+    const auto offset = position % m_stagingSize;
+    if (offset + size > m_stagingSize)
+    {
+        position += m_stagingSize - offset;
+    }
+
+    if (position + size - m_stagingTail > m_stagingSize)
+    {
+        return false;
+    }
+
+    m_stagingHead = position + size;
+    return true;
+}
+
+VkCommandBuffer UploadManager::GetCommandBuffer()
+{
+    if (!m_freeCommandBuffers.empty())
+    {
+        auto commandBuffer = m_freeCommandBuffers.back();
+        m_freeCommandBuffers.pop_back();
+        return commandBuffer;
+    }
+
+    VkCommandBufferAllocateInfo allocInfo {};
+    allocInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool        = m_vkCommandPool;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer {};
+    VK_CHECK(
+        vkAllocateCommandBuffers(m_device.GetVkDevice(), &allocInfo, &commandBuffer),
+        "Failed to allocate upload command buffer"
+    );
+
+    return commandBuffer;
+}
+}; // namespace legs
@@ -0,0 +1,298 @@
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+#include <legs/log.hpp>
+#include <legs/shape_cache.hpp>
+
+namespace legs
+{
+// Bump when the way cooked shapes are built changes, so stale cache files are not loaded.
+static constexpr uint64_t cCookVersion = 2;
+
+static uint64_t HashFnv1a(const void* data, size_t size, uint64_t hash = 0xcbf29ce484222325ull)
+{
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static uint64_t HashCookInputs(
+    JPH::EShapeSubType        subType,
+    const JPH::VertexList&    positions,
+    std::span<const uint32_t> indices
+)
+{
+    // Jolt version is part of the key, the binary format is not stable between versions.
+    const std::array<uint64_t, 5> header = {
+        cCookVersion,
+        JPH_VERSION_MAJOR,
+        JPH_VERSION_MINOR,
+        JPH_VERSION_PATCH,
+        static_cast<uint64_t>(subType),
+    };
+
+    uint64_t hash = HashFnv1a(header.data(), sizeof(header));
+    hash          = HashFnv1a(positions.data(), positions.size() * sizeof(JPH::Float3), hash);
+    hash          = HashFnv1a(indices.data(), indices.size_bytes(), hash);
+    return hash;
+}
+
+static JPH::VertexList ReadPositions(
+    const void* vertices,
+    uint32_t    vertexSize,
+    uint32_t    vertexCount
+)
+{
+    if (vertexSize < sizeof(JPH::Float3))
+    {
+        throw std::runtime_error(std::format("Invalid vertex size {}", vertexSize));
+    }
+
+    const auto*     bytes = static_cast<const uint8_t*>(vertices);
+    JPH::VertexList positions;
+    positions.resize(vertexCount);
+    for (uint32_t i = 0; i < vertexCount; i++)
+    {
+        std::memcpy(&positions[i], bytes + size_t {i} * vertexSize, sizeof(JPH::Float3));
+    }
+    return positions;
+}
+
+JPH::ShapeRefC ShapeCache::GetSphere(float radius)
+{
+    const Key key = {JPH::EShapeSubType::Sphere, {radius, 0.0f, 0.0f}};
+    return GetOrCreate(key, JPH::SphereShapeSettings(radius));
+}
+
+JPH::ShapeRefC ShapeCache::GetBox(glm::vec3 halfExtent)
+{
+    const Key key = {JPH::EShapeSubType::Box, {halfExtent.x, halfExtent.y, halfExtent.z}};
+    return GetOrCreate(
+        key,
+        JPH::BoxShapeSettings(JPH::Vec3(halfExtent.x, halfExtent.y, halfExtent.z))
+    );
+}
+
+JPH::ShapeRefC ShapeCache::GetMesh(
+    const void*               vertices,
+    uint32_t                  vertexSize,
+    uint32_t                  vertexCount,
+    std::span<const uint32_t> indices
+)
+{
+    if (indices.size() % 3 != 0)
+    {
+        throw std::runtime_error(std::format("Invalid mesh index count {}", indices.size()));
+    }
+
+    auto          positions = ReadPositions(vertices, vertexSize, vertexCount);
+    const CookKey key       = {
+        HashCookInputs(JPH::EShapeSubType::Mesh, positions, indices),
+        vertexCount,
+        static_cast<uint32_t>(indices.size()),
+    };
+
+    return GetOrCook(
+        key,
+        [&]()
+        {
+            JPH::IndexedTriangleList triangles;
+            triangles.reserve(indices.size() / 3);
+            for (size_t i = 0; i < indices.size(); i += 3)
+            {
+                triangles.push_back({indices[i], indices[i + 1], indices[i + 2]});
+            }
+            return JPH::MeshShapeSettings(std::move(positions), std::move(triangles)).Create();
+        }
+    );
+}
+
+JPH::ShapeRefC ShapeCache::GetConvexHull(
+    const void* vertices,
+    uint32_t    vertexSize,
+    uint32_t    vertexCount
+)
+{
+    const auto    positions = ReadPositions(vertices, vertexSize, vertexCount);
+    const CookKey key       = {
+        HashCookInputs(JPH::EShapeSubType::ConvexHull, positions, {}),
+        vertexCount,
+        0,
+    };
+
+    return GetOrCook(
+        key,
+        [&]()
+        {
+            JPH::Array<JPH::Vec3> points;
+            points.reserve(positions.size());
+            for (const auto& position : positions)
+            {
+                points.push_back(JPH::Vec3(position));
+            }
+            return JPH::ConvexHullShapeSettings(points).Create();
+        }
+    );
+}
+
+void ShapeCache::Clear()
+{
+    std::scoped_lock lock {s_mutex};
+    s_shapes.clear();
+    s_cookedShapes.clear();
+}
+
+size_t ShapeCache::GetSize()
+{
+    std::scoped_lock lock {s_mutex};
+    return s_shapes.size() + s_cookedShapes.size();
+}
+
+JPH::ShapeRefC ShapeCache::GetOrCreate(const Key& key, const JPH::ShapeSettings& settings)
+{
+    std::scoped_lock lock {s_mutex};
+
+    auto it = s_shapes.find(key);
+    if (it != s_shapes.end())
+    {
+        return it->second;
+    }
+
+    JPH::ShapeSettings::ShapeResult shapeResult = settings.Create();
+    if (shapeResult.HasError())
+    {
+        throw std::runtime_error(std::format("Jolt: {}", shapeResult.GetError()));
+    }
+
+    s_shapes.emplace(key, shapeResult.Get());
+    return shapeResult.Get();
+}
+
+JPH::ShapeRefC ShapeCache::GetOrCook(const CookKey& key, const CookFunction& cook)
+{
+    std::string path;
+    {
+        std::scoped_lock lock {s_mutex};
+
+        auto it = s_cookedShapes.find(key);
+        if (it != s_cookedShapes.end())
+        {
+            return it->second;
+        }
+
+        path = std::format("{}/{:016x}.bin", s_diskCacheDirectory, key.hash);
+    }
+
+    // Cook without holding the lock, large meshes take a while. If two threads race on the same
+    // shape the first one inserted wins.
+    JPH::ShapeRefC shape = LoadShape(path, key);
+    if (shape == nullptr)
+    {
+        auto shapeResult = cook();
+        if (shapeResult.HasError())
+        {
+            throw std::runtime_error(std::format("Jolt: {}", shapeResult.GetError()));
+        }
+        shape = shapeResult.Get();
+        SaveShape(path, key, shape);
+    }
+
+    std::scoped_lock lock {s_mutex};
+    return s_cookedShapes.emplace(key, shape).first->second;
+}
+
+JPH::ShapeRefC ShapeCache::LoadShape(const std::string& path, const CookKey& key)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+    {
+        return nullptr;
+    }
+
+    // A file of other source data with the same hash is cooked again and overwritten.
+    CookKey fileKey {};
+    file.read(reinterpret_cast<char*>(&fileKey), sizeof(fileKey));
+    if (!file || fileKey != key)
+    {
+        LOG_WARN("Cached shape {} doesn't match its source data", path);
+        return nullptr;
+    }
+
+    JPH::StreamInWrapper        stream(file);
+    JPH::Shape::IDToShapeMap    shapeMap;
+    JPH::Shape::IDToMaterialMap materialMap;
+
+    auto shapeResult = JPH::Shape::sRestoreWithChildren(stream, shapeMap, materialMap);
+    if (shapeResult.HasError())
+    {
+        LOG_WARN("Failed to load cached shape {}: {}", path, shapeResult.GetError());
+        return nullptr;
+    }
+
+    LOG_DEBUG("Loaded cached shape {}", path);
+    return shapeResult.Get();
+}
+
+void ShapeCache::SaveShape(
+    const std::string&    path,
+    const CookKey&        key,
+    const JPH::ShapeRefC& shape
+)
+{
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+    if (error)
+    {
+        LOG_WARN("Failed to create shape cache directory: {}", error.message());
+        return;
+    }
+
+    // Write to a temporary file first so a crash can't leave a truncated cache entry behind. Every
+    // writer gets its own file, the same shape may be cooked by several threads or processes.
+    const auto tmpPath = std::format(
+        "{}.{:x}{:x}.tmp",
+        path,
+        std::hash<std::thread::id> {}(std::this_thread::get_id()),
+        std::random_device {}()
+    );
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            LOG_WARN("Failed to open {}", tmpPath);
+            return;
+        }
+
+        file.write(reinterpret_cast<const char*>(&key), sizeof(key));
+
+        JPH::StreamOutWrapper       stream(file);
+        JPH::Shape::ShapeToIDMap    shapeMap;
+        JPH::Shape::MaterialToIDMap materialMap;
+        shape->SaveWithChildren(stream, shapeMap, materialMap);
+        if (stream.IsFailed())
+        {
+            LOG_WARN("Failed to write {}", tmpPath);
+            file.close();
+            std::filesystem::remove(tmpPath, error);
+            return;
+        }
+    }
+
+    std::filesystem::rename(tmpPath, path, error);
+    if (error)
+    {
+        LOG_WARN("Failed to write cached shape {}: {}", path, error.message());
+        std::filesystem::remove(tmpPath, error);
+    }
+}
+}; // namespace legs
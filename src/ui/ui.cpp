@@ -85,6 +85,22 @@ void UI::DebugWindow()
         auto ren = std::format("  Render: {:.2f} ms", Time::DeltaRender * 1000.0);
         ImGui::Text("%s", ren.c_str());
 
+        const auto renderStats = m_renderer->GetStats();
+        auto       draws       = std::format(
+            "  Draws: {} calls for {} meshes, {} culled",
+            renderStats.drawCalls,
+            renderStats.meshDraws,
+            renderStats.meshesCulled
+        );
+        ImGui::Text("%s", draws.c_str());
+
+        auto recording = std::format(
+            "  Recording: {:.2f} ms on {} jobs",
+            renderStats.record.time * 1000.0,
+            renderStats.record.jobs
+        );
+        ImGui::Text("%s", recording.c_str());
+
         auto tps =
             std::format("TPS: {:.0f} ({:.2f} ms)", 1.0 / Time::DeltaTick, Time::DeltaTick * 1000.0);
         ImGui::Text("%s", tps.c_str());
@@ -92,10 +108,89 @@ void UI::DebugWindow()
         auto mem = std::format("MEM: {:d} MB", Memory::GetUsage() / 1024);
         ImGui::Text("%s", mem.c_str());
 
+        JobStats();
+
         ImGui::End();
     }
 }
 
+void UI::SetJobStats(const JobSystemStats& stats)
+{
+    const auto now     = Time::Now();
+    const auto elapsed = now - m_jobStatsTime;
+    if (elapsed < 0.5)
+    {
+        return;
+    }
+
+    // Workers restarted, the counters start over.
+    if (stats.workers.size() != m_jobStatsPrev.workers.size())
+    {
+        m_jobStatsPrev = stats;
+        m_jobStatsTime = now;
+        return;
+    }
+
+    const auto& prev = m_jobStatsPrev;
+    m_jobRates       = stats;
+    for (size_t i = 0; i < stats.workers.size(); i++)
+    {
+        const auto& worker = stats.workers[i];
+        auto&       rate   = m_jobRates.workers[i];
+        rate.busyTime      = (worker.busyTime - prev.workers[i].busyTime) / elapsed;
+        rate.idleTime      = (worker.idleTime - prev.workers[i].idleTime) / elapsed;
+        rate.jobsExecuted  = static_cast<uint64_t>(
+            static_cast<double>(worker.jobsExecuted - prev.workers[i].jobsExecuted) / elapsed
+        );
+        rate.fibersResumed = static_cast<uint64_t>(
+            static_cast<double>(worker.fibersResumed - prev.workers[i].fibersResumed) / elapsed
+        );
+    }
+    m_jobRates.queueFullTime   = (stats.queueFullTime - prev.queueFullTime) / elapsed;
+    m_jobRates.barrierWaitTime = (stats.barrierWaitTime - prev.barrierWaitTime) / elapsed;
+    m_jobRates.queueFullCount  = static_cast<uint64_t>(
+        static_cast<double>(stats.queueFullCount - prev.queueFullCount) / elapsed
+    );
+
+    m_jobStatsPrev = stats;
+    m_jobStatsTime = now;
+}
+
+void UI::JobStats()
+{
+    const auto& depth = m_jobRates.queueDepth;
+
+    auto jobs = std::format(
+        "Jobs: {} workers, queued {}/{}/{}",
+        m_jobRates.workers.size(),
+        depth[0],
+        depth[1],
+        depth[2]
+    );
+    ImGui::Text("%s", jobs.c_str());
+
+    auto waits = std::format(
+        "  Barrier wait: {:.2f} ms/s, queue full: {:.2f} ms/s",
+        m_jobRates.barrierWaitTime * 1000.0,
+        m_jobRates.queueFullTime * 1000.0
+    );
+    ImGui::Text("%s", waits.c_str());
+
+    for (size_t i = 0; i < m_jobRates.workers.size(); i++)
+    {
+        const auto& worker = m_jobRates.workers[i];
+
+        auto line = std::format(
+            "  W{:<2} busy {:3.0f}% idle {:3.0f}% {:6d} jobs/s",
+            i + 1,
+            worker.busyTime * 100.0,
+            worker.idleTime * 100.0,
+            worker.jobsExecuted
+        );
+        ImGui::Text("%s", line.c_str());
+    }
+}
+
 void UI::DemoWindow()
 {
     if (!m_state.showWindow[static_cast<unsigned int>(UIWindow::DEMO)])
@@ -0,0 +1,122 @@
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+#include <legs/world/frustum_culler.hpp>
+
+namespace legs
+{
+// Spheres tested per iteration, the arrays are padded to a multiple of it.
+#if defined(__AVX__)
+static constexpr uint32_t cCullWidth = 8;
+#elif defined(__SSE__)
+static constexpr uint32_t cCullWidth = 4;
+#else
+static constexpr uint32_t cCullWidth = 1;
+#endif
+
+void FrustumCuller::Clear()
+{
+    m_x.clear();
+    m_y.clear();
+    m_z.clear();
+    m_radius.clear();
+    m_count = 0;
+}
+
+uint32_t FrustumCuller::Add(const glm::vec3& center, float radius)
+{
+    m_x.push_back(center.x);
+    m_y.push_back(center.y);
+    m_z.push_back(center.z);
+    m_radius.push_back(radius);
+    return m_count++;
+}
+
+void FrustumCuller::Cull(const SFrustum& frustum)
+{
+    // Padding lanes are tested like any other sphere, their results are never read.
+    const uint32_t padded = (m_count + cCullWidth - 1) / cCullWidth * cCullWidth;
+    m_x.resize(padded);
+    m_y.resize(padded);
+    m_z.resize(padded);
+    m_radius.resize(padded);
+    m_visible.resize(padded);
+
+#if defined(__AVX__)
+    const auto& planes = frustum.planes;
+    for (uint32_t i = 0; i < padded; i += cCullWidth)
+    {
+        const __m256 x      = _mm256_loadu_ps(&m_x[i]);
+        const __m256 y      = _mm256_loadu_ps(&m_y[i]);
+        const __m256 z      = _mm256_loadu_ps(&m_z[i]);
+        const __m256 radius = _mm256_loadu_ps(&m_radius[i]);
+        const __m256 limit  = _mm256_sub_ps(_mm256_setzero_ps(), radius);
+
+        __m256 inside = _mm256_setzero_ps();
+        for (int p = 0; p < SFrustum::cNumPlanes; p++)
+        {
+            __m256 distance = _mm256_set1_ps(planes[p].w);
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(x, _mm256_set1_ps(planes[p].x)));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(y, _mm256_set1_ps(planes[p].y)));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(z, _mm256_set1_ps(planes[p].z)));
+
+            const __m256 test = _mm256_cmp_ps(distance, limit, _CMP_GE_OQ);
+            inside            = p == 0 ? test : _mm256_and_ps(inside, test);
+        }
+
+        const int mask = _mm256_movemask_ps(inside);
+        for (uint32_t lane = 0; lane < cCullWidth; lane++)
+        {
+            m_visible[i + lane] = static_cast<uint8_t>((mask >> lane) & 1);
+        }
+    }
+#elif defined(__SSE__)
+    const auto& planes = frustum.planes;
+    for (uint32_t i = 0; i < padded; i += cCullWidth)
+    {
+        const __m128 x      = _mm_loadu_ps(&m_x[i]);
+        const __m128 y      = _mm_loadu_ps(&m_y[i]);
+        const __m128 z      = _mm_loadu_ps(&m_z[i]);
+        const __m128 radius = _mm_loadu_ps(&m_radius[i]);
+        const __m128 limit  = _mm_sub_ps(_mm_setzero_ps(), radius);
+
+        __m128 inside = _mm_setzero_ps();
+        for (int p = 0; p < SFrustum::cNumPlanes; p++)
+        {
+            __m128 distance = _mm_set1_ps(planes[p].w);
+            distance        = _mm_add_ps(distance, _mm_mul_ps(x, _mm_set1_ps(planes[p].x)));
+            distance        = _mm_add_ps(distance, _mm_mul_ps(y, _mm_set1_ps(planes[p].y)));
+            distance        = _mm_add_ps(distance, _mm_mul_ps(z, _mm_set1_ps(planes[p].z)));
+
+            const __m128 test = _mm_cmpge_ps(distance, limit);
+            inside            = p == 0 ? test : _mm_and_ps(inside, test);
+        }
+
+        const int mask = _mm_movemask_ps(inside);
+        for (uint32_t lane = 0; lane < cCullWidth; lane++)
+        {
+            m_visible[i + lane] = static_cast<uint8_t>((mask >> lane) & 1);
+        }
+    }
+#else
+    for (uint32_t i = 0; i < padded; i++)
+    {
+        const glm::vec3 center = {m_x[i], m_y[i], m_z[i]};
+        m_visible[i]           = frustum.IsSphereVisible(center, m_radius[i]) ? 1 : 0;
+    }
+#endif
+
+    m_stats = {};
+    for (uint32_t i = 0; i < m_count; i++)
+    {
+        if (m_visible[i] != 0)
+        {
+            m_stats.visible++;
+        }
+    }
+    m_stats.culled = m_count - m_stats.visible;
+}
+}; // namespace legs
@@ -0,0 +1,238 @@
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+#include <legs/components/transform.hpp>
+#include <legs/world/transform_hierarchy.hpp>
+
+namespace legs
+{
+TransformId TransformHierarchy::Create(TransformId parent)
+{
+    TransformId id;
+    if (!m_freeIds.empty())
+    {
+        id = m_freeIds.back();
+        m_freeIds.pop_back();
+    }
+    else
+    {
+        id = static_cast<TransformId>(m_indices.size());
+        m_indices.push_back(cNoParent);
+    }
+
+    const auto index = static_cast<uint32_t>(m_ids.size());
+    m_indices[id]    = index;
+
+    m_ids.push_back(id);
+    m_parent.push_back(cNoParent);
+    m_localPosition.emplace_back(0.0f);
+    m_localRotation.push_back(glm::identity<glm::quat>());
+    m_worldPosition.emplace_back(0.0f);
+    m_worldRotation.push_back(glm::identity<glm::quat>());
+    m_worldMatrix.push_back(glm::identity<glm::mat4x4>());
+    m_dirty.push_back(1);
+    m_changed.push_back(0);
+    m_alive.push_back(1);
+
+    if (parent != cInvalidTransformId)
+    {
+        SetParent(id, parent);
+    }
+
+    return id;
+}
+
+void TransformHierarchy::Destroy(TransformId id)
+{
+    const uint32_t index = m_indices[id];
+    if (index == cNoParent)
+    {
+        throw std::runtime_error("Destroying an unknown transform");
+    }
+
+    for (size_t i = 0; i < m_parent.size(); i++)
+    {
+        if (m_parent[i] == index)
+        {
+            m_parent[i] = cNoParent;
+            m_dirty[i]  = 1;
+        }
+    }
+
+    // Removed from the arrays in the next Sort.
+    m_alive[index] = 0;
+    m_indices[id]  = cNoParent;
+    m_freeIds.push_back(id);
+    m_needsSort = true;
+}
+
+void TransformHierarchy::SetParent(TransformId id, TransformId parent)
+{
+    const uint32_t index       = m_indices[id];
+    const uint32_t parentIndex = parent == cInvalidTransformId ? cNoParent : m_indices[parent];
+
+    // Walk up from the new parent, attaching to a descendant would create a cycle.
+    for (uint32_t i = parentIndex; i != cNoParent; i = m_parent[i])
+    {
+        if (i == index)
+        {
+            throw std::runtime_error("Transform parent would create a cycle");
+        }
+    }
+
+    m_parent[index] = parentIndex;
+    m_dirty[index]  = 1;
+
+    // A parent after its child breaks the depth order.
+    if (parentIndex != cNoParent && parentIndex > index)
+    {
+        m_needsSort = true;
+    }
+}
+
+TransformId TransformHierarchy::GetParent(TransformId id) const
+{
+    const uint32_t parentIndex = m_parent[m_indices[id]];
+    return parentIndex == cNoParent ? cInvalidTransformId : m_ids[parentIndex];
+}
+
+void TransformHierarchy::SetLocal(
+    TransformId      id,
+    const glm::vec3& position,
+    const glm::quat& rotation
+)
+{
+    const uint32_t index = m_indices[id];
+    if (m_localPosition[index] == position && m_localRotation[index] == rotation)
+    {
+        return;
+    }
+
+    m_localPosition[index] = position;
+    m_localRotation[index] = rotation;
+    m_dirty[index]         = 1;
+}
+
+uint32_t TransformHierarchy::Update()
+{
+    if (m_needsSort)
+    {
+        Sort();
+    }
+
+    uint32_t numUpdated = 0;
+    for (size_t i = 0; i < m_ids.size(); i++)
+    {
+        const uint32_t parent = m_parent[i];
+        if (m_dirty[i] == 0 && (parent == cNoParent || m_changed[parent] == 0))
+        {
+            m_changed[i] = 0;
+            continue;
+        }
+
+        if (parent == cNoParent)
+        {
+            m_worldPosition[i] = m_localPosition[i];
+            m_worldRotation[i] = m_localRotation[i];
+        }
+        else
+        {
+            m_worldRotation[i] = m_worldRotation[parent] * m_localRotation[i];
+            m_worldPosition[i] =
+                m_worldPosition[parent] + m_worldRotation[parent] * m_localPosition[i];
+        }
+
+        m_worldMatrix[i] = ComposeMatrix(m_worldPosition[i], m_worldRotation[i]);
+        m_dirty[i]       = 0;
+        m_changed[i]     = 1;
+        numUpdated++;
+    }
+
+    return numUpdated;
+}
+
+void TransformHierarchy::CopyWorldMatrices(std::vector<glm::mat4x4>& out) const
+{
+    out.resize(m_indices.size());
+    for (size_t id = 0; id < m_indices.size(); id++)
+    {
+        const uint32_t index = m_indices[id];
+        out[id] = index == cNoParent ? glm::identity<glm::mat4x4>() : m_worldMatrix[index];
+    }
+}
+
+void TransformHierarchy::Sort()
+{
+    const auto count = m_ids.size();
+
+    // Depth of every node, parents may currently come after their children.
+    std::vector<uint32_t> depth(count, cNoParent);
+    for (size_t i = 0; i < count; i++)
+    {
+        uint32_t d = 0;
+        uint32_t p = m_parent[i];
+        while (p != cNoParent && depth[p] == cNoParent)
+        {
+            d++;
+            p = m_parent[p];
+        }
+        d += p == cNoParent ? 0 : depth[p] + 1;
+
+        // Fill in the walked chain as well.
+        for (auto j = static_cast<uint32_t>(i); j != p; j = m_parent[j])
+        {
+            depth[j] = d--;
+        }
+    }
+
+    std::vector<uint32_t> order;
+    order.reserve(count);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (m_alive[i] != 0)
+        {
+            order.push_back(i);
+        }
+    }
+    std::ranges::stable_sort(order, {}, [&depth](uint32_t i) { return depth[i]; });
+
+    std::vector<uint32_t> newIndex(count, cNoParent);
+    for (uint32_t i = 0; i < order.size(); i++)
+    {
+        newIndex[order[i]] = i;
+    }
+
+    auto permute = [&order](auto& values)
+    {
+        std::remove_reference_t<decltype(values)> sorted;
+        sorted.reserve(order.size());
+        for (auto i : order)
+        {
+            sorted.push_back(values[i]);
+        }
+        values.swap(sorted);
+    };
+    permute(m_ids);
+    permute(m_parent);
+    permute(m_localPosition);
+    permute(m_localRotation);
+    permute(m_worldPosition);
+    permute(m_worldRotation);
+    permute(m_worldMatrix);
+    permute(m_dirty);
+    permute(m_changed);
+    permute(m_alive);
+
+    for (uint32_t i = 0; i < m_ids.size(); i++)
+    {
+        m_indices[m_ids[i]] = i;
+        if (m_parent[i] != cNoParent)
+        {
+            m_parent[i] = newIndex[m_parent[i]];
+        }
+    }
+
+    m_needsSort = false;
+}
+}; // namespace legs
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <memory>
 
 #include <glm/ext/matrix_transform.hpp>
@@ -8,14 +9,17 @@
 #include <legs/geometry/icosphere.hpp>
 #include <legs/log.hpp>
 #include <legs/renderer/renderer.hpp>
+#include <legs/time.hpp>
 #include <legs/world/world.hpp>
 
 namespace legs
 {
+// Entities that aren't frustum culled.
+static constexpr uint32_t cNotCulled = UINT32_MAX;
 
-World::World(std::shared_ptr<Renderer> renderer) :
+World::World(std::shared_ptr<Renderer> renderer, std::shared_ptr<JobSystemThreadPool> jobSystem) :
     m_renderer(renderer),
-    m_physics(std::make_shared<Physics>())
+    m_physics(std::make_shared<Physics>(jobSystem))
 {
     LOG_DEBUG("Creating World");
 }
@@ -23,12 +27,26 @@ World::World(std::shared_ptr<Renderer> renderer) :
 World::~World()
 {
     LOG_DEBUG("Destroying World");
+
+    for (const auto& [entity, id] : m_culledDraws)
+    {
+        m_renderer->RemoveCulledDraw(id);
+    }
     m_physics.reset();
 }
 
 void World::Frame()
 {
-    for (auto ent : m_entities)
+    {
+        std::scoped_lock renderLock {m_renderMutex};
+        if (m_frameVersion != m_publishedVersion)
+        {
+            m_frameEntities = m_publishedEntities;
+            m_frameVersion  = m_publishedVersion;
+        }
+    }
+
+    for (auto ent : m_frameEntities)
     {
         ent->OnFrame();
     }
@@ -40,46 +58,274 @@ void World::Tick()
         m_physics->Update();
 
         std::scoped_lock worldLock {m_worldMutex};
+        m_ticking = true;
+
+        const auto syncStart = Time::Now();
         for (auto ent : m_entities)
         {
             ent->OnTick();
         }
+        m_syncTime = Time::Now() - syncStart;
+
+        for (auto ent : m_entities)
+        {
+            const auto trans = ent->GetTransform();
+            const auto id    = ent->GetTransformId();
+            m_transforms.SetLocal(id, trans->position, trans->rotation.quaternion);
+        }
+        m_transforms.Update();
+
+        {
+            std::scoped_lock renderLock {m_renderMutex};
+            m_transforms.CopyWorldMatrices(m_renderTransforms);
+        }
+
+        for (auto ent : m_entities)
+        {
+            ent->OnTransformUpdate();
+        }
+
+        // After OnTick so handlers see the synced transforms.
+        m_physics->DispatchEvents();
+
+        m_ticking = false;
+        ApplyEntityChanges();
+        PublishEntities();
     }
 }
 
 void World::Render()
 {
+    const auto frustum = m_renderer->GetUBO()->GetFrustum();
+
+    // Arena meshes are drawn as culled draws while the renderer culls on the GPU.
+    const bool gpuCulling = m_renderer->GetGpuCulling();
+
+    bool entitiesChanged = false;
+    {
+        // Entities removed since the last list are only released after this.
+        std::scoped_lock renderLock {m_renderMutex};
+        if (m_renderedVersion != m_publishedVersion)
+        {
+            m_renderEntities  = m_publishedEntities;
+            m_renderedVersion = m_publishedVersion;
+            entitiesChanged   = true;
+        }
+    }
+
+    if (entitiesChanged || gpuCulling != m_culledDrawsEnabled)
+    {
+        SyncCulledDraws(gpuCulling);
+    }
+
+    m_culler.Clear();
+    {
+        std::scoped_lock renderLock {m_renderMutex};
+        m_renderer->SetTransforms(m_renderTransforms);
+
+        m_cullIndices.assign(m_drawnEntities.size(), cNotCulled);
+
+        for (size_t i = 0; i < m_drawnEntities.size(); i++)
+        {
+            auto meshEnt = std::static_pointer_cast<MeshEntity>(m_drawnEntities[i]);
+            if (!meshEnt->HasBounds())
+            {
+                continue;
+            }
+
+            const auto id = meshEnt->GetTransformId();
+            if (id >= m_renderTransforms.size())
+            {
+                continue;
+            }
+
+            const auto& bounds = meshEnt->GetBounds();
+            const auto  center = m_renderTransforms[id] * glm::vec4(bounds.center, 1.0f);
+            m_cullIndices[i]   = m_culler.Add(glm::vec3(center), bounds.radius);
+        }
+    }
+    m_culler.Cull(frustum);
+    m_renderer->AddCulledMeshes(m_culler.GetStats().culled);
+
     if (m_sky != nullptr)
     {
         m_sky->Render(m_renderer);
     }
 
-    for (auto ent : m_entities)
+    for (size_t i = 0; i < m_drawnEntities.size(); i++)
     {
-        if (auto meshEnt = std::static_pointer_cast<MeshEntity>(ent))
+        const auto index = m_cullIndices[i];
+        if (index != cNotCulled && !m_culler.IsVisible(index))
+        {
+            continue;
+        }
+
+        if (auto meshEnt = std::static_pointer_cast<MeshEntity>(m_drawnEntities[i]))
         {
             meshEnt->Render(m_renderer);
         }
     }
+
+    m_renderer->FlushDraws();
+
+    m_physics->RenderDebug(m_renderer);
+}
+
+void World::SyncCulledDraws(bool gpuCulling)
+{
+    decltype(m_culledDraws) culledDraws;
+    m_drawnEntities.clear();
+    for (const auto& entity : m_renderEntities)
+    {
+        auto meshEnt = std::static_pointer_cast<MeshEntity>(entity);
+        if (!gpuCulling || meshEnt->GetMesh() == nullptr
+            || meshEnt->GetPipeline() == RenderPipeline::INVALID)
+        {
+            m_drawnEntities.push_back(entity);
+            continue;
+        }
+
+        if (auto culled = m_culledDraws.extract(entity); !culled.empty())
+        {
+            culledDraws.insert(std::move(culled));
+            continue;
+        }
+
+        const auto id = m_renderer->AddCulledDraw(
+            meshEnt->GetPipeline(),
+            meshEnt->GetMesh(),
+            meshEnt->GetTransformId()
+        );
+        culledDraws.emplace(entity, id);
+    }
+
+    // Left over are the entities that aren't in the list anymore.
+    for (const auto& [entity, id] : m_culledDraws)
+    {
+        m_renderer->RemoveCulledDraw(id);
+    }
+    m_culledDraws        = std::move(culledDraws);
+    m_culledDrawsEnabled = gpuCulling;
 }
 
 void World::AddEntity(std::shared_ptr<Entity> entity)
 {
+    std::scoped_lock worldLock {m_worldMutex};
+    if (m_ticking)
+    {
+        m_entityChanges.push_back({entity, true});
+        return;
+    }
+
+    SpawnEntity(entity);
+    PublishEntities();
+}
+
+void World::RemoveEntity(std::shared_ptr<Entity> entity)
+{
+    std::scoped_lock worldLock {m_worldMutex};
+    if (m_ticking)
+    {
+        m_entityChanges.push_back({entity, false});
+        return;
+    }
+
+    DestroyEntity(entity);
+    PublishEntities();
+}
+
+void World::SpawnEntity(std::shared_ptr<Entity> entity)
+{
+    // Added again before the render thread let go, it keeps its transform.
+    auto retired = std::ranges::find(m_retired, entity, &RetiredEntity::entity);
+    if (retired != m_retired.end())
+    {
+        m_retired.erase(retired);
+    }
+    else if (auto retiring = std::ranges::find(m_retiring, entity); retiring != m_retiring.end())
+    {
+        m_retiring.erase(retiring);
+    }
+    else
+    {
+        entity->SetTransformId(m_transforms.Create());
+    }
+
     m_entities.push_back(entity);
+    m_entitiesDirty = true;
     entity->OnSpawn();
 }
 
-void World::RemoveEntity(std::shared_ptr<Entity> entity)
+void World::DestroyEntity(std::shared_ptr<Entity> entity)
 {
-    for (auto it = m_entities.begin(); it != m_entities.end();)
+    auto it = std::ranges::find(m_entities, entity);
+    if (it == m_entities.end())
     {
-        if (*it == entity)
+        return;
+    }
+
+    m_entities.erase(it);
+    m_entitiesDirty = true;
+    entity->OnDestroy();
+    m_retiring.push_back(entity);
+}
+
+void World::ApplyEntityChanges()
+{
+    // Spawning may add more entities, those are applied right away.
+    auto changes = std::move(m_entityChanges);
+    m_entityChanges.clear();
+    for (auto& change : changes)
+    {
+        if (change.add)
+        {
+            SpawnEntity(change.entity);
+        }
+        else
         {
-            m_entities.erase(it);
-            entity->OnDestroy();
-            break;
+            DestroyEntity(change.entity);
         }
-        it++;
     }
 }
+
+void World::PublishEntities()
+{
+    std::scoped_lock renderLock {m_renderMutex};
+    if (m_entitiesDirty)
+    {
+        m_publishedEntities = m_entities;
+        m_publishedVersion++;
+        m_entitiesDirty = false;
+
+        for (auto& entity : m_retiring)
+        {
+            m_retired.push_back({std::move(entity), m_publishedVersion});
+        }
+        m_retiring.clear();
+    }
+
+    // The render thread took a list without these, nothing reads their transform anymore.
+    std::erase_if(
+        m_retired,
+        [this](const RetiredEntity& retired)
+        {
+            if (retired.version > m_renderedVersion)
+            {
+                return false;
+            }
+            m_transforms.Destroy(retired.entity->GetTransformId());
+            retired.entity->SetTransformId(cInvalidTransformId);
+            return true;
+        }
+    );
+}
+
+void World::SetParent(std::shared_ptr<Entity> entity, std::shared_ptr<Entity> parent)
+{
+    std::scoped_lock worldLock {m_worldMutex};
+    m_transforms.SetParent(
+        entity->GetTransformId(),
+        parent != nullptr ? parent->GetTransformId() : cInvalidTransformId
+    );
+}
 } // namespace legs